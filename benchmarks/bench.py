@@ -0,0 +1,249 @@
+#!/usr/bin/env python3
+"""
+Flux compiler throughput benchmarks.
+
+Measures front end and codegen throughput on the synthetic programs from
+generate.py, and the runtime of compiled example kernels:
+
+    lex      tokens/sec for FluxLexer.tokenize
+    parse    AST nodes/sec for FluxParser.parse
+    codegen  IR instructions/sec for Program.codegen
+    runtime  wall time of the compiled kernel binaries (examples/sha256.fx,
+             which exits 0 only when its digest of "hello world" is right)
+
+Every stage is timed --repeat times and the best run is kept, so results
+are comparable between commits on the same machine. Save a run with
+--json and pass it back with --baseline to see the ratios.
+
+Usage:
+    python3 bench.py                          # All stages, default scales
+    python3 bench.py --scale 4 --json new.json
+    python3 bench.py --baseline old.json      # Compare against a saved run
+    python3 bench.py --only lex,parse         # Subset of stages
+"""
+
+import io
+import sys
+import json
+import time
+import platform
+import contextlib
+import shutil
+import tempfile
+import subprocess
+from pathlib import Path
+
+ROOT = Path(__file__).resolve().parent.parent
+COMPILER_DIR = ROOT / "src" / "compiler"
+sys.path.insert(0, str(COMPILER_DIR))
+sys.path.insert(0, str(Path(__file__).resolve().parent))
+
+import generate
+
+# Workload sizes at --scale 1
+DEFAULT_SCALES = {
+    'functions': 2000,
+    'expressions': 500,
+    'tables': 64,
+    'namespaces': 200,
+}
+
+DEFAULT_KERNELS = ["examples/sha256.fx"]
+STAGES = ("lex", "parse", "codegen", "runtime")
+
+def best_of(repeat: int, fn):
+    """Run fn repeat times, returning the fastest wall time and the last result"""
+    best = None
+    result = None
+    for _ in range(repeat):
+        start = time.perf_counter()
+        result = fn()
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    return best, result
+
+def count_instructions(module) -> int:
+    return sum(len(block.instructions) for func in module.functions for block in func.blocks)
+
+def bench_workload(name: str, scale: int, stages, repeat: int) -> dict:
+    from flexer import FluxLexer
+    from fparser import FluxParser
+    from freport import TimeReport
+
+    source = generate.generate(name, scale)
+    result = {'scale': scale, 'source_bytes': len(source.encode('utf-8'))}
+
+    lex_time, tokens = best_of(repeat, lambda: FluxLexer(source).tokenize())
+    result['tokens'] = len(tokens)
+    if "lex" in stages:
+        result['lex_seconds'] = lex_time
+        result['tokens_per_sec'] = len(tokens) / lex_time
+
+    if not {"parse", "codegen"} & set(stages):
+        return result
+
+    def parse():
+        parser = FluxParser(tokens)
+        program = parser.parse()
+        if parser.errors:
+            raise RuntimeError(f"{name}: {len(parser.errors)} parse errors")
+        return program
+    parse_time, program = best_of(repeat, parse)
+    counter = TimeReport()
+    counter.count_ast(program)
+    result['ast_nodes'] = sum(counter.ast_nodes.values())
+    if "parse" in stages:
+        result['parse_seconds'] = parse_time
+        result['nodes_per_sec'] = result['ast_nodes'] / parse_time
+
+    if "codegen" in stages:
+        try:
+            from llvmlite import ir
+            from fast import ImportStatement
+
+            def codegen():
+                ImportStatement._processed_imports.clear()
+                module = ir.Module(name="bench", context=ir.Context())
+                module.triple = "x86_64-pc-linux-gnu"
+                # Program.codegen prints each failing statement, keep the report readable
+                with contextlib.redirect_stdout(io.StringIO()):
+                    return program.codegen(module)
+            # Codegen leaves the AST as it found it, so one parse serves every run
+            best, module = best_of(repeat, codegen)
+            result['ir_instructions'] = count_instructions(module)
+            result['codegen_seconds'] = best
+            result['instructions_per_sec'] = result['ir_instructions'] / best
+        except Exception as e:
+            result['codegen_error'] = str(e)
+    return result
+
+def bench_kernel(kernel: str, repeat: int) -> dict:
+    """Compile a kernel with fc.py and time the resulting binary"""
+    source = (ROOT / kernel).resolve()
+    with tempfile.TemporaryDirectory(prefix="flux_bench_") as work:
+        # Imports resolve against the working directory, stage the stdlib next to the build
+        shutil.copytree(ROOT / "src" / "stdlib", work, dirs_exist_ok=True)
+        binary = Path(work) / source.stem
+        compile_start = time.perf_counter()
+        build = subprocess.run([sys.executable, str(COMPILER_DIR / "fc.py"), str(source), str(binary), "--no-cache"],
+                               cwd=work, capture_output=True, text=True)
+        compile_time = time.perf_counter() - compile_start
+        if build.returncode != 0 or not binary.exists():
+            return {'compile_error': (build.stderr or build.stdout).strip().splitlines()[-1:]}
+
+        def run():
+            return subprocess.run([str(binary)], capture_output=True).returncode
+        run_time, exit_code = best_of(repeat, run)
+        return {'compile_seconds': compile_time, 'run_seconds': run_time, 'exit_code': exit_code}
+
+def git_revision() -> str:
+    try:
+        return subprocess.check_output(["git", "rev-parse", "--short", "HEAD"], cwd=ROOT, text=True,
+                                       stderr=subprocess.DEVNULL).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+
+# Higher is better for rates, lower is better for times
+RATE_KEYS = ("tokens_per_sec", "nodes_per_sec", "instructions_per_sec")
+TIME_KEYS = ("run_seconds",)
+
+def compare(results: dict, baseline: dict) -> None:
+    print(f"\nAgainst baseline {baseline['meta']['revision']} (>1.00x is faster):")
+    for section in ("workloads", "kernels"):
+        for name, current in results[section].items():
+            old = baseline.get(section, {}).get(name)
+            if not old:
+                continue
+            for key in RATE_KEYS + TIME_KEYS:
+                if key in current and key in old and old[key] and current[key]:
+                    ratio = current[key] / old[key] if key in RATE_KEYS else old[key] / current[key]
+                    print(f"  {name:<24} {key:<22} {ratio:>6.2f}x")
+
+def print_results(results: dict) -> None:
+    for name, r in results['workloads'].items():
+        line = f"  {name:<24} {r['tokens']:>9} tokens"
+        if 'tokens_per_sec' in r:
+            line += f" {r['tokens_per_sec']:>12,.0f} tok/s"
+        if 'nodes_per_sec' in r:
+            line += f" {r['nodes_per_sec']:>12,.0f} nodes/s"
+        if 'instructions_per_sec' in r:
+            line += f" {r['instructions_per_sec']:>12,.0f} instr/s"
+        elif 'codegen_error' in r:
+            line += f"  codegen failed: {r['codegen_error']}"
+        print(line)
+    for name, r in results['kernels'].items():
+        if 'run_seconds' in r:
+            line = f"  {name:<24} compile {r['compile_seconds']:.3f} s, run {r['run_seconds'] * 1000:.3f} ms"
+            if r['exit_code'] != 0:
+                # The kernels check their own results
+                line += f"  WRONG RESULT (exit code {r['exit_code']})"
+            print(line)
+        else:
+            print(f"  {name:<24} compile failed: {' '.join(r['compile_error'])}")
+
+def main():
+    args = iter(sys.argv[1:])
+    scale = 1.0
+    repeat = 5
+    stages = list(STAGES)
+    json_file = None
+    baseline_file = None
+    kernels = []
+
+    for arg in args:
+        if arg == "--scale":
+            scale = float(next(args))
+        elif arg == "--repeat":
+            repeat = max(1, int(next(args)))
+        elif arg == "--only":
+            stages = next(args).split(",")
+            unknown = [stage for stage in stages if stage not in STAGES]
+            if unknown:
+                print(f"Error: Unknown stage '{unknown[0]}', expected one of {', '.join(STAGES)}", file=sys.stderr)
+                sys.exit(1)
+        elif arg == "--json":
+            json_file = next(args)
+        elif arg == "--baseline":
+            baseline_file = next(args)
+        elif arg == "--kernel":
+            kernels.append(next(args))
+        else:
+            print(__doc__)
+            sys.exit(1)
+
+    # Deeply nested expressions recurse once per grammar level
+    sys.setrecursionlimit(max(sys.getrecursionlimit(), 20000))
+
+    results = {
+        'meta': {
+            'revision': git_revision(),
+            'python': platform.python_version(),
+            'machine': platform.machine(),
+            'system': platform.system(),
+            'scale': scale,
+            'repeat': repeat,
+        },
+        'workloads': {},
+        'kernels': {},
+    }
+
+    if {"lex", "parse", "codegen"} & set(stages):
+        for name, base in DEFAULT_SCALES.items():
+            results['workloads'][name] = bench_workload(name, max(1, int(base * scale)), stages, repeat)
+    if "runtime" in stages:
+        for kernel in kernels or DEFAULT_KERNELS:
+            results['kernels'][kernel] = bench_kernel(kernel, repeat)
+
+    print(f"Flux benchmarks at {results['meta']['revision']} (scale {scale}, best of {repeat}):")
+    print_results(results)
+
+    if baseline_file:
+        with open(baseline_file, 'r') as f:
+            compare(results, json.load(f))
+    if json_file:
+        with open(json_file, 'w') as f:
+            json.dump(results, f, indent=2)
+        print(f"\nResults written to: {json_file}")
+
+if __name__ == "__main__":
+    main()
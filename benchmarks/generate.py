@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""
+Synthetic Flux program generators for the compiler benchmarks.
+
+Each generator yields a deterministic program for a given scale so that
+results from different commits measure the same input. The programs only
+use syntax the front end already handles end to end.
+
+Usage:
+    python3 generate.py functions 5000 > functions.fx
+    python3 generate.py all 1000 -o out/    # One file per workload
+"""
+
+import sys
+import random
+from pathlib import Path
+
+SEED = 0x464C5558  # "FLUX"
+
+def functions(count: int) -> str:
+    """count top-level defs, each calling the previous one"""
+    out = []
+    for i in range(count):
+        k = i % 97 + 1
+        call = f"f{i - 1}(t, a)" if i else "a"
+        out.append(
+            f"def f{i}(int a, int b) -> int {{\n"
+            f"    int t = a * {k} + b;\n"
+            f"    int u = {call} - t;\n"
+            f"    if (u == {k}) {{\n"
+            f"        return t;\n"
+            f"    }};\n"
+            f"    return u + b * {k};\n"
+            f"}};\n"
+        )
+    return "\n".join(out)
+
+def expressions(count: int, depth: int = 24) -> str:
+    """count functions returning a single expression nested depth parentheses deep"""
+    rng = random.Random(SEED)
+    ops = ["+", "-", "*"]
+    out = []
+    for i in range(count):
+        expr = "x"
+        for _ in range(depth):
+            expr = f"({expr} {rng.choice(ops)} {rng.randrange(1, 1 << 16)})"
+        out.append(f"def e{i}(int x) -> int {{\n    return {expr};\n}};\n")
+    return "\n".join(out)
+
+def tables(count: int, size: int = 256) -> str:
+    """count global const uint32[size] tables of hex literals"""
+    rng = random.Random(SEED)
+    out = []
+    for i in range(count):
+        values = [f"0x{rng.getrandbits(32):08x}" for _ in range(size)]
+        rows = ",\n".join("    " + ", ".join(values[j:j + 8]) for j in range(0, size, 8))
+        out.append(f"const uint32[{size}] T{i} = [\n{rows}\n];\n")
+    return "\n".join(out)
+
+def namespaces(count: int, members: int = 8) -> str:
+    """count namespaces, each holding members functions and an object with members methods"""
+    out = []
+    for i in range(count):
+        body = []
+        for j in range(members):
+            body.append(f"    def n{j}(int a) -> int {{\n        return a + {j};\n    }};\n")
+        methods = "".join(
+            f"        def m{j}(int a) -> int {{\n            return a * {j + 1};\n        }};\n"
+            for j in range(members)
+        )
+        body.append(f"    object obj{i} {{\n{methods}    }};\n")
+        out.append(f"namespace ns{i} {{\n{''.join(body)}}};\n")
+    return "\n".join(out)
+
+WORKLOADS = {
+    'functions': functions,
+    'expressions': expressions,
+    'tables': tables,
+    'namespaces': namespaces,
+}
+
+def generate(workload: str, scale: int) -> str:
+    return WORKLOADS[workload](scale) + "\ndef main() -> int {\n    return 0;\n};\n"
+
+def main():
+    if len(sys.argv) < 3:
+        print(f"Usage: python3 generate.py <{'|'.join(WORKLOADS)}|all> <scale> [-o dir]")
+        sys.exit(1)
+
+    workload, scale = sys.argv[1], int(sys.argv[2])
+    names = list(WORKLOADS) if workload == "all" else [workload]
+    if any(name not in WORKLOADS for name in names):
+        print(f"Error: Unknown workload '{workload}'", file=sys.stderr)
+        sys.exit(1)
+
+    if "-o" in sys.argv:
+        out_dir = Path(sys.argv[sys.argv.index("-o") + 1])
+        out_dir.mkdir(parents=True, exist_ok=True)
+        for name in names:
+            path = out_dir / f"{name}_{scale}.fx"
+            path.write_text(generate(name, scale))
+            print(path)
+    else:
+        for name in names:
+            print(generate(name, scale))
+
+if __name__ == "__main__":
+    main()
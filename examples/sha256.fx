@@ -1,5 +1,5 @@
-import "standard.fx";
-using standard::io, standard::types;
+import "io.fx";
+using standard::io;
 
 // Constants
 const uint32[64] K = [
@@ -27,144 +27,166 @@ const uint32[8] H0 = [
     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
 ];
 
-// Utility functions
-def rotr(uint32 x, uint32 n) -> uint32 {
-    return (x >> n) | (x << (32 - n));
-}
-
-def ch(uint32 x, uint32 y, uint32 z) -> uint32 {
-    return (x & y) ^ (~x & z);
-}
-
-def maj(uint32 x, uint32 y, uint32 z) -> uint32 {
-    return (x & y) ^ (x & z) ^ (y & z);
-}
-
-def Σ0(uint32 x) -> uint32 {
-    return rotr(x, 2) ^ rotr(x, 13) ^ rotr(x, 22);
-}
-
-def Σ1(uint32 x) -> uint32 {
-    return rotr(x, 6) ^ rotr(x, 11) ^ rotr(x, 25);
-}
-
-def σ0(uint32 x) -> uint32 {
-    return rotr(x, 7) ^ rotr(x, 18) ^ (x >> 3);
-}
-
-def σ1(uint32 x) -> uint32 {
-    return rotr(x, 17) ^ rotr(x, 19) ^ (x >> 10);
-}
-
-// Main SHA-256 function
-def sha256(uint8[] message) -> uint8[32] {
-    // Pre-processing
-    uint64 original_bit_len = message.size * 8;
-    uint64 new_bit_len = original_bit_len + 1 + 64;
-    uint64 blocks_needed = (new_bit_len + 511) / 512;
-    uint64 padded_len = blocks_needed * 64;
-    
-    uint8[padded_len] padded;
-    for (uint64 i = 0; i < message.size; i++) {
-        padded[i] = message[i];
-    }
-    
-    // Append '1' bit
-    padded[message.size] = 0x80;
-    
-    // Append length in bits (big-endian)
+// Utility functions. ^ is power; bitwise exclusive or is xor
+const def ch(uint32 x, uint32 y, uint32 z) -> uint32 {
+    return (x & y) xor (~x & z);
+};
+
+const def maj(uint32 x, uint32 y, uint32 z) -> uint32 {
+    return ((x & y) xor (x & z)) xor (y & z);
+};
+
+const def Σ0(uint32 x) -> uint32 {
+    return (rotr(x, 2) xor rotr(x, 13)) xor rotr(x, 22);
+};
+
+const def Σ1(uint32 x) -> uint32 {
+    return (rotr(x, 6) xor rotr(x, 11)) xor rotr(x, 25);
+};
+
+const def σ0(uint32 x) -> uint32 {
+    return (rotr(x, 7) xor rotr(x, 18)) xor (x >> 3);
+};
+
+const def σ1(uint32 x) -> uint32 {
+    return (rotr(x, 17) xor rotr(x, 19)) xor (x >> 10);
+};
+
+// Fold one 64-byte block into the hash state
+def compress(uint32* state, uint8* block) -> void {
+    uint32[64] w;
+
+    // Copy chunk into first 16 words, big-endian
+    for (uint32 i = 0; i < 16; i++) {
+        uint32 b0 = block[i * 4];
+        uint32 b1 = block[i * 4 + 1];
+        uint32 b2 = block[i * 4 + 2];
+        uint32 b3 = block[i * 4 + 3];
+        w[i] = (b0 << 24) | (b1 << 16) | (b2 << 8) | b3;
+    };
+
+    // Extend to 64 words
+    for (uint32 i = 16; i < 64; i++) {
+        w[i] = σ1(w[i - 2]) + w[i - 7] + σ0(w[i - 15]) + w[i - 16];
+    };
+
+    // Initialize working variables
+    uint32 a = state[0];
+    uint32 b = state[1];
+    uint32 c = state[2];
+    uint32 d = state[3];
+    uint32 e = state[4];
+    uint32 f = state[5];
+    uint32 g = state[6];
+    uint32 h = state[7];
+
+    // Compression function
+    for (uint32 i = 0; i < 64; i++) {
+        uint32 temp1 = h + Σ1(e) + ch(e, f, g) + K[i] + w[i];
+        uint32 temp2 = Σ0(a) + maj(a, b, c);
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    };
+
+    // Update hash values
+    state[0] = state[0] + a;
+    state[1] = state[1] + b;
+    state[2] = state[2] + c;
+    state[3] = state[3] + d;
+    state[4] = state[4] + e;
+    state[5] = state[5] + f;
+    state[6] = state[6] + g;
+    state[7] = state[7] + h;
+    return void;
+};
+
+// SHA-256 of length bytes at message, written to the 32 bytes at digest
+def sha256(uint8* message, uint64 length, uint8* digest) -> void {
+    uint32[8] state;
     for (uint32 i = 0; i < 8; i++) {
-        padded[padded_len - 8 + i] = (original_bit_len >> (56 - i*8)) & 0xff;
-    }
-    
-    // Process each 512-bit block
-    uint32[8] hash = H0;
-    
-    for (uint64 chunk = 0; chunk < padded_len; chunk += 64) {
-        uint32[64] w;
-        
-        // Copy chunk into first 16 words
-        for (uint32 i = 0; i < 16; i++) {
-            w[i] = (padded[chunk + i*4] << 24) |
-                   (padded[chunk + i*4 + 1] << 16) |
-                   (padded[chunk + i*4 + 2] << 8) |
-                   padded[chunk + i*4 + 3];
-        }
-        
-        // Extend to 64 words
-        for (uint32 i = 16; i < 64; i++) {
-            w[i] = σ1(w[i-2]) + w[i-7] + σ0(w[i-15]) + w[i-16];
-        }
-        
-        // Initialize working variables
-        uint32 a = hash[0];
-        uint32 b = hash[1];
-        uint32 c = hash[2];
-        uint32 d = hash[3];
-        uint32 e = hash[4];
-        uint32 f = hash[5];
-        uint32 g = hash[6];
-        uint32 h = hash[7];
-        
-        // Compression function
-        for (uint32 i = 0; i < 64; i++) {
-            uint32 temp1 = h + Σ1(e) + ch(e, f, g) + K[i] + w[i];
-            uint32 temp2 = Σ0(a) + maj(a, b, c);
-            
-            h = g;
-            g = f;
-            f = e;
-            e = d + temp1;
-            d = c;
-            c = b;
-            b = a;
-            a = temp1 + temp2;
-        }
-        
-        // Update hash values
-        hash[0] += a;
-        hash[1] += b;
-        hash[2] += c;
-        hash[3] += d;
-        hash[4] += e;
-        hash[5] += f;
-        hash[6] += g;
-        hash[7] += h;
-    }
-    
+        state[i] = H0[i];
+    };
+
+    // Whole blocks straight from the message
+    uint64 offset = 0;
+    while (offset + 64 <= length) {
+        compress(@state[0], @message[offset]);
+        offset = offset + 64;
+    };
+
+    // The rest, the '1' bit, zeros and the length in bits (big-endian):
+    // one block, or two when the length no longer fits after the rest
+    uint8[128] tail;
+    for (uint32 i = 0; i < 128; i++) {
+        tail[i] = 0;
+    };
+    uint64 rest = length - offset;
+    for (uint64 i = 0; i < rest; i++) {
+        tail[i] = message[offset + i];
+    };
+    tail[rest] = 0x80;
+    uint64 tail_length = 64;
+    if (rest >= 56) {
+        tail_length = 128;
+    };
+    uint64 bits = length * 8;
+    for (uint64 i = 0; i < 8; i++) {
+        tail[tail_length - 1 - i] = (uint8)(bits >> (i * 8));
+    };
+    compress(@state[0], @tail[0]);
+    if (tail_length == 128) {
+        compress(@state[0], @tail[64]);
+    };
+
     // Produce final hash
-    uint8[32] digest;
     for (uint32 i = 0; i < 8; i++) {
-        digest[i*4] = (hash[i] >> 24) & 0xff;
-        digest[i*4 + 1] = (hash[i] >> 16) & 0xff;
-        digest[i*4 + 2] = (hash[i] >> 8) & 0xff;
-        digest[i*4 + 3] = hash[i] & 0xff;
-    }
-    
-    return digest;
-}
-
-// Helper function to print hash as hex
-def print_hash(uint8[32] hash) {
-    for (uint32 i = 0; i < 32; i++) {
-        print(f"{hash[i]:02x}");
-    }
-    print("\n");
-}
+        digest[i * 4] = (uint8)(state[i] >> 24);
+        digest[i * 4 + 1] = (uint8)(state[i] >> 16);
+        digest[i * 4 + 2] = (uint8)(state[i] >> 8);
+        digest[i * 4 + 3] = (uint8)state[i];
+    };
+    return void;
+};
+
+// "hello world" and its digest
+const uint8[11] HELLO = [104, 101, 108, 108, 111, 32, 119, 111, 114, 108, 100];
+const uint8[32] HELLO_SHA256 = [
+    0xb9, 0x4d, 0x27, 0xb9, 0x93, 0x4d, 0x3e, 0x08,
+    0xa5, 0x2e, 0x52, 0xd7, 0xda, 0x7d, 0xab, 0xfa,
+    0xc4, 0x84, 0xef, 0xe3, 0x7a, 0x53, 0x80, 0xee,
+    0x90, 0x88, 0xf7, 0xac, 0xe2, 0xef, 0xcd, 0xe9
+];
+const uint8[16] HEX_DIGITS = [48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 97, 98, 99, 100, 101, 102];
 
-// Example usage
+// Prints the hash as hex; the exit status says whether it matched
 def main() -> int {
-    string test = "hello world";
-    uint8[test.size] message;
-    
-    // Convert string to byte array
-    for (uint32 i = 0; i < test.size; i++) {
-        message[i] = test[i];
-    }
-    
-    uint8[32] hash = sha256(message);
-    print("SHA-256 hash of \"hello world\": ");
-    print_hash(hash);
-    
+    uint8[11] message;
+    for (uint32 i = 0; i < 11; i++) {
+        message[i] = HELLO[i];
+    };
+
+    uint8[32] hash;
+    sha256(@message[0], 11, @hash[0]);
+
+    uint8[65] hex;
+    for (uint32 i = 0; i < 32; i++) {
+        hex[i * 2] = HEX_DIGITS[hash[i] >> 4];
+        hex[i * 2 + 1] = HEX_DIGITS[hash[i] & 15];
+    };
+    hex[64] = 0;
+    println(@hex[0]);
+
+    for (uint32 i = 0; i < 32; i++) {
+        if (hash[i] != HELLO_SHA256[i]) {
+            return 1;
+        };
+    };
     return 0;
-}
\ No newline at end of file
+};
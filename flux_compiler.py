@@ -19,11 +19,15 @@ def main():
         print("Options:")
         print("  -v <level>  Verbosity level (0-4)")
         print("  -o <output> Output binary name")
+        print("  -O<level>   Optimization level (0-3, default 2)")
+        print("  --llc       Use the external llc/as toolchain")
         sys.exit(1)
     
     input_file = sys.argv[1]
     output_bin = None
     verbosity = None
+    opt_level = 2
+    use_llc = False
     
     # Parse command line arguments
     i = 2
@@ -34,11 +38,17 @@ def main():
         elif sys.argv[i] == "-o" and i + 1 < len(sys.argv):
             output_bin = sys.argv[i + 1]
             i += 2
+        elif sys.argv[i] in ("-O0", "-O1", "-O2", "-O3"):
+            opt_level = int(sys.argv[i][2:])
+            i += 1
+        elif sys.argv[i] == "--llc":
+            use_llc = True
+            i += 1
         else:
             i += 1
     
     # Create compiler instance
-    compiler = FluxCompiler(verbosity=verbosity)
+    compiler = FluxCompiler(verbosity=verbosity, opt_level=opt_level, use_llc=use_llc)
     
     try:
         # Compile the file
@@ -1,17 +1,99 @@
-from dataclasses import dataclass, field
+from dataclasses import dataclass, field, replace
 from typing import List, Any, Optional, Union, Tuple, ClassVar
 from enum import Enum
 from llvmlite import ir
 from pathlib import Path
 import os
+import math
+import struct
+import freport
+from fsymbols import Scope, symbols
 
 # Base classes first
 @dataclass
 class ASTNode:
     """Base class for all AST nodes"""
+    # Where the node starts in its source file, 1-based; the parser sets them on statements and definitions
+    line: ClassVar[int] = 0
+    column: ClassVar[int] = 0
+
     def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> Any:
         raise NotImplementedError(f"codegen not implemented for {self.__class__.__name__}")
 
+def coerce_int(builder: ir.IRBuilder, value: ir.Value, llvm_type: ir.Type, signed: bool = True) -> ir.Value:
+    """Widen or truncate an integer value to llvm_type, or broadcast it to a vector's lanes; other values pass through"""
+    if isinstance(llvm_type, ir.VectorType) and not isinstance(value.type, ir.VectorType):
+        return splat(builder, value, llvm_type, signed)
+    if isinstance(llvm_type, ir.PointerType) and isinstance(value.type, ir.PointerType) and value.type != llvm_type:
+        # void* (i8*) converts to any pointer, as in C
+        return builder.bitcast(value, llvm_type)
+    if (isinstance(value.type, ir.IntType) and isinstance(llvm_type, ir.IntType)
+            and value.type.width != llvm_type.width):
+        # Booleans widen to 0/1, never -1
+        signed = signed and value.type.width > 1
+        constant = constant_int(value)
+        if constant is not None:
+            return int_constant(llvm_type, _signed(constant, value.type.width) if signed else constant)
+        if value.type.width > llvm_type.width:
+            return builder.trunc(value, llvm_type)
+        if signed:
+            return builder.sext(value, llvm_type)
+        return builder.zext(value, llvm_type)
+    return value
+
+def int_to_float(builder: ir.IRBuilder, value: ir.Value, float_type: ir.Type, signed: bool = True) -> ir.Value:
+    """Convert an integer value to float_type, folding constants"""
+    folded = _int_to_float_constant(value, float_type, signed)
+    if folded is not None:
+        return folded
+    if signed:
+        return builder.sitofp(value, float_type)
+    return builder.uitofp(value, float_type)
+
+def entry_alloca(builder: ir.IRBuilder, llvm_type: ir.Type, name: str = '') -> ir.AllocaInstr:
+    """
+    Allocate a stack slot among the allocas at the top of the function's
+    entry block, wherever the builder currently is. A declaration inside a
+    loop body then takes one slot per call rather than one per iteration,
+    and mem2reg/SROA can promote it to a register.
+    """
+    entry = builder.function.blocks[0]
+    first = next((instr for instr in entry.instructions if not isinstance(instr, ir.AllocaInstr)), None)
+    with builder.goto_block(entry):
+        if first is not None:
+            builder.position_before(first)
+        return builder.alloca(llvm_type, name=name)
+
+def entry_store(builder: ir.IRBuilder, value: ir.Value, ptr: ir.Value) -> None:
+    """Store value to ptr right after the entry block's allocas, before any path of the function runs"""
+    entry = builder.function.blocks[0]
+    first = next((instr for instr in entry.instructions if not isinstance(instr, ir.AllocaInstr)), None)
+    with builder.goto_block(entry):
+        if first is not None:
+            builder.position_before(first)
+        builder.store(value, ptr)
+
+def named_value(builder: ir.IRBuilder, module: ir.Module, name: str) -> Optional[ir.Value]:
+    """What name refers to: a variable of an enclosing block, else the global it resolves to"""
+    if builder.scope is not None:
+        value = builder.scope.get(name)
+        if value is not None:
+            return value
+    return module.globals.get(symbols(module).resolve(name))
+
+def array_address(expr: 'Expression', builder: ir.IRBuilder, module: ir.Module) -> Optional[ir.Value]:
+    """Pointer to a named fixed-size array, or an array member of a named struct, without loading it"""
+    if isinstance(expr, MemberAccess):
+        address = member_address(expr.object, expr.member, builder, module)
+        ptr = address[0] if address is not None else None
+    elif isinstance(expr, Identifier):
+        ptr = named_value(builder, module, expr.name)
+    else:
+        return None
+    if ptr is not None and isinstance(ptr.type, ir.PointerType) and isinstance(ptr.type.pointee, ir.ArrayType):
+        return ptr
+    return None
+
 # Enums and simple types
 class DataType(Enum):
     INT = "int"
@@ -49,8 +131,1185 @@ class Operator(Enum):
     XOR = "xor"
     BITSHIFT_LEFT = "<<"
     BITSHIFT_RIGHT = ">>"
+    ROTATE_LEFT = "rotl"
+    ROTATE_RIGHT = "rotr"
+    POWER = "^"
+    RANGE = ".."
     INCREMENT = "++"
     DECREMENT = "--"
+    BITWISE_NOT = "~"
+
+INTEGER_WIDTHS = {
+    DataType.UINT8: 8, DataType.UINT16: 16, DataType.UINT32: 32, DataType.UINT64: 64,
+    DataType.INT8: 8, DataType.INT16: 16, DataType.INT32: 32, DataType.INT64: 64,
+}
+UNSIGNED_TYPES = {DataType.UINT8, DataType.UINT16, DataType.UINT32, DataType.UINT64}
+
+COMPARISON_OPERATORS = {
+    Operator.EQUAL, Operator.NOT_EQUAL, Operator.LESS_THAN,
+    Operator.LESS_EQUAL, Operator.GREATER_THAN, Operator.GREATER_EQUAL,
+}
+
+# ============ SIGNEDNESS ============
+# LLVM integers carry no sign; the front end remembers which storage was
+# declared unsigned, and which values loop variables are bound to came
+# from unsigned storage, and derives the signedness of expressions from it.
+
+def is_unsigned_type(type_spec: 'TypeSpec', module: ir.Module) -> bool:
+    if not type_spec.is_signed or type_spec.base_type in UNSIGNED_TYPES:
+        return True
+    # Aliases keep the signedness they were declared with (unsigned data{16} as word)
+    return isinstance(type_spec.base_type, str) and type_spec.base_type in getattr(module, '_unsigned_types', ())
+
+def mark_unsigned(module: ir.Module, slot: ir.Value, type_spec: 'TypeSpec') -> None:
+    """Record that slot (an alloca or global) holds a value of type_spec"""
+    if is_unsigned_type(type_spec, module):
+        if not hasattr(module, '_unsigned_values'):
+            module._unsigned_values = set()
+        module._unsigned_values.add(slot)
+
+def mark_unsigned_value(module: ir.Module, value: ir.Value, unsigned: bool) -> None:
+    """Record that value, bound to a name without a slot of its own, is unsigned"""
+    if unsigned:
+        if not hasattr(module, '_unsigned_values'):
+            module._unsigned_values = set()
+        module._unsigned_values.add(value)
+
+def is_unsigned(expr: 'Expression', builder: ir.IRBuilder, module: ir.Module) -> bool:
+    """Whether expr has an unsigned type, so widens with zext and divides, compares and shifts unsigned"""
+    if isinstance(expr, Literal):
+        return expr.type in UNSIGNED_TYPES
+    if isinstance(expr, Identifier):
+        slot = builder.scope.get(expr.name) if builder.scope is not None else None
+        if slot is None:
+            slot = module.globals.get(expr.name)
+        return slot is not None and slot in getattr(module, '_unsigned_values', ())
+    if isinstance(expr, ArrayAccess):
+        return is_unsigned(expr.array, builder, module)
+    if isinstance(expr, PointerDeref):
+        return is_unsigned(expr.pointer, builder, module)
+    if isinstance(expr, CastExpression):
+        return is_unsigned_type(expr.target_type, module)
+    if isinstance(expr, BinaryOp):
+        if expr.operator in COMPARISON_OPERATORS:
+            return False
+        if expr.operator in (Operator.BITSHIFT_LEFT, Operator.BITSHIFT_RIGHT,
+                             Operator.ROTATE_LEFT, Operator.ROTATE_RIGHT):
+            return is_unsigned(expr.left, builder, module)
+        return common_unsigned(int_width(expr.left, builder, module), is_unsigned(expr.left, builder, module),
+                               int_width(expr.right, builder, module), is_unsigned(expr.right, builder, module))
+    if isinstance(expr, UnaryOp) and expr.operator != Operator.NOT:
+        return is_unsigned(expr.operand, builder, module)
+    if isinstance(expr, FunctionCall) and (expr.name in BIT_BUILTINS or expr.name in VECTOR_BUILTINS) and expr.arguments:
+        return is_unsigned(expr.arguments[0], builder, module)
+    if isinstance(expr, FunctionCall) and expr.name in ARENA_BUILTINS:
+        return True  # Addresses
+    return False
+
+def common_unsigned(left_width: Optional[int], left_unsigned: bool,
+                    right_width: Optional[int], right_unsigned: bool) -> bool:
+    """
+    Whether two integer operands meet in an unsigned type, by C's usual
+    arithmetic conversions: an unsigned operand at least as wide as the
+    signed one makes both unsigned, a narrower one converts to the wider
+    signed type. int32 -1 < uint8 5 is a signed compare, and true.
+    """
+    if left_unsigned == right_unsigned:
+        return left_unsigned
+    if left_width is None or right_width is None:
+        return True  # Cannot tell which is wider: the unsigned operand wins, as at equal widths
+    unsigned_width, signed_width = (left_width, right_width) if left_unsigned else (right_width, left_width)
+    return unsigned_width >= signed_width
+
+def int_width(expr: 'Expression', builder: ir.IRBuilder, module: ir.Module) -> Optional[int]:
+    """The bit width of an integer expression, from its declaration, or None when it is not plain to see"""
+    int_type = None
+    if isinstance(expr, Literal):
+        int_type = getattr(expr.codegen(builder, module), 'type', None)
+    elif isinstance(expr, Identifier):
+        slot = builder.scope.get(expr.name) if builder.scope is not None else None
+        if slot is None:
+            slot = module.globals.get(expr.name)
+        if isinstance(slot, (ir.AllocaInstr, ir.GlobalVariable)):
+            int_type = slot.type.pointee
+        elif isinstance(slot, ir.Value):
+            int_type = slot.type  # A loop variable bound to its value
+    elif isinstance(expr, CastExpression):
+        int_type = expr.target_type.get_llvm_type_with_array(module)
+    elif isinstance(expr, UnaryOp) and expr.operator != Operator.NOT:
+        return int_width(expr.operand, builder, module)
+    elif isinstance(expr, BinaryOp) and expr.operator not in COMPARISON_OPERATORS:
+        left = int_width(expr.left, builder, module)
+        if expr.operator in (Operator.BITSHIFT_LEFT, Operator.BITSHIFT_RIGHT,
+                             Operator.ROTATE_LEFT, Operator.ROTATE_RIGHT):
+            return left
+        right = int_width(expr.right, builder, module)
+        return None if left is None or right is None else max(left, right)
+    return int_type.width if isinstance(int_type, ir.IntType) else None
+
+# ============ BIT INTRINSICS ============
+
+def int_intrinsic(builder: ir.IRBuilder, module: ir.Module, name: str, args: List[ir.Value]) -> ir.Value:
+    """Call llvm.<name> overloaded on the integer type of args[0]"""
+    int_type = args[0].type
+    fnty = ir.FunctionType(int_type, [arg.type for arg in args])
+    return builder.call(module.declare_intrinsic(f'llvm.{name}', [int_type], fnty), args)
+
+def rotate(builder: ir.IRBuilder, module: ir.Module, value: ir.Value, amount: ir.Value, left: bool) -> ir.Value:
+    """Funnel shift of value with itself, which selects to a single rol/ror"""
+    return int_intrinsic(builder, module, 'fshl' if left else 'fshr', [value, value, amount])
+
+def byte_swap(builder: ir.IRBuilder, module: ir.Module, value: ir.Value) -> ir.Value:
+    """Reverse the byte order of an integer of any whole number of bytes, or of each vector lane"""
+    width = lane_type(value.type).width
+    if width == 8:
+        return value  # A single byte has no byte order
+    if width % 8:
+        raise ValueError(f"Cannot byte swap {value.type}, it is not a whole number of bytes")
+    if width % 16 == 0:
+        return int_intrinsic(builder, module, 'bswap', [value])
+    # llvm.bswap needs an even number of bytes: swap one byte wider and drop the padding
+    wide = ir.IntType(width + 8)
+    if isinstance(value.type, ir.VectorType):
+        wide = ir.VectorType(wide, value.type.count)
+    swapped = int_intrinsic(builder, module, 'bswap', [builder.zext(value, wide)])
+    return builder.trunc(builder.lshr(swapped, ir.Constant(wide, 8)), value.type)
+
+def _count_zeros(name):
+    # Zero is a defined input: the count is the bit width
+    return lambda builder, module, value: int_intrinsic(builder, module, name, [value, ir.Constant(ir.IntType(1), 0)])
+
+# name -> (argument count, lowering)
+BIT_BUILTINS = {
+    'bitrev':   (1, lambda builder, module, value: int_intrinsic(builder, module, 'bitreverse', [value])),
+    'endiswap': (1, byte_swap),
+    'popcount': (1, lambda builder, module, value: int_intrinsic(builder, module, 'ctpop', [value])),
+    'ctz':      (1, _count_zeros('cttz')),
+    'clz':      (1, _count_zeros('ctlz')),
+    'rotl':     (2, lambda builder, module, value, amount: rotate(builder, module, value, amount, True)),
+    'rotr':     (2, lambda builder, module, value, amount: rotate(builder, module, value, amount, False)),
+}
+
+# ============ VECTORS ============
+# uint32<4> lowers to <4 x i32>. Operators apply lane by lane and a scalar
+# operand is broadcast to every lane, so a kernel written over scalars
+# reads the same over vectors; instruction selection maps the lanes onto
+# SSE/AVX registers.
+
+def vector_type(lane: ir.Type, lanes: int) -> ir.VectorType:
+    if not isinstance(lane, (ir.IntType, ir.FloatType, ir.DoubleType)):
+        raise ValueError(f"Vector lanes must be integers or floats, not {lane}")
+    if lanes < 1:
+        raise ValueError("A vector needs at least one lane")
+    return ir.VectorType(lane, lanes)
+
+def lane_type(llvm_type: ir.Type) -> ir.Type:
+    """The lane type of a vector, or llvm_type itself for a scalar"""
+    return llvm_type.element if isinstance(llvm_type, ir.VectorType) else llvm_type
+
+def is_float_type(llvm_type: ir.Type) -> bool:
+    return isinstance(lane_type(llvm_type), (ir.FloatType, ir.DoubleType))
+
+def lane_mask(indices: List[int]) -> ir.Constant:
+    """shufflevector lane selection"""
+    return ir.Constant(ir.VectorType(ir.IntType(32), len(indices)), [ir.Constant(ir.IntType(32), i) for i in indices])
+
+def convert_lane(builder: ir.IRBuilder, value: ir.Value, lane: ir.Type, signed: bool = True) -> ir.Value:
+    """A scalar converted to a vector's lane type"""
+    if isinstance(lane, ir.IntType):
+        value = coerce_int(builder, value, lane, signed)
+    elif isinstance(value.type, ir.IntType):
+        value = int_to_float(builder, value, lane, signed)
+    if value.type != lane:
+        raise ValueError(f"Cannot use {value.type} as a {lane} lane")
+    return value
+
+def splat(builder: ir.IRBuilder, value: ir.Value, vtype: ir.VectorType, signed: bool = True) -> ir.Value:
+    """Broadcast a scalar to every lane of vtype"""
+    value = convert_lane(builder, value, vtype.element, signed)
+    if isinstance(value, ir.Constant):
+        return ir.Constant(vtype, [value] * vtype.count)
+    undef = ir.Constant(vtype, ir.Undefined)
+    first = builder.insert_element(undef, value, ir.Constant(ir.IntType(32), 0))
+    # Repeating lane 0 selects to a single broadcast
+    return builder.shuffle_vector(first, undef, lane_mask([0] * vtype.count))
+
+def extract_lane(builder: ir.IRBuilder, vector: ir.Value, index: ir.Value) -> ir.Value:
+    """Lane index of vector, read at compile time when both are constants"""
+    lane = constant_int(index)
+    if lane is not None and lane >= vector.type.count:
+        raise ValueError(f"Lane {lane} is out of range for {vector.type}")
+    lanes = constant_lanes(vector, vector.type, False)
+    if lane is not None and lanes is not None:
+        return lanes[lane]
+    return builder.extract_element(vector, index)
+
+def vector_operands(builder: ir.IRBuilder, left: ir.Value, right: ir.Value,
+                    left_unsigned: bool, right_unsigned: bool) -> Tuple[ir.Value, ir.Value]:
+    """Both operands of a lane-wise operation as the same vector type"""
+    if not isinstance(left.type, ir.VectorType):
+        left = splat(builder, left, right.type, not left_unsigned)
+    elif not isinstance(right.type, ir.VectorType):
+        right = splat(builder, right, left.type, not right_unsigned)
+    if left.type != right.type:
+        raise ValueError(f"Lane-wise operation on {left.type} and {right.type}")
+    return left, right
+
+# name -> llvm.vector.reduce.* operation for (signed, unsigned, float) lanes
+VECTOR_REDUCTIONS = {
+    'reduce_add': ('add', 'add', 'fadd'),
+    'reduce_mul': ('mul', 'mul', 'fmul'),
+    'reduce_and': ('and', 'and', None),
+    'reduce_or':  ('or', 'or', None),
+    'reduce_xor': ('xor', 'xor', None),
+    'reduce_min': ('smin', 'umin', 'fmin'),
+    'reduce_max': ('smax', 'umax', 'fmax'),
+}
+
+# name -> accepted argument counts
+VECTOR_BUILTINS = {
+    'extract_lane': (2,),         # extract_lane(v, i)
+    'insert_lane':  (3,),         # insert_lane(v, i, x): v with lane i replaced by x
+    'shuffle':      (2, 3),       # shuffle(a, [lanes]) or shuffle(a, b, [lanes]), lanes of b follow a's
+    **{name: (1,) for name in VECTOR_REDUCTIONS},
+}
+
+def reduce_vector(builder: ir.IRBuilder, module: ir.Module, name: str, vector: ir.Value, unsigned: bool) -> ir.Value:
+    """Horizontal reduction of every lane to one scalar"""
+    signed_op, unsigned_op, float_op = VECTOR_REDUCTIONS[name]
+    lane = vector.type.element
+    if is_float_type(lane):
+        if float_op is None:
+            raise ValueError(f"{name} needs integer lanes, not {vector.type}")
+        op = float_op
+    else:
+        op = unsigned_op if unsigned else signed_op
+    args = [vector]
+    if op in ('fadd', 'fmul'):
+        # In lane order from the identity, rounding exactly like the scalar loop it replaces
+        args.insert(0, ir.Constant(lane, -0.0 if op == 'fadd' else 1.0))
+    fnty = ir.FunctionType(lane, [arg.type for arg in args])
+    return builder.call(module.declare_intrinsic(f'llvm.vector.reduce.{op}', [vector.type], fnty), args)
+
+# ============ CONSTANT FOLDING ============
+# Operations on constants fold to ir.Constant while they are lowered, so
+# global initializers, compt blocks and kernels all see literal results.
+# Integers wrap at their width exactly like the instruction they replace.
+# Whatever that instruction leaves undefined (division by zero, shifting
+# by the width or more) is not folded and stays a run time operation.
+
+def constant_int(value: Optional[ir.Value]) -> Optional[int]:
+    """The bits of an integer constant, or None if value is not one"""
+    if (isinstance(value, ir.Constant) and isinstance(value.type, ir.IntType)
+            and isinstance(value.constant, int)):
+        return _unsigned(int(value.constant), value.type.width)
+    return None
+
+def constant_float(value: Optional[ir.Value]) -> Optional[float]:
+    if (isinstance(value, ir.Constant) and isinstance(value.type, (ir.FloatType, ir.DoubleType))
+            and isinstance(value.constant, (int, float))):
+        return float(value.constant)
+    return None
+
+def _unsigned(value: int, width: int) -> int:
+    return value & ((1 << width) - 1)
+
+def _signed(value: int, width: int) -> int:
+    value = _unsigned(value, width)
+    return value - (1 << width) if value >> (width - 1) else value
+
+def int_constant(int_type: ir.IntType, value: int) -> ir.Constant:
+    """value wrapped to int_type, written signed the way LLVM prints it"""
+    if int_type.width == 1:
+        return ir.Constant(int_type, bool(value & 1))
+    return ir.Constant(int_type, _signed(value, int_type.width))
+
+def float_constant(float_type: ir.Type, value: float) -> Optional[ir.Constant]:
+    """value rounded to float_type, or None if it does not fit"""
+    if isinstance(float_type, ir.FloatType):
+        try:
+            value = struct.unpack('f', struct.pack('f', value))[0]
+        except OverflowError:
+            return None
+    return ir.Constant(float_type, value)
+
+def _int_to_float_constant(value: ir.Value, float_type: ir.Type, signed: bool) -> Optional[ir.Constant]:
+    bits = constant_int(value)
+    if bits is None:
+        return None
+    width = value.type.width
+    return float_constant(float_type, float(_signed(bits, width) if signed and width > 1 else bits))
+
+def _rotate_bits(value: int, amount: int, width: int, left: bool) -> int:
+    amount %= width
+    if not left:
+        amount = (width - amount) % width
+    return _unsigned((value << amount) | (value >> (width - amount)), width)
+
+_INT_COMPARISONS = {
+    Operator.EQUAL: lambda a, b: a == b,
+    Operator.NOT_EQUAL: lambda a, b: a != b,
+    Operator.LESS_THAN: lambda a, b: a < b,
+    Operator.LESS_EQUAL: lambda a, b: a <= b,
+    Operator.GREATER_THAN: lambda a, b: a > b,
+    Operator.GREATER_EQUAL: lambda a, b: a >= b,
+}
+
+def _fold_int(operator: Operator, left: ir.Constant, right: ir.Constant,
+              left_unsigned: bool, right_unsigned: bool) -> Optional[ir.Constant]:
+    # Promote like BinaryOp: the narrower operand extends by its own signedness
+    width = max(left.type.width, right.type.width)
+    a = constant_int(left)
+    b = constant_int(right)
+    if not left_unsigned and left.type.width > 1:
+        a = _unsigned(_signed(a, left.type.width), width)
+    if not right_unsigned and right.type.width > 1:
+        b = _unsigned(_signed(b, right.type.width), width)
+    unsigned = common_unsigned(left.type.width, left_unsigned, right.type.width, right_unsigned)
+    int_type = ir.IntType(width)
+
+    if operator in _INT_COMPARISONS:
+        if not unsigned:
+            a, b = _signed(a, width), _signed(b, width)
+        return ir.Constant(ir.IntType(1), _INT_COMPARISONS[operator](a, b))
+    if operator == Operator.ADD:
+        return int_constant(int_type, a + b)
+    if operator == Operator.SUB:
+        return int_constant(int_type, a - b)
+    if operator == Operator.MUL:
+        return int_constant(int_type, a * b)
+    if operator in (Operator.DIV, Operator.MOD):
+        if b == 0:
+            return None
+        if unsigned:
+            quotient = a // b
+        else:
+            a, b = _signed(a, width), _signed(b, width)
+            if b == -1 and a == -(1 << (width - 1)):
+                return None  # Overflows
+            # sdiv truncates toward zero, srem takes the dividend's sign
+            quotient = abs(a) // abs(b) * (-1 if (a < 0) != (b < 0) else 1)
+        return int_constant(int_type, quotient if operator == Operator.DIV else a - b * quotient)
+    if operator == Operator.AND:
+        return int_constant(int_type, a & b)
+    if operator == Operator.OR:
+        return int_constant(int_type, a | b)
+    if operator == Operator.XOR:
+        return int_constant(int_type, a ^ b)
+    if operator in (Operator.BITSHIFT_LEFT, Operator.BITSHIFT_RIGHT):
+        if b >= width:
+            return None  # Poison in LLVM
+        if operator == Operator.BITSHIFT_LEFT:
+            return int_constant(int_type, a << b)
+        # Only the shifted value's signedness matters
+        return int_constant(int_type, a >> b if left_unsigned else _signed(a, width) >> b)
+    if operator in (Operator.ROTATE_LEFT, Operator.ROTATE_RIGHT):
+        return int_constant(int_type, _rotate_bits(a, b, width, operator == Operator.ROTATE_LEFT))
+    if operator == Operator.POWER:
+        if unsigned or _signed(b, width) >= 0:
+            return int_constant(int_type, pow(a, b, 1 << width))
+        # A negative exponent truncates 1 / a^-b toward zero, like integer_power
+        a = _signed(a, width)
+        if a == 0:
+            return None
+        return int_constant(int_type, (-1 if b & 1 else 1) if a == -1 else int(a == 1))
+    return None
+
+def fold_binary(operator: Operator, left: ir.Value, right: ir.Value,
+                left_unsigned: bool = False, right_unsigned: bool = False) -> Optional[ir.Constant]:
+    """left operator right if both are constants and the result is defined, else None"""
+    if isinstance(left.type, ir.VectorType) or isinstance(right.type, ir.VectorType):
+        return _fold_lanes(operator, left, right, left_unsigned, right_unsigned)
+    if constant_int(left) is not None and constant_int(right) is not None:
+        return _fold_int(operator, left, right, left_unsigned, right_unsigned)
+
+    # Floating point, with an integer operand converted like BinaryOp does
+    if constant_float(left) is not None:
+        float_type = left.type
+    elif constant_float(right) is not None:
+        float_type = right.type
+    else:
+        return None
+    a = constant_float(left)
+    if a is None:
+        a = constant_float(_int_to_float_constant(left, float_type, not left_unsigned))
+    b = constant_float(right)
+    if b is None:
+        b = constant_float(_int_to_float_constant(right, float_type, not right_unsigned))
+    if a is None or b is None:
+        return None
+    if operator in _INT_COMPARISONS:
+        # Ordered comparisons are false when either side is NaN
+        if math.isnan(a) or math.isnan(b):
+            return ir.Constant(ir.IntType(1), False)
+        return ir.Constant(ir.IntType(1), _INT_COMPARISONS[operator](a, b))
+    try:
+        if operator == Operator.ADD:
+            return float_constant(float_type, a + b)
+        if operator == Operator.SUB:
+            return float_constant(float_type, a - b)
+        if operator == Operator.MUL:
+            return float_constant(float_type, a * b)
+        if operator == Operator.DIV:
+            return float_constant(float_type, a / b)
+        if operator == Operator.MOD:
+            return float_constant(float_type, math.fmod(a, b))
+        if operator == Operator.POWER:
+            return float_constant(float_type, math.pow(a, b))
+    except (ZeroDivisionError, ValueError, OverflowError):
+        pass  # inf and NaN results are left to the hardware
+    return None
+
+def constant_lanes(value: ir.Value, vtype: ir.VectorType, signed: bool) -> Optional[List[ir.Constant]]:
+    """The lanes of a constant vector, or of a constant scalar broadcast to vtype"""
+    if not isinstance(value, ir.Constant):
+        return None
+    if isinstance(value.type, ir.VectorType):
+        return list(value.constant) if isinstance(value.constant, (list, tuple)) else None
+    try:
+        return [convert_constant(None, value, vtype.element, signed)] * vtype.count
+    except ValueError:
+        return None
+
+def _fold_lanes(operator: Operator, left: ir.Value, right: ir.Value,
+                left_unsigned: bool, right_unsigned: bool) -> Optional[ir.Constant]:
+    vtype = left.type if isinstance(left.type, ir.VectorType) else right.type
+    a = constant_lanes(left, vtype, not left_unsigned)
+    b = constant_lanes(right, vtype, not right_unsigned)
+    if a is None or b is None or len(a) != len(b):
+        return None
+    lanes = [fold_binary(operator, x, y, left_unsigned, right_unsigned) for x, y in zip(a, b)]
+    if any(lane is None for lane in lanes):
+        return None
+    return ir.Constant(ir.VectorType(lanes[0].type, len(lanes)), lanes)
+
+def fold_unary(operator: Operator, value: ir.Value) -> Optional[ir.Constant]:
+    """operator applied to a constant, or None"""
+    bits = constant_int(value)
+    number = constant_float(value)
+    if operator == Operator.NOT:
+        if bits is not None:
+            return ir.Constant(ir.IntType(1), bits == 0)
+        if number is not None:
+            return ir.Constant(ir.IntType(1), number == 0.0)
+    elif operator == Operator.BITWISE_NOT and bits is not None:
+        return int_constant(value.type, ~bits)
+    elif operator == Operator.SUB:
+        if bits is not None:
+            return int_constant(value.type, -bits)
+        if number is not None:
+            return float_constant(value.type, -number)
+    return None
+
+def _fold_byte_swap(value: int, width: int) -> Optional[int]:
+    if width % 8:
+        return None
+    return int.from_bytes(value.to_bytes(width // 8, 'little'), 'big')
+
+# name -> fold over the unsigned bits of the first argument and its width
+BIT_BUILTIN_FOLDS = {
+    'bitrev':   lambda value, width: int(format(value, f'0{width}b')[::-1], 2),
+    'endiswap': _fold_byte_swap,
+    'popcount': lambda value, width: bin(value).count('1'),
+    'ctz':      lambda value, width: (value & -value).bit_length() - 1 if value else width,
+    'clz':      lambda value, width: width - value.bit_length(),
+    'rotl':     lambda value, width, amount: _rotate_bits(value, amount, width, True),
+    'rotr':     lambda value, width, amount: _rotate_bits(value, amount, width, False),
+}
+
+def fold_bit_builtin(name: str, args: List[ir.Value]) -> Optional[ir.Constant]:
+    """A bit builtin over constant arguments, already coerced to the first one's type"""
+    if isinstance(args[0].type, ir.VectorType):
+        lanes = [constant_lanes(arg, arg.type, False) for arg in args]
+        if None in lanes:
+            return None
+        folded = [fold_bit_builtin(name, list(lane_args)) for lane_args in zip(*lanes)]
+        return None if None in folded else ir.Constant(args[0].type, folded)
+    values = [constant_int(arg) for arg in args]
+    if None in values:
+        return None
+    result = BIT_BUILTIN_FOLDS[name](values[0], args[0].type.width, *values[1:])
+    return None if result is None else int_constant(args[0].type, result)
+
+def zero_constant(llvm_type: ir.Type) -> ir.Constant:
+    if isinstance(llvm_type, ir.IntType):
+        return ir.Constant(llvm_type, 0)
+    if isinstance(llvm_type, (ir.FloatType, ir.DoubleType)):
+        return ir.Constant(llvm_type, 0.0)
+    return ir.Constant(llvm_type, None)  # zeroinitializer
+
+def convert_constant(builder: ir.IRBuilder, value: ir.Constant, llvm_type: ir.Type, signed: bool = True) -> ir.Constant:
+    """A constant of llvm_type holding value, converted like a store would"""
+    if value.type == llvm_type:
+        return value
+    if isinstance(llvm_type, ir.VectorType) and not isinstance(value.type, ir.VectorType):
+        return ir.Constant(llvm_type, convert_constant(builder, value, llvm_type.element, signed))
+    if isinstance(value.type, ir.IntType) and isinstance(llvm_type, ir.IntType):
+        return coerce_int(builder, value, llvm_type, signed)
+    if isinstance(value.type, ir.IntType) and isinstance(llvm_type, (ir.FloatType, ir.DoubleType)):
+        folded = _int_to_float_constant(value, llvm_type, signed)
+        if folded is not None:
+            return folded
+    if constant_float(value) is not None and isinstance(llvm_type, (ir.FloatType, ir.DoubleType)):
+        folded = float_constant(llvm_type, constant_float(value))
+        if folded is not None:
+            return folded
+    raise ValueError(f"Cannot convert constant {value.type} to {llvm_type}")
+
+def constant_initializer(value: 'Expression', llvm_type: ir.Type, builder: ir.IRBuilder,
+                         module: ir.Module) -> Optional[ir.Constant]:
+    """Fold a global's initializer to a constant of its type; globals cannot run code"""
+    if isinstance(value, Literal) and isinstance(value.value, list):
+        if not isinstance(llvm_type, (ir.ArrayType, ir.VectorType)):
+            raise ValueError(f"Array initializer for {llvm_type}")
+        if len(value.value) > llvm_type.count:
+            raise ValueError(f"{len(value.value)} initializers for an array of {llvm_type.count}")
+        elements = [constant_initializer(item, llvm_type.element, builder, module) for item in value.value]
+        # Elements past the initializer list are zero
+        elements += [zero_constant(llvm_type.element)] * (llvm_type.count - len(elements))
+        return ir.Constant(llvm_type, elements)
+    folded = value.codegen(builder, module)
+    if folded is None:
+        return None
+    if not isinstance(folded, ir.Constant):
+        raise ValueError("Initializer is not a compile-time constant")
+    return convert_constant(builder, folded, llvm_type, not is_unsigned(value, builder, module))
+
+# ============ MEMORY LAYOUT ============
+# data{bits:align:endian} only changes how a value sits in memory. Registers
+# always hold native order, so a big-endian value is swapped once per load
+# or store (load+bswap selects to movbe where the CPU has it).
+
+@dataclass(frozen=True)
+class MemoryLayout:
+    align: Optional[int] = None  # Bytes; None keeps the ABI alignment
+    big_endian: bool = False
+
+def type_layout(type_spec: 'TypeSpec', module: ir.Module) -> Optional[MemoryLayout]:
+    """Layout of type_spec, inheriting what it leaves unspecified from the alias it names"""
+    inherited = None
+    if isinstance(type_spec.base_type, str):
+        inherited = getattr(module, '_type_layouts', {}).get(type_spec.base_type)
+        struct_type = getattr(module, '_struct_types', {}).get(type_spec.base_type)
+        layout = getattr(struct_type, 'layout', None)
+        if layout is not None and layout.align > 1 and not type_spec.is_pointer:
+            inherited = MemoryLayout(layout.align)
+
+    align = inherited.align if inherited else None
+    if type_spec.alignment:
+        # Written in bits, like the width
+        if type_spec.alignment % 8 or type_spec.alignment & (type_spec.alignment - 1):
+            raise ValueError(f"Alignment must be a power of two number of bytes, not {type_spec.alignment} bits")
+        align = type_spec.alignment // 8
+    if type_spec.endianness is not None:
+        big_endian = type_spec.endianness == 1
+    else:
+        big_endian = inherited.big_endian if inherited else False
+
+    if align is None and not big_endian:
+        return None
+    return MemoryLayout(align, big_endian)
+
+def set_slot_layout(module: ir.Module, slot: ir.Value, layout: Optional[MemoryLayout]) -> None:
+    """Record the layout of the values stored at slot (for an array, of its elements)"""
+    if layout is None:
+        return
+    if not hasattr(module, '_slot_layouts'):
+        module._slot_layouts = {}
+    module._slot_layouts[slot] = layout
+    if layout.align is not None and isinstance(slot, (ir.AllocaInstr, ir.GlobalVariable)):
+        slot.align = layout.align
+
+def slot_layout(module: ir.Module, slot: Optional[ir.Value]) -> Optional[MemoryLayout]:
+    return getattr(module, '_slot_layouts', {}).get(slot)
+
+def load_value(builder: ir.IRBuilder, module: ir.Module, ptr: ir.Value,
+               layout: Optional[MemoryLayout], name: str = '') -> ir.Value:
+    if layout is None:
+        return builder.load(ptr, name=name)
+    value = builder.load(ptr, name=name, align=layout.align)
+    if layout.big_endian and isinstance(lane_type(value.type), ir.IntType):
+        value = byte_swap(builder, module, value)
+    return value
+
+def store_value(builder: ir.IRBuilder, module: ir.Module, value: ir.Value, ptr: ir.Value,
+                layout: Optional[MemoryLayout]) -> None:
+    if layout is None:
+        builder.store(value, ptr)
+        return
+    if layout.big_endian and isinstance(lane_type(value.type), ir.IntType):
+        value = swap_constant(value) if isinstance(value, ir.Constant) else byte_swap(builder, module, value)
+    builder.store(value, ptr, align=layout.align)
+
+def swap_constant(constant: ir.Constant) -> ir.Constant:
+    """Byte swap an integer constant, or each element of an array or vector constant, at compile time"""
+    if isinstance(constant.type, (ir.ArrayType, ir.VectorType)) and isinstance(constant.constant, (list, tuple)):
+        return ir.Constant(constant.type, [swap_constant(c) for c in constant.constant])
+    if isinstance(constant.type, ir.IntType) and isinstance(constant.constant, int) and constant.type.width % 8 == 0:
+        size = constant.type.width // 8
+        raw = (constant.constant % (1 << constant.type.width)).to_bytes(size, 'little')
+        return ir.Constant(constant.type, int.from_bytes(raw, 'big'))
+    return constant
+
+# ============ STRUCT LAYOUT ============
+# Per the spec, structs are packed: members follow each other with no
+# padding unless their type asks for an alignment (data{bits:align}), so a
+# layout is predictable from the declaration alone. Structs become
+# identified, packed LLVM types with the padding spelled out as byte arrays.
+
+class TargetLayout:
+    """ABI sizes and alignments from an LLVM data layout string, with LangRef defaults"""
+    def __init__(self, data_layout: str = ""):
+        self.pointer_size = 8
+        self.pointer_align = 8
+        self.int_aligns = {1: 1, 8: 1, 16: 2, 32: 4, 64: 4}
+        self.float_aligns = {16: 2, 32: 4, 64: 8, 128: 16}
+        self.vector_aligns = {64: 8, 128: 16}
+        for spec in data_layout.split('-'):
+            parts = spec.split(':')
+            if parts[0] == 'p' or parts[0] == 'p0':
+                self.pointer_size = int(parts[1]) // 8
+                self.pointer_align = int(parts[2]) // 8
+            elif parts[0][:1] in ('i', 'f', 'v') and parts[0][1:].isdigit() and len(parts) > 1:
+                table = {'i': self.int_aligns, 'f': self.float_aligns, 'v': self.vector_aligns}[parts[0][0]]
+                table[int(parts[0][1:])] = int(parts[1]) // 8
+
+    def _int_align(self, width: int) -> int:
+        # An unlisted width takes the alignment of the next larger listed one, else the largest
+        larger = [w for w in self.int_aligns if w >= width]
+        return self.int_aligns[min(larger) if larger else max(self.int_aligns)]
+
+    def abi_align(self, llvm_type: ir.Type) -> int:
+        if isinstance(llvm_type, ir.IntType):
+            return self._int_align(llvm_type.width)
+        if isinstance(llvm_type, ir.FloatType):
+            return self.float_aligns[32]
+        if isinstance(llvm_type, ir.DoubleType):
+            return self.float_aligns[64]
+        if isinstance(llvm_type, ir.PointerType):
+            return self.pointer_align
+        if isinstance(llvm_type, ir.ArrayType):
+            return self.abi_align(llvm_type.element)
+        if isinstance(llvm_type, ir.VectorType):
+            size = self.store_size(llvm_type)
+            # Unlisted vector sizes are naturally aligned
+            return self.vector_aligns.get(size * 8, 1 << (size - 1).bit_length())
+        if isinstance(llvm_type, ir.BaseStructType):
+            layout = getattr(llvm_type, 'layout', None)
+            if layout is not None:
+                return layout.align
+            if llvm_type.packed:
+                return 1
+            return max((self.abi_align(t) for t in llvm_type.elements), default=1)
+        raise ValueError(f"Type {llvm_type} has no size")
+
+    def store_size(self, llvm_type: ir.Type) -> int:
+        if isinstance(llvm_type, ir.IntType):
+            return (llvm_type.width + 7) // 8
+        if isinstance(llvm_type, (ir.FloatType, ir.DoubleType)):
+            return 4 if isinstance(llvm_type, ir.FloatType) else 8
+        if isinstance(llvm_type, ir.VectorType):
+            # Lanes are bit-packed, <8 x i1> is one byte
+            element = llvm_type.element
+            bits = element.width if isinstance(element, ir.IntType) else self.store_size(element) * 8
+            return (bits * llvm_type.count + 7) // 8
+        return self.alloc_size(llvm_type)
+
+    def alloc_size(self, llvm_type: ir.Type) -> int:
+        """Bytes between consecutive elements of an array of llvm_type"""
+        if isinstance(llvm_type, ir.PointerType):
+            return self.pointer_size
+        if isinstance(llvm_type, ir.ArrayType):
+            return llvm_type.count * self.alloc_size(llvm_type.element)
+        if isinstance(llvm_type, ir.BaseStructType):
+            layout = getattr(llvm_type, 'layout', None)
+            if layout is not None:
+                return layout.size
+            offset = 0
+            for element in llvm_type.elements:
+                if not llvm_type.packed:
+                    offset += -offset % self.abi_align(element)
+                offset += self.alloc_size(element)
+            return offset + -offset % self.abi_align(llvm_type)
+        size = self.store_size(llvm_type)
+        return size + -size % self.abi_align(llvm_type)
+
+def target_layout(module: ir.Module) -> TargetLayout:
+    data_layout = str(getattr(module, 'data_layout', '') or '')
+    cached = getattr(module, '_target_layout', None)
+    if cached is None or cached[0] != data_layout:
+        cached = (data_layout, TargetLayout(data_layout))
+        module._target_layout = cached
+    return cached[1]
+
+@dataclass
+class StructLayout:
+    """Where each member of a struct lives; attached to its LLVM type as .layout"""
+    offsets: dict         # Member name -> byte offset
+    memory: dict          # Member name -> MemoryLayout, for members with one
+    size: int             # Bytes, including tail padding
+    align: int            # Bytes
+
+def define_struct(module: ir.Module, name: str, members: List[Tuple[str, ir.Type, Optional[MemoryLayout]]],
+                  align: Optional[int] = None, reorder: bool = False) -> ir.IdentifiedStructType:
+    """
+    Lay out members as a packed struct, padding only where a member's type
+    is aligned (and at the end, up to the struct's alignment). reorder
+    places members by decreasing alignment, then size, to drop padding.
+    """
+    target = target_layout(module)
+
+    def member_align(member):
+        _, llvm_type, memory = member
+        if memory is not None and memory.align is not None:
+            return memory.align
+        if isinstance(llvm_type, ir.BaseStructType) and getattr(llvm_type, 'layout', None) is not None:
+            return llvm_type.layout.align
+        return 1  # Packed unless asked otherwise
+
+    if reorder:
+        members = sorted(members, key=lambda m: (-member_align(m), -target.alloc_size(m[1])))
+
+    elements, names = [], []
+    offsets, memory = {}, {}
+    offset = 0
+
+    def pad(amount):
+        nonlocal offset
+        if amount:
+            elements.append(ir.ArrayType(ir.IntType(8), amount))
+            names.append(None)
+            offset += amount
+
+    for member in members:
+        member_name, llvm_type, member_memory = member
+        pad(-offset % member_align(member))
+        offsets[member_name] = offset
+        if member_memory is not None:
+            memory[member_name] = member_memory
+        elements.append(llvm_type)
+        names.append(member_name)
+        offset += target.alloc_size(llvm_type)
+    struct_align = max([align or 1] + [member_align(m) for m in members])
+    pad(-offset % struct_align)
+
+    struct_type = module.context.get_identified_type(name)
+    if not struct_type.is_opaque:
+        if list(struct_type.elements) != elements:
+            raise ValueError(f"Struct {name} is already defined with a different layout")
+        return struct_type
+    struct_type.packed = True
+    struct_type.set_body(*elements)
+    struct_type.names = names
+    struct_type.member_index = {member_name: i for i, member_name in enumerate(names) if member_name is not None}
+    struct_type.layout = StructLayout(offsets, memory, offset, struct_align)
+    return struct_type
+
+def named_struct(module: ir.Module, name: str) -> Optional[ir.Type]:
+    """The struct or object type name resolves to from the current namespace, `using`s included"""
+    struct_types = getattr(module, '_struct_types', {})
+    return struct_types.get(symbols(module).resolve(name))
+
+def member_address(obj: 'Expression', member: str, builder: ir.IRBuilder,
+                   module: ir.Module) -> Optional[Tuple[ir.Value, Optional[MemoryLayout]]]:
+    """Pointer to a member of a struct held in a named variable, and its memory layout"""
+    if not isinstance(obj, Identifier):
+        return None
+    slot = named_value(builder, module, obj.name)
+    if slot is None or not isinstance(slot.type, ir.PointerType):
+        return None
+    struct_type = slot.type.pointee
+    # A pointer variable (like this) holds the struct's address rather than the struct
+    if isinstance(struct_type, ir.PointerType) and isinstance(struct_type.pointee, ir.BaseStructType):
+        slot = builder.load(slot, name=obj.name)
+        struct_type = struct_type.pointee
+    index = getattr(struct_type, 'member_index', {}).get(member) if isinstance(struct_type, ir.BaseStructType) else None
+    if index is None:
+        if not isinstance(struct_type, ir.BaseStructType) or not hasattr(struct_type, 'names'):
+            return None
+        raise ValueError(f"Member '{member}' not found in struct")
+    i32 = ir.IntType(32)
+    ptr = builder.gep(slot, [ir.Constant(i32, 0), ir.Constant(i32, index)],
+                      inbounds=True, name=f"{obj.name}.{member}")
+    layout = getattr(struct_type, 'layout', None)
+    return ptr, layout.memory.get(member) if layout is not None else None
+
+# ============ HEAP AND ARENAS ============
+# (void)x frees x now, wherever it lives: a stack variable ends its
+# lifetime and a pointer from malloc, calloc or realloc goes to free().
+# free() is only emitted when every store to the variable in its function
+# came from one of those (or was null) and its address never escaped;
+# (void) on a pointer of any other origin is an error, since passing a
+# parameter, a struct member or an interior pointer to free() is
+# undefined behaviour the compiler cannot rule out. Memory carved out of a
+# standard::memory arena belongs to the arena and comes back all at once
+# when the arena resets, so the front end remembers which slots hold
+# arena pointers and drops their (void) at compile time; pool blocks go
+# back onto their pool's free list. The allocators are builtins over the
+# arena and pool structs of memory.fx, so every call site gets the bump
+# inline, including in modules compiled separately.
+
+ADDRESS = ir.IntType(64)  # memory.fx keeps addresses as uint64
+ARENA_ALIGN = 16          # Bytes, what malloc guarantees on x86-64
+
+def pointer_to(llvm_type: ir.Type) -> ir.PointerType:
+    """Pointer to llvm_type; void* is i8* like in C"""
+    if isinstance(llvm_type, ir.VoidType):
+        return ir.IntType(8).as_pointer()
+    return llvm_type.as_pointer()
+
+def variable_slot(expr: 'Expression', builder: ir.IRBuilder, module: ir.Module) -> Optional[ir.Value]:
+    """The alloca or global a name refers to, or None if expr is not a named variable"""
+    if not isinstance(expr, Identifier):
+        return None
+    slot = named_value(builder, module, expr.name)
+    if slot is None or not isinstance(slot.type, ir.PointerType) or isinstance(slot, ir.Function):
+        return None
+    return slot
+
+def pointer_owner(expr: 'Expression', builder: ir.IRBuilder, module: ir.Module) -> Optional[Tuple[str, 'Expression']]:
+    """('arena' | 'pool', allocator) or ('heap', None) if expr is a pointer handed out by one, else None"""
+    if isinstance(expr, FunctionCall) and expr.name in ALLOCATING_BUILTINS and expr.arguments:
+        if module.globals.get(expr.name) is None:
+            return ALLOCATING_BUILTINS[expr.name], expr.arguments[0]
+    if isinstance(expr, FunctionCall) and expr.name in HEAP_ALLOCATORS:
+        callee = named_value(builder, module, expr.name)
+        if isinstance(callee, ir.Function) and callee.name == expr.name:
+            return 'heap', None
+    if isinstance(expr, Literal) and expr.value == 0:
+        return 'heap', None  # free(null) does nothing
+    if isinstance(expr, CastExpression):
+        return pointer_owner(expr.expression, builder, module)
+    slot = variable_slot(expr, builder, module)
+    if slot is not None:
+        return getattr(module, '_pointer_owners', {}).get(slot)
+    return None
+
+def mark_owner(module: ir.Module, slot: ir.Value, value: 'Expression', builder: ir.IRBuilder) -> None:
+    """Record which allocator, if any, owns the pointer just stored to slot"""
+    owner = pointer_owner(value, builder, module) if value is not None else None
+    if not hasattr(module, '_pointer_owners'):
+        module._pointer_owners = {}
+    if owner is None:
+        module._pointer_owners.pop(slot, None)
+    else:
+        module._pointer_owners[slot] = owner
+    if owner is None or owner[0] != 'heap':
+        escape_slot(module, slot)
+
+def escape_slot(module: ir.Module, slot: ir.Value) -> None:
+    """Note that slot may hold a pointer from somewhere other than the heap"""
+    if not hasattr(module, '_foreign_slots'):
+        module._foreign_slots = set()
+    module._foreign_slots.add(slot)
+
+def check_releases(module: ir.Module, func: ir.Function) -> None:
+    """Each free() a (void) emitted in func must see heap pointers on every path
+
+    Ownership is tracked in source order, so a branch or a loop's back edge
+    can bring another pointer to a (void) that saw a malloc'd one; only
+    once the whole body is generated is every store to the slot known.
+    """
+    foreign = getattr(module, '_foreign_slots', set())
+    for slot, name in getattr(func, '_heap_releases', []):
+        if slot in foreign:
+            raise ValueError(f"(void){name} in {func.name}: {name} does not always hold a pointer "
+                             f"from malloc, so it cannot be freed; call free() explicitly")
+
+def address_value(expr: 'Expression', builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+    """expr as a uint64 address: arrays by their first element, pointers by value"""
+    value = array_address(expr, builder, module)
+    if value is None:
+        value = expr.codegen(builder, module)
+    if isinstance(value.type, ir.PointerType):
+        return builder.ptrtoint(value, ADDRESS)
+    if isinstance(value.type, ir.IntType):
+        return coerce_int(builder, value, ADDRESS, signed=False)
+    raise ValueError(f"Expected an address, not {value.type}")
+
+def allocator_field(allocator: 'Expression', name: str, builder: ir.IRBuilder,
+                    module: ir.Module) -> Tuple[ir.Value, Optional[MemoryLayout]]:
+    address = member_address(allocator, name, builder, module)
+    if address is None:
+        raise ValueError(f"Expected an arena or pool variable, not {allocator}")
+    return address
+
+def load_field(builder: ir.IRBuilder, module: ir.Module, allocator: 'Expression', name: str) -> ir.Value:
+    ptr, layout = allocator_field(allocator, name, builder, module)
+    return coerce_int(builder, load_value(builder, module, ptr, layout, name=name), ADDRESS, signed=False)
+
+def store_field(builder: ir.IRBuilder, module: ir.Module, allocator: 'Expression', name: str, value: ir.Value) -> None:
+    ptr, layout = allocator_field(allocator, name, builder, module)
+    store_value(builder, module, coerce_int(builder, value, ptr.type.pointee, signed=False), ptr, layout)
+
+def align_up(builder: ir.IRBuilder, value: ir.Value, align: int) -> ir.Value:
+    return builder.and_(builder.add(value, ir.Constant(ADDRESS, align - 1)), ir.Constant(ADDRESS, -align))
+
+def bump(builder: ir.IRBuilder, module: ir.Module, allocator: 'Expression', cursor: ir.Value,
+         start: ir.Value, size: ir.Value) -> ir.Value:
+    """Move the cursor past size bytes at start if they fit below the limit; returns start, or 0 when full"""
+    limit = load_field(builder, module, allocator, 'limit')
+    # size <= limit - start, so a huge size cannot wrap around the limit
+    fits = builder.and_(builder.icmp_unsigned('<=', start, limit),
+                        builder.icmp_unsigned('<=', size, builder.sub(limit, start)))
+    store_field(builder, module, allocator, 'cursor', builder.select(fits, builder.add(start, size), cursor))
+    return builder.select(fits, start, ir.Constant(ADDRESS, 0))
+
+def arena_init(builder, module, arena, buffer, size):
+    """arena_init(a, buffer, size): carve a over size bytes at buffer"""
+    base = address_value(buffer, builder, module)
+    size = coerce_int(builder, size.codegen(builder, module), ADDRESS, signed=False)
+    store_field(builder, module, arena, 'base', base)
+    store_field(builder, module, arena, 'cursor', base)
+    store_field(builder, module, arena, 'limit', builder.add(base, size))
+    return None
+
+def arena_alloc(builder, module, arena, size):
+    """arena_alloc(a, size): size bytes aligned to ARENA_ALIGN, or null when the arena is full"""
+    size = coerce_int(builder, size.codegen(builder, module), ADDRESS, signed=False)
+    cursor = load_field(builder, module, arena, 'cursor')
+    start = align_up(builder, cursor, ARENA_ALIGN)
+    return builder.inttoptr(bump(builder, module, arena, cursor, start, size), ir.IntType(8).as_pointer())
+
+def arena_mark(builder, module, arena):
+    """arena_mark(a): the current position, for arena_release"""
+    return load_field(builder, module, arena, 'cursor')
+
+def arena_release(builder, module, arena, mark):
+    """arena_release(a, mark): free everything allocated since arena_mark returned mark"""
+    store_field(builder, module, arena, 'cursor', coerce_int(builder, mark.codegen(builder, module), ADDRESS, False))
+    return None
+
+def arena_reset(builder, module, arena):
+    """arena_reset(a): free everything in the arena at once"""
+    store_field(builder, module, arena, 'cursor', load_field(builder, module, arena, 'base'))
+    return None
+
+def pool_init(builder, module, pool, buffer, block_size, count):
+    """pool_init(p, buffer, block_size, count): count blocks of block_size bytes at buffer"""
+    base = address_value(buffer, builder, module)
+    # A free block holds the free list link, so blocks are whole words
+    block = align_up(builder, coerce_int(builder, block_size.codegen(builder, module), ADDRESS, False), 8)
+    block = builder.select(builder.icmp_unsigned('<', block, ir.Constant(ADDRESS, 8)), ir.Constant(ADDRESS, 8), block)
+    count = coerce_int(builder, count.codegen(builder, module), ADDRESS, signed=False)
+    store_field(builder, module, pool, 'block', block)
+    store_field(builder, module, pool, 'cursor', base)
+    store_field(builder, module, pool, 'limit', builder.add(base, builder.mul(block, count)))
+    store_field(builder, module, pool, 'free_list', ir.Constant(ADDRESS, 0))
+    return None
+
+def pool_alloc(builder, module, pool):
+    """pool_alloc(p): a freed block if there is one, else the next fresh one, or null when full"""
+    func = builder.block.function
+    pop_block = func.append_basic_block('pool.pop')
+    bump_block = func.append_basic_block('pool.bump')
+    done_block = func.append_basic_block('pool.done')
+    head = load_field(builder, module, pool, 'free_list')
+    builder.cbranch(builder.icmp_unsigned('!=', head, ir.Constant(ADDRESS, 0)), pop_block, bump_block)
+
+    builder.position_at_start(pop_block)
+    store_field(builder, module, pool, 'free_list', builder.load(builder.inttoptr(head, ADDRESS.as_pointer())))
+    builder.branch(done_block)
+
+    builder.position_at_start(bump_block)
+    cursor = load_field(builder, module, pool, 'cursor')
+    fresh = bump(builder, module, pool, cursor, cursor, load_field(builder, module, pool, 'block'))
+    bump_end = builder.block
+    builder.branch(done_block)
+
+    builder.position_at_start(done_block)
+    result = builder.phi(ADDRESS)
+    result.add_incoming(head, pop_block)
+    result.add_incoming(fresh, bump_end)
+    return builder.inttoptr(result, ir.IntType(8).as_pointer())
+
+def pool_free(builder, module, pool, ptr):
+    """pool_free(p, block): put a block from pool_alloc back on the free list"""
+    return push_block(builder, module, pool, ptr.codegen(builder, module))
+
+def push_block(builder: ir.IRBuilder, module: ir.Module, pool: 'Expression', block: ir.Value) -> None:
+    address = builder.ptrtoint(block, ADDRESS) if isinstance(block.type, ir.PointerType) else block
+    builder.store(load_field(builder, module, pool, 'free_list'), builder.inttoptr(address, ADDRESS.as_pointer()))
+    store_field(builder, module, pool, 'free_list', address)
+    return None
+
+# name -> (arity, lowering called with the unevaluated argument expressions)
+ARENA_BUILTINS = {
+    'arena_init': (3, arena_init),
+    'arena_alloc': (2, arena_alloc),
+    'arena_mark': (1, arena_mark),
+    'arena_release': (2, arena_release),
+    'arena_reset': (1, arena_reset),
+    'pool_init': (4, pool_init),
+    'pool_alloc': (1, pool_alloc),
+    'pool_free': (2, pool_free),
+}
+
+# Builtins returning memory that (void) must not pass to free()
+ALLOCATING_BUILTINS = {'arena_alloc': 'arena', 'pool_alloc': 'pool'}
+HEAP_ALLOCATORS = {'malloc', 'calloc', 'realloc', 'aligned_alloc'}  # libc, freed with free()
+
+def lifetime(builder: ir.IRBuilder, module: ir.Module, marker: str, slot: ir.AllocaInstr) -> None:
+    """llvm.lifetime.start/end over a whole stack slot"""
+    i8_ptr = ir.IntType(8).as_pointer()
+    intrinsic = module.declare_intrinsic(f'llvm.lifetime.{marker}', [i8_ptr],
+                                         ir.FunctionType(ir.VoidType(), [ir.IntType(64), i8_ptr]))
+    size = target_layout(module).alloc_size(slot.type.pointee)
+    builder.call(intrinsic, [ir.Constant(ir.IntType(64), size), builder.bitcast(slot, i8_ptr)])
+
+def release(expr: 'Expression', builder: ir.IRBuilder, module: ir.Module) -> None:
+    """(void)expr: give the memory behind expr back to wherever it came from"""
+    owner = pointer_owner(expr, builder, module)
+    if owner is not None:
+        kind, allocator = owner
+        if kind == 'pool':
+            push_block(builder, module, allocator, expr.codegen(builder, module))
+        if kind != 'heap':
+            return None  # Arena memory waits for the arena to reset
+
+    slot = variable_slot(expr, builder, module)
+    if isinstance(slot, ir.AllocaInstr) and not isinstance(slot.type.pointee, ir.PointerType):
+        # A stack variable: its slot is dead from here, and so is the name. An object ends first
+        if forget_object(builder, slot):
+            destroy(builder, module, slot)
+        lifetime(builder, module, 'end', slot)
+        del builder.scope[expr.name]
+        return None
+
+    value = expr.codegen(builder, module)
+    if not isinstance(value, ir.Value) or not isinstance(value.type, ir.PointerType):
+        # No storage of its own: evaluated for its effects
+        return None
+    if owner is None or (slot is not None and not isinstance(slot, ir.AllocaInstr)):
+        raise ValueError(f"(void) cannot tell where this {value.type} came from; only a local "
+                         f"holding a pointer from malloc, calloc or realloc can be freed")
+    i8_ptr = ir.IntType(8).as_pointer()
+    free = module.globals.get('free')
+    if free is None:
+        free = ir.Function(module, ir.FunctionType(ir.VoidType(), [i8_ptr]), 'free')
+    builder.call(free, [builder.bitcast(value, free.args[0].type)])
+    if slot is not None:
+        func = builder.function
+        func._heap_releases = getattr(func, '_heap_releases', []) + [(slot, expr.name)]
+    return None
+
+def convert_value(builder: ir.IRBuilder, value: ir.Value, llvm_type: ir.Type, signed: bool = True) -> ir.Value:
+    """An explicit (type)value cast"""
+    source = value.type
+    if source == llvm_type:
+        return value
+    if isinstance(lane_type(source), ir.IntType) and isinstance(lane_type(llvm_type), ir.IntType):
+        return coerce_int(builder, value, llvm_type, signed)
+    if isinstance(lane_type(source), ir.IntType) and is_float_type(llvm_type):
+        if isinstance(llvm_type, ir.VectorType) and not isinstance(source, ir.VectorType):
+            return splat(builder, value, llvm_type, signed)
+        return int_to_float(builder, value, llvm_type, signed)
+    if is_float_type(source) and isinstance(lane_type(llvm_type), ir.IntType):
+        return builder.fptosi(value, llvm_type) if signed else builder.fptoui(value, llvm_type)
+    if is_float_type(source) and is_float_type(llvm_type):
+        if constant_float(value) is not None and not isinstance(llvm_type, ir.VectorType):
+            folded = float_constant(llvm_type, constant_float(value))
+            if folded is not None:
+                return folded
+        widen = isinstance(lane_type(llvm_type), ir.DoubleType)
+        return builder.fpext(value, llvm_type) if widen else builder.fptrunc(value, llvm_type)
+    if isinstance(source, ir.PointerType) and isinstance(llvm_type, ir.PointerType):
+        return builder.bitcast(value, llvm_type)
+    if isinstance(source, ir.PointerType) and isinstance(llvm_type, ir.IntType):
+        return builder.ptrtoint(value, llvm_type)
+    if isinstance(source, ir.IntType) and isinstance(llvm_type, ir.PointerType):
+        return builder.inttoptr(value, llvm_type)
+    if isinstance(source, ir.VectorType) or isinstance(llvm_type, ir.VectorType):
+        # Same bits, different lanes: uint32<4> to uint8<16>
+        return builder.bitcast(value, llvm_type)
+    raise ValueError(f"Cannot cast {source} to {llvm_type}")
+
+# ============ OBJECTS ============
+# An object is a struct whose methods are functions named Object__method
+# taking the object's address as this. A local instance runs __init when
+# it is declared and __exit when the block that declared it ends, on
+# every way out of the block except unwinding.
+
+def object_method(module: ir.Module, object_type: ir.Type, name: str) -> Optional[ir.Function]:
+    if not isinstance(object_type, ir.IdentifiedStructType):
+        return None
+    method = module.globals.get(f"{object_type.name}__{name}")
+    return method if isinstance(method, ir.Function) else None
+
+def object_address(expr: 'Expression', builder: ir.IRBuilder, module: ir.Module) -> Optional[ir.Value]:
+    """Pointer to the object expr names: its own storage, or the address a pointer to it (like this) holds"""
+    if isinstance(expr, MemberAccess):
+        address = member_address(expr.object, expr.member, builder, module)
+        ptr = address[0] if address is not None else None
+    else:
+        ptr = variable_slot(expr, builder, module)
+    if ptr is None:
+        ptr = expr.codegen(builder, module)
+    elif isinstance(ptr.type.pointee, ir.PointerType):
+        ptr = builder.load(ptr, name=getattr(expr, 'name', None) or '')
+    if isinstance(ptr.type, ir.PointerType) and isinstance(ptr.type.pointee, ir.IdentifiedStructType):
+        return ptr
+    return None
+
+def is_string_literal(expr: 'Expression') -> bool:
+    # The parser types "text" like 'c', as a char holding the whole string
+    return isinstance(expr, Literal) and expr.type == DataType.CHAR and isinstance(expr.value, str)
+
+def call_arguments(builder: ir.IRBuilder, module: ir.Module, func: ir.Function,
+                   arguments: List['Expression'], this: Optional[ir.Value] = None) -> List[ir.Value]:
+    """arguments evaluated and converted to func's parameter types, after this for a method"""
+    values = [] if this is None else [this]
+    params = list(func.function_type.args[len(values):])
+    if len(arguments) != len(params) and not (func.function_type.var_arg and len(arguments) > len(params)):
+        raise ValueError(f"{func.name} takes {len(params)} arguments, got {len(arguments)}")
+    for i, arg in enumerate(arguments):
+        if i < len(params) and params[i] == ir.IntType(8).as_pointer() and is_string_literal(arg):
+            # "text" for a uint8* parameter is the address of a null-terminated copy
+            values.append(c_string(module, arg.value, module.get_unique_name('str')))
+            continue
+        value = arg.codegen(builder, module)
+        param = params[i] if i < len(params) else value.type  # Variadic arguments pass as they are
+        # Any pointer, a function pointer included, passes as void*
+        if value.type != param and isinstance(value.type, ir.PointerType) and isinstance(param, ir.PointerType):
+            value = builder.bitcast(value, param)
+        # Integers convert to the parameter's width, like in an assignment
+        elif value.type != param and isinstance(value.type, ir.IntType) and isinstance(param, ir.IntType):
+            value = coerce_int(builder, value, param, signed=not is_unsigned(arg, builder, module))
+        values.append(value)
+    return values
+
+def construct(builder: ir.IRBuilder, module: ir.Module, slot: ir.AllocaInstr, arguments: List['Expression']) -> None:
+    """Run the object's __init on the fresh instance in slot, and schedule its __exit for the end of the block"""
+    object_type = slot.type.pointee
+    init = object_method(module, object_type, '__init')
+    if init is not None:
+        emit_call(builder, init, call_arguments(builder, module, init, arguments, this=slot))
+    elif arguments:
+        raise ValueError(f"{object_type.name} has no __init to take {len(arguments)} arguments")
+    if object_method(module, object_type, '__exit') is not None:
+        builder.scope.objects.append(slot)
+
+def destroy(builder: ir.IRBuilder, module: ir.Module, slot: ir.Value) -> None:
+    emit_call(builder, object_method(module, slot.type.pointee, '__exit'), [slot])
+
+def leave_scopes(builder: ir.IRBuilder, module: ir.Module, outer: Optional[Scope], keep: Optional[ir.Value] = None) -> None:
+    """__exit, latest first, for the instances of every block from the current one out to outer (not included)"""
+    scope = builder.scope
+    while scope is not None and scope is not outer:
+        for slot in reversed(scope.objects):
+            if slot is not keep:
+                destroy(builder, module, slot)
+        scope = scope.parent
+
+def forget_object(builder: ir.IRBuilder, slot: ir.Value) -> bool:
+    """Stop slot's __exit from running when its block ends; False if none was scheduled"""
+    scope = builder.scope
+    while scope is not None:
+        if slot in scope.objects:
+            scope.objects.remove(slot)
+            return True
+        scope = scope.parent
+    return False
 
 # Literal values (no dependencies)
 @dataclass
@@ -119,21 +1378,36 @@ class Identifier(ASTNode):
     name: str
 
     def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
-        # Look up the name in the current scope
-        if self.name in builder.scope:
-            ptr = builder.scope[self.name]
+        # Look up the name in the enclosing blocks
+        ptr = builder.scope.get(self.name) if builder.scope is not None else None
+        if ptr is not None:
             # Load the value if it's a pointer type
             if isinstance(ptr.type, ir.PointerType):
-                return builder.load(ptr, name=self.name)
+                return load_value(builder, module, ptr, slot_layout(module, ptr), name=self.name)
             return ptr
-        
+        return self.global_value(builder, module, symbols(module).resolve(self.name))
+
+    def global_value(self, builder: ir.IRBuilder, module: ir.Module, name: str) -> ir.Value:
+        """The module-level definition emitted as name"""
+        # A const global is its value; tables stay in memory and are indexed in place
+        constant = getattr(module, '_constants', {}).get(name)
+        if constant is not None and not isinstance(constant.type, (ir.ArrayType, ir.BaseStructType)):
+            return constant
+
         # Check for global variables
-        if self.name in module.globals:
-            return module.globals[self.name]
+        gvar = module.globals.get(name)
+        if gvar is not None:
+            if isinstance(gvar, ir.GlobalVariable) and not isinstance(gvar.type.pointee, (ir.ArrayType, ir.BaseStructType)):
+                if builder.block is None:
+                    raise ValueError(f"'{self.name}' is not a compile-time constant")
+                return load_value(builder, module, gvar, slot_layout(module, gvar), name=self.name)
+            if isinstance(gvar, ir.Function):
+                mark_escaped(module, gvar)
+            return gvar
         
         # Check if this is a custom type
-        if hasattr(module, '_type_aliases') and self.name in module._type_aliases:
-            return module._type_aliases[self.name]
+        if hasattr(module, '_type_aliases') and name in module._type_aliases:
+            return module._type_aliases[name]
             
         raise NameError(f"Unknown identifier: {self.name}")
 
@@ -149,16 +1423,21 @@ class TypeSpec(ASTNode):
     is_array: bool = False
     array_size: Optional[int] = None
     is_pointer: bool = False
+    endianness: Optional[int] = None  # data{bits:align:endian}: 0 little, 1 big, None native
+    vector_lanes: Optional[int] = None  # uint32<4>: a SIMD vector of four uint32 lanes
 
 
     def get_llvm_type(self, module: ir.Module) -> ir.Type:  # Renamed from get_llvm_type
         if hasattr(module, '_union_types') and self.base_type in module._union_types:
             return module._union_types[self.base_type]
         if isinstance(self.base_type, str):
+            struct_type = named_struct(module, self.base_type)
+            if struct_type is not None:
+                return struct_type
             # Handle custom types (like i64)
             if hasattr(module, '_type_aliases') and self.base_type in module._type_aliases:
                 return module._type_aliases[self.base_type]
-            return ir.IntType(32)  # Default fallback
+            raise ValueError(f"Unknown type: {self.base_type}")
         
         if self.base_type == DataType.INT:
             return ir.IntType(32)
@@ -195,11 +1474,13 @@ class TypeSpec(ASTNode):
     def get_llvm_type_with_array(self, module: ir.Module) -> ir.Type:
         """Get LLVM type with array support"""
         base_type = self.get_llvm_type(module)
+        if self.vector_lanes:
+            base_type = vector_type(base_type, self.vector_lanes)
         
         if self.is_array and self.array_size:
             return ir.ArrayType(base_type, self.array_size)
         elif self.is_pointer:
-            return ir.PointerType(base_type)
+            return pointer_to(base_type)
         else:
             return base_type
 
@@ -215,7 +1496,7 @@ class Expression(ASTNode):
 
 @dataclass
 class QualifiedName(Expression):
-    """Represents qualified names with super:: or virtual:: or super::virtual:: for objects or structs"""
+    """namespace::name (qualifiers holds every part), or super:: / virtual:: for objects or structs"""
     qualifiers: List[str]
     member: Optional[str] = None
     
@@ -225,6 +1506,85 @@ class QualifiedName(Expression):
             return f"{qual_str}.{self.member}"
         return qual_str
 
+    def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        name = symbols(module).resolve_qualified(self.qualifiers[:-1], self.qualifiers[-1])
+        return Identifier(str(self)).global_value(builder, module, name)
+
+def integer_power(module: ir.Module, int_type: ir.IntType, unsigned: bool) -> ir.Function:
+    """
+    base ^ exponent by squaring, one internal function per type that the
+    inliner folds into its callers. A negative signed exponent gives
+    1 / base^-exponent truncated toward zero: 1 for base 1, +-1 for base
+    -1 and 0 otherwise.
+    """
+    name = f"__flux_{'u' if unsigned else 'i'}pow.i{int_type.width}"
+    func = module.globals.get(name)
+    if func is not None:
+        return func
+    func = ir.Function(module, ir.FunctionType(int_type, [int_type, int_type]), name)
+    func.linkage = 'internal'
+    base, exponent = func.args
+    one, zero = ir.Constant(int_type, 1), ir.Constant(int_type, 0)
+    entry = func.append_basic_block('entry')
+    loop = func.append_basic_block('loop')
+    body = func.append_basic_block('body')
+    done = func.append_basic_block('done')
+    builder = ir.IRBuilder(entry)
+    if unsigned:
+        builder.branch(loop)
+    else:
+        negative = func.append_basic_block('negative')
+        builder.cbranch(builder.icmp_signed('<', exponent, zero), negative, loop)
+        builder.position_at_end(negative)
+        odd = builder.trunc(exponent, ir.IntType(1))
+        minus_one = builder.select(odd, ir.Constant(int_type, -1), one)
+        result = builder.select(builder.icmp_signed('==', base, ir.Constant(int_type, -1)), minus_one, zero)
+        builder.ret(builder.select(builder.icmp_signed('==', base, one), one, result))
+
+    builder.position_at_end(loop)
+    result = builder.phi(int_type)
+    factor = builder.phi(int_type)
+    remaining = builder.phi(int_type)
+    builder.cbranch(builder.icmp_unsigned('==', remaining, zero), done, body)
+
+    builder.position_at_end(body)
+    odd = builder.icmp_unsigned('!=', builder.and_(remaining, one), zero)
+    next_result = builder.select(odd, builder.mul(result, factor), result)
+    next_factor = builder.mul(factor, factor)
+    next_remaining = builder.lshr(remaining, one)
+    builder.branch(loop)
+    result.add_incoming(one, entry)
+    result.add_incoming(next_result, body)
+    factor.add_incoming(base, entry)
+    factor.add_incoming(next_factor, body)
+    remaining.add_incoming(exponent, entry)
+    remaining.add_incoming(next_remaining, body)
+
+    builder.position_at_end(done)
+    builder.ret(result)
+    add_function_attribute(func, 'nounwind')
+    return func
+
+def power(builder: ir.IRBuilder, module: ir.Module, base: ir.Value, exponent: ir.Value, unsigned: bool) -> ir.Value:
+    """base ^ exponent for operands BinaryOp has already brought to one type"""
+    if isinstance(base.type, ir.VectorType):
+        raise ValueError("^ is not defined on vectors")
+    if is_float_type(base.type):
+        fnty = ir.FunctionType(base.type, [base.type, base.type])
+        return builder.call(module.declare_intrinsic('llvm.pow', [base.type], fnty), [base, exponent])
+    n = constant_int(exponent)
+    if n is not None and (unsigned or _signed(n, base.type.width) >= 0):
+        # x ^ 2 is x * x: square and multiply over the exponent's bits
+        result, factor = None, base
+        while n:
+            if n & 1:
+                result = factor if result is None else builder.mul(result, factor)
+            n >>= 1
+            if n:
+                factor = builder.mul(factor, factor)
+        return result if result is not None else ir.Constant(base.type, 1)
+    return builder.call(integer_power(module, base.type, unsigned), [base, exponent])
+
 @dataclass
 class BinaryOp(Expression):
     left: Expression
@@ -235,68 +1595,99 @@ class BinaryOp(Expression):
     def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
         left_val = self.left.codegen(builder, module)
         right_val = self.right.codegen(builder, module)
+        left_unsigned = is_unsigned(self.left, builder, module)
+        right_unsigned = is_unsigned(self.right, builder, module)
+        left_lane, right_lane = lane_type(left_val.type), lane_type(right_val.type)
+        if isinstance(left_lane, ir.IntType) and isinstance(right_lane, ir.IntType):
+            unsigned = common_unsigned(left_lane.width, left_unsigned, right_lane.width, right_unsigned)
+        else:
+            unsigned = left_unsigned or right_unsigned
+
+        folded = fold_binary(self.operator, left_val, right_val, left_unsigned, right_unsigned)
+        if folded is not None:
+            return folded
         
         # Ensure types match by casting if necessary
-        if left_val.type != right_val.type:
+        if isinstance(left_val.type, ir.VectorType) or isinstance(right_val.type, ir.VectorType):
+            left_val, right_val = vector_operands(builder, left_val, right_val, left_unsigned, right_unsigned)
+        elif left_val.type != right_val.type:
             if isinstance(left_val.type, ir.IntType) and isinstance(right_val.type, ir.IntType):
-                # Promote to the wider type
+                # Promote to the wider type, extending by the narrower operand's own signedness
                 if left_val.type.width > right_val.type.width:
-                    right_val = builder.zext(right_val, left_val.type)
+                    right_val = coerce_int(builder, right_val, left_val.type, signed=not right_unsigned)
                 else:
-                    left_val = builder.zext(left_val, right_val.type)
+                    left_val = coerce_int(builder, left_val, right_val.type, signed=not left_unsigned)
             elif isinstance(left_val.type, ir.FloatType) and isinstance(right_val.type, ir.IntType):
-                right_val = builder.sitofp(right_val, left_val.type)
+                right_val = int_to_float(builder, right_val, left_val.type, signed=not right_unsigned)
             elif isinstance(left_val.type, ir.IntType) and isinstance(right_val.type, ir.FloatType):
-                left_val = builder.sitofp(left_val, right_val.type)
+                left_val = int_to_float(builder, left_val, right_val.type, signed=not left_unsigned)
+        float_op = is_float_type(left_val.type)
         
         if self.operator == Operator.ADD:
-            if isinstance(left_val.type, ir.FloatType):
+            if float_op:
                 return builder.fadd(left_val, right_val)
             else:
                 return builder.add(left_val, right_val)
         elif self.operator == Operator.SUB:
-            if isinstance(left_val.type, ir.FloatType):
+            if float_op:
                 return builder.fsub(left_val, right_val)
             else:
                 return builder.sub(left_val, right_val)
         elif self.operator == Operator.MUL:
-            if isinstance(left_val.type, ir.FloatType):
+            if float_op:
                 return builder.fmul(left_val, right_val)
             else:
                 return builder.mul(left_val, right_val)
         elif self.operator == Operator.DIV:
-            if isinstance(left_val.type, ir.FloatType):
+            if float_op:
                 return builder.fdiv(left_val, right_val)
+            elif unsigned:
+                return builder.udiv(left_val, right_val)
             else:
                 return builder.sdiv(left_val, right_val)
+        elif self.operator == Operator.MOD:
+            if float_op:
+                return builder.frem(left_val, right_val)
+            elif unsigned:
+                return builder.urem(left_val, right_val)
+            else:
+                return builder.srem(left_val, right_val)
         elif self.operator == Operator.EQUAL:
-            if isinstance(left_val.type, ir.FloatType):
+            if float_op:
                 return builder.fcmp_ordered('==', left_val, right_val)
             else:
                 return builder.icmp_signed('==', left_val, right_val)
         elif self.operator == Operator.NOT_EQUAL:
-            if isinstance(left_val.type, ir.FloatType):
+            if float_op:
                 return builder.fcmp_ordered('!=', left_val, right_val)
             else:
                 return builder.icmp_signed('!=', left_val, right_val)
         elif self.operator == Operator.LESS_THAN:
-            if isinstance(left_val.type, ir.FloatType):
+            if float_op:
                 return builder.fcmp_ordered('<', left_val, right_val)
+            elif unsigned:
+                return builder.icmp_unsigned('<', left_val, right_val)
             else:
                 return builder.icmp_signed('<', left_val, right_val)
         elif self.operator == Operator.LESS_EQUAL:
-            if isinstance(left_val.type, ir.FloatType):
+            if float_op:
                 return builder.fcmp_ordered('<=', left_val, right_val)
+            elif unsigned:
+                return builder.icmp_unsigned('<=', left_val, right_val)
             else:
                 return builder.icmp_signed('<=', left_val, right_val)
         elif self.operator == Operator.GREATER_THAN:
-            if isinstance(left_val.type, ir.FloatType):
+            if float_op:
                 return builder.fcmp_ordered('>', left_val, right_val)
+            elif unsigned:
+                return builder.icmp_unsigned('>', left_val, right_val)
             else:
                 return builder.icmp_signed('>', left_val, right_val)
         elif self.operator == Operator.GREATER_EQUAL:
-            if isinstance(left_val.type, ir.FloatType):
+            if float_op:
                 return builder.fcmp_ordered('>=', left_val, right_val)
+            elif unsigned:
+                return builder.icmp_unsigned('>=', left_val, right_val)
             else:
                 return builder.icmp_signed('>=', left_val, right_val)
         elif self.operator == Operator.AND:
@@ -305,6 +1696,17 @@ class BinaryOp(Expression):
             return builder.or_(left_val, right_val)
         elif self.operator == Operator.XOR:
             return builder.xor(left_val, right_val)
+        elif self.operator == Operator.BITSHIFT_LEFT:
+            return builder.shl(left_val, right_val)
+        elif self.operator == Operator.BITSHIFT_RIGHT:
+            # Only the shifted value's signedness matters
+            if left_unsigned:
+                return builder.lshr(left_val, right_val)
+            return builder.ashr(left_val, right_val)
+        elif self.operator in (Operator.ROTATE_LEFT, Operator.ROTATE_RIGHT):
+            return rotate(builder, module, left_val, right_val, self.operator == Operator.ROTATE_LEFT)
+        elif self.operator == Operator.POWER:
+            return power(builder, module, left_val, right_val, unsigned)
         else:
             raise ValueError(f"Unsupported operator: {self.operator}")
 
@@ -316,47 +1718,154 @@ class UnaryOp(Expression):
 
     def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
         operand_val = self.operand.codegen(builder, module)
+        folded = fold_unary(self.operator, operand_val)
+        if folded is not None:
+            return folded
         
         if self.operator == Operator.NOT:
+            if isinstance(operand_val.type, ir.VectorType):
+                # Lane-wise: the mask of lanes that are zero
+                zero = ir.Constant(operand_val.type, zero_constant(operand_val.type.element))
+                if is_float_type(operand_val.type):
+                    return builder.fcmp_ordered('==', operand_val, zero)
+                return builder.icmp_unsigned('==', operand_val, zero)
+            # Logical not: any non-zero integer is true
+            return builder.not_(truth_value(builder, operand_val))
+        elif self.operator == Operator.BITWISE_NOT:
             return builder.not_(operand_val)
         elif self.operator == Operator.SUB:
+            if is_float_type(operand_val.type):
+                # -0.0 - x flips the sign of zero too, where 0.0 - x would not
+                return builder.fsub(ir.Constant(operand_val.type, -0.0), operand_val)
             return builder.neg(operand_val)
         elif self.operator == Operator.INCREMENT:
             # Handle both prefix and postfix increment
             one = ir.Constant(operand_val.type, 1)
             new_val = builder.add(operand_val, one)
-            if isinstance(self.operand, Identifier):
-                builder.scope[self.operand.name] = new_val
+            self._store_back(builder, module, new_val)
             return new_val if not self.is_postfix else operand_val
         elif self.operator == Operator.DECREMENT:
             # Handle both prefix and postfix decrement
             one = ir.Constant(operand_val.type, 1)
             new_val = builder.sub(operand_val, one)
-            if isinstance(self.operand, Identifier):
-                builder.scope[self.operand.name] = new_val
+            self._store_back(builder, module, new_val)
             return new_val if not self.is_postfix else operand_val
         else:
             raise ValueError(f"Unsupported unary operator: {self.operator}")
 
+    def _store_back(self, builder: ir.IRBuilder, module: ir.Module, new_val: ir.Value) -> None:
+        """Write ++/-- results to the variable's stack slot so loops see the update"""
+        if not isinstance(self.operand, Identifier):
+            return
+        slot = builder.scope.get(self.operand.name)
+        if slot is None and isinstance(module.globals.get(self.operand.name), ir.GlobalVariable):
+            slot = module.globals[self.operand.name]
+        if slot is not None and isinstance(slot.type, ir.PointerType):
+            store_value(builder, module, new_val, slot, slot_layout(module, slot))
+        else:
+            builder.scope[self.operand.name] = new_val
+
+@dataclass
+class RangeExpression(Expression):
+    """Inclusive integer range start..end, lowered by ForInLoop as a counted loop"""
+    start: Expression
+    end: Expression
+
 @dataclass
 class CastExpression(Expression):
     target_type: TypeSpec
     expression: Expression
 
+    def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> Optional[ir.Value]:
+        if self.target_type.base_type == DataType.VOID and not self.target_type.is_pointer:
+            return release(self.expression, builder, module)
+        value = self.expression.codegen(builder, module)
+        target = self.target_type.get_llvm_type_with_array(module)
+        return convert_value(builder, value, target, not is_unsigned(self.expression, builder, module))
+
 @dataclass
 class FunctionCall(Expression):
     name: str
     arguments: List[Expression] = field(default_factory=list)
+    qualifiers: List[str] = field(default_factory=list)  # Namespace path of ns::name(...)
 
     def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
         # Look up the function in the module
-        func = module.globals.get(self.name, None)
+        table = symbols(module)
+        name = table.resolve_qualified(self.qualifiers, self.name) if self.qualifiers else table.resolve(self.name)
+        func = module.globals.get(name, None)
         if func is None or not isinstance(func, ir.Function):
+            if self.qualifiers:
+                raise NameError(f"Unknown function: {'::'.join(self.qualifiers)}::{self.name}")
+            # A user-defined function of the same name takes precedence over the builtin
+            if self.name in BIT_BUILTINS:
+                return self._bit_builtin(builder, module)
+            if self.name in VECTOR_BUILTINS:
+                return self._vector_builtin(builder, module)
+            if self.name in ARENA_BUILTINS:
+                arity, lower = ARENA_BUILTINS[self.name]
+                if len(self.arguments) != arity:
+                    raise ValueError(f"{self.name} takes {arity} argument{'s' if arity > 1 else ''}, got {len(self.arguments)}")
+                return lower(builder, module, *self.arguments)
             raise NameError(f"Unknown function: {self.name}")
         
-        # Generate code for arguments
-        arg_vals = [arg.codegen(builder, module) for arg in self.arguments]
-        return builder.call(func, arg_vals)
+        return emit_call(builder, func, call_arguments(builder, module, func, self.arguments))
+
+    def _bit_builtin(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        arity, lower = BIT_BUILTINS[self.name]
+        if len(self.arguments) != arity:
+            raise ValueError(f"{self.name} takes {arity} argument{'s' if arity > 1 else ''}, got {len(self.arguments)}")
+        value = self.arguments[0].codegen(builder, module)
+        if not isinstance(lane_type(value.type), ir.IntType):
+            raise ValueError(f"{self.name} needs an integer, not {value.type}")
+        args = [value]
+        for arg in self.arguments[1:]:
+            args.append(coerce_int(builder, arg.codegen(builder, module), value.type, signed=False))
+        folded = fold_bit_builtin(self.name, args)
+        if folded is not None:
+            return folded
+        return lower(builder, module, *args)
+
+    def _vector_builtin(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        counts = VECTOR_BUILTINS[self.name]
+        if len(self.arguments) not in counts:
+            raise ValueError(f"{self.name} takes {' or '.join(map(str, counts))} arguments, got {len(self.arguments)}")
+        if self.name == 'shuffle':
+            return self._shuffle(builder, module)
+        vector = self.arguments[0].codegen(builder, module)
+        if not isinstance(vector.type, ir.VectorType):
+            raise ValueError(f"{self.name} needs a vector, not {vector.type}")
+        if self.name in VECTOR_REDUCTIONS:
+            return reduce_vector(builder, module, self.name, vector, is_unsigned(self.arguments[0], builder, module))
+
+        index = coerce_int(builder, self.arguments[1].codegen(builder, module), ir.IntType(32), signed=False)
+        if self.name == 'extract_lane':
+            return extract_lane(builder, vector, index)
+        lane = constant_int(index)
+        if lane is not None and lane >= vector.type.count:
+            raise ValueError(f"Lane {lane} is out of range for {vector.type}")
+        value = convert_lane(builder, self.arguments[2].codegen(builder, module), vector.type.element,
+                             not is_unsigned(self.arguments[2], builder, module))
+        return builder.insert_element(vector, value, index)
+
+    def _shuffle(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        *sources, lanes = self.arguments
+        if not (isinstance(lanes, Literal) and isinstance(lanes.value, list)):
+            raise ValueError("shuffle takes its lane selection as a list of constants, e.g. [3, 2, 1, 0]")
+        first = sources[0].codegen(builder, module)
+        if not isinstance(first.type, ir.VectorType):
+            raise ValueError(f"shuffle needs a vector, not {first.type}")
+        second = sources[1].codegen(builder, module) if len(sources) > 1 else ir.Constant(first.type, ir.Undefined)
+        if second.type != first.type:
+            raise ValueError(f"shuffle of {first.type} and {second.type}")
+        limit = first.type.count * len(sources)
+        indices = []
+        for item in lanes.value:
+            index = constant_int(item.codegen(builder, module))
+            if index is None or index >= limit:
+                raise ValueError(f"shuffle lanes must be constants below {limit}")
+            indices.append(index)
+        return builder.shuffle_vector(first, second, lane_mask(indices))
 
 @dataclass
 class MemberAccess(Expression):
@@ -367,39 +1876,39 @@ class MemberAccess(Expression):
         # Handle static struct member access (A.x where A is a struct type)
         if isinstance(self.object, Identifier):
             struct_name = self.object.name
-            if hasattr(module, '_struct_types') and struct_name in module._struct_types:
+            if named_struct(module, struct_name) is not None:
                 # Look for the global variable representing this member
-                global_name = f"{struct_name}.{self.member}"
-                for global_var in module.global_values:
-                    if global_var.name == global_name:
-                        return builder.load(global_var)
+                global_var = module.globals.get(f"{symbols(module).resolve(struct_name)}.{self.member}")
+                if global_var is not None:
+                    return builder.load(global_var)
                 
                 raise NameError(f"Static member '{self.member}' not found in struct '{struct_name}'")
         
         # Handle regular member access (obj.x where obj is an instance)
-        obj_val = self.object.codegen(builder, module)
-        
-        if isinstance(obj_val.type, ir.PointerType):
-            # Handle pointer to struct
-            if isinstance(obj_val.type.pointee, ir.LiteralStructType):
-                struct_type = obj_val.type.pointee
-                if not hasattr(struct_type, 'names'):
-                    raise ValueError("Struct type missing member names")
-                
-                try:
-                    member_index = struct_type.names.index(self.member)
-                except ValueError:
-                    raise ValueError(f"Member '{self.member}' not found in struct")
-                
-                member_ptr = builder.gep(
-                    obj_val,
-                    [ir.Constant(ir.IntType(32)), 0],
-                    [ir.Constant(ir.IntType(32)), member_index],
-                    inbounds=True
-                )
-                return builder.load(member_ptr)
+        address = member_address(self.object, self.member, builder, module)
+        if address is not None:
+            member_ptr, layout = address
+            return load_value(builder, module, member_ptr, layout, name=self.member)
         
-        raise ValueError(f"Member access on unsupported type: {obj_val.type}")
+        raise ValueError(f"Member access on unsupported value: {self.object}")
+
+@dataclass
+class MethodCall(Expression):
+    """obj.method(args): the object's method, called with the object's address as this"""
+    object: Expression
+    method: str
+    arguments: List[Expression] = field(default_factory=list)
+
+    def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        this = object_address(self.object, builder, module)
+        if this is None:
+            raise ValueError(f"{self.method}() called on something that is not an object")
+        func = object_method(module, this.type.pointee, self.method)
+        if func is None:
+            raise NameError(f"{this.type.pointee.name} has no method {self.method}")
+        if self.method == '__exit':
+            forget_object(builder, this)  # Ended by hand, so not again with its block
+        return emit_call(builder, func, call_arguments(builder, module, func, self.arguments, this=this))
 
 @dataclass
 class ArrayAccess(Expression):
@@ -407,46 +1916,155 @@ class ArrayAccess(Expression):
     index: Expression
     
     def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        index_val = self.index.codegen(builder, module)
+        element = self._constant_element(builder, module, index_val)
+        if element is not None:
+            return element
+
+        # Index named arrays in place rather than loading the whole aggregate
+        array_ptr = array_address(self.array, builder, module)
+        if array_ptr is not None:
+            zero = ir.Constant(ir.IntType(32), 0)
+            gep = builder.gep(array_ptr, [zero, index_val], name="array_gep")
+            return load_value(builder, module, gep, slot_layout(module, array_ptr), name="array_load")
+
         # Get the array (should be a pointer to array or global)
         array_val = self.array.codegen(builder, module)
-        index_val = self.index.codegen(builder, module)
+        if isinstance(array_val.type, ir.VectorType):
+            return extract_lane(builder, array_val, index_val)
         
         # Handle global arrays (like const arrays)
         if isinstance(array_val, ir.GlobalVariable):
             # Create GEP to access array element
             zero = ir.Constant(ir.IntType(32), 0)
             gep = builder.gep(array_val, [zero, index_val], name="array_gep")
-            return builder.load(gep, name="array_load")
+            return load_value(builder, module, gep, slot_layout(module, array_val), name="array_load")
         # Handle local arrays
         elif isinstance(array_val.type, ir.PointerType) and isinstance(array_val.type.pointee, ir.ArrayType):
             zero = ir.Constant(ir.IntType(32), 0)
             gep = builder.gep(array_val, [zero, index_val], name="array_gep")
-            return builder.load(gep, name="array_load")
+            return load_value(builder, module, gep, slot_layout(module, array_val), name="array_load")
+        # Through a pointer: p[i] is the element i places past p
+        elif isinstance(array_val.type, ir.PointerType):
+            return builder.load(builder.gep(array_val, [index_val], name="element"), name="element_load")
         else:
             raise ValueError(f"Cannot access array element for type: {array_val.type}")
 
+    def address(self, builder: ir.IRBuilder, module: ir.Module) -> Optional[Tuple[ir.Value, Optional[MemoryLayout]]]:
+        """Pointer to the element, in a named array or past a pointer, and its memory layout"""
+        array_ptr = array_address(self.array, builder, module)
+        if array_ptr is not None:
+            zero = ir.Constant(ir.IntType(32), 0)
+            index = self.index.codegen(builder, module)
+            return builder.gep(array_ptr, [zero, index], name="array_gep"), slot_layout(module, array_ptr)
+        base = self.array.codegen(builder, module)
+        if isinstance(base, ir.Value) and isinstance(base.type, ir.PointerType) and not isinstance(base.type.pointee, ir.ArrayType):
+            return builder.gep(base, [self.index.codegen(builder, module)], name="element"), None
+        return None
+
+    def _constant_element(self, builder: ir.IRBuilder, module: ir.Module, index_val: ir.Value) -> Optional[ir.Constant]:
+        """A const table indexed by a constant reads the element at compile time"""
+        if not isinstance(self.array, Identifier) or (builder.scope is not None and self.array.name in builder.scope):
+            return None
+        table = getattr(module, '_constants', {}).get(self.array.name)
+        index = constant_int(index_val)
+        if table is None or index is None or not isinstance(table.type, (ir.ArrayType, ir.VectorType)):
+            return None
+        if index >= table.type.count:
+            raise ValueError(f"Index {index} is out of bounds for {self.array.name}[{table.type.count}]")
+        return table.constant[index]
+
 @dataclass
 class PointerDeref(Expression):
     pointer: Expression
 
+    def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        return builder.load(self.address(builder, module), name="deref")
+
+    def address(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        ptr = self.pointer.codegen(builder, module)
+        if not isinstance(ptr, ir.Value) or not isinstance(ptr.type, ir.PointerType):
+            raise ValueError(f"Cannot dereference {getattr(ptr, 'type', ptr)}")
+        return ptr
+
 @dataclass
 class AddressOf(Expression):
     expression: Expression
 
+    def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        slot = variable_slot(self.expression, builder, module)
+        if slot is not None:
+            escape_slot(module, slot)  # Whatever the address reaches may store through it
+            return slot
+        if isinstance(self.expression, MemberAccess):
+            address = member_address(self.expression.object, self.expression.member, builder, module)
+            if address is not None:
+                return address[0]
+        if isinstance(self.expression, ArrayAccess):
+            address = self.expression.address(builder, module)
+            if address is not None:
+                return address[0]
+        if isinstance(self.expression, PointerDeref):
+            return self.expression.address(builder, module)
+        if isinstance(self.expression, Identifier) and isinstance(named_value(builder, module, self.expression.name), ir.Function):
+            # @function is the function pointer
+            return self.expression.codegen(builder, module)
+        raise ValueError(f"Cannot take the address of {type(self.expression).__name__}")
+
+def type_query(target: Union[TypeSpec, Expression], builder: ir.IRBuilder,
+               module: ir.Module) -> Tuple[ir.Type, Optional[MemoryLayout]]:
+    """The LLVM type and memory layout a sizeof/alignof operand names"""
+    name = None
+    if isinstance(target, Identifier):
+        name = target.name
+    elif isinstance(target, TypeSpec) and isinstance(target.base_type, str) and not (target.is_array or target.is_pointer):
+        name = target.base_type
+    is_type = name is not None and (named_struct(module, name) is not None
+                                    or name in getattr(module, '_type_aliases', {}))
+    if name is not None and not is_type:
+        # A variable: measure what its storage holds
+        slot = named_value(builder, module, name)
+        if slot is None or not isinstance(slot.type, ir.PointerType):
+            raise NameError(f"Unknown type or variable: {name}")
+        return slot.type.pointee, slot_layout(module, slot)
+    if isinstance(target, Identifier):
+        target = TypeSpec(target.name)
+    if not isinstance(target, TypeSpec):
+        raise ValueError("sizeof and alignof take a type or a variable")
+    return target.get_llvm_type_with_array(module), type_layout(target, module)
+
 @dataclass
 class AlignOf(Expression):
 	target: Union[TypeSpec, Expression]
 
+	def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+		"""Alignment in bits, like data{bits:align}, folded from the target data layout"""
+		llvm_type, layout = type_query(self.target, builder, module)
+		if layout is not None and layout.align is not None:
+			align = layout.align
+		else:
+			align = target_layout(module).abi_align(llvm_type)
+		return ir.Constant(ir.IntType(64), align * 8)
+
 @dataclass
 class SizeOf(Expression):
 	target: Union[TypeSpec, Expression]
 
+	def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+		"""Size in bits: an integer's declared width, otherwise its in-memory size with padding"""
+		llvm_type, _ = type_query(self.target, builder, module)
+		if isinstance(llvm_type, ir.IntType):
+			return ir.Constant(ir.IntType(64), llvm_type.width)
+		return ir.Constant(ir.IntType(64), target_layout(module).alloc_size(llvm_type) * 8)
+
 # Variable declarations
 @dataclass
 class VariableDeclaration(ASTNode):
     name: str
     type_spec: TypeSpec
     initial_value: Optional[Expression] = None
+    is_extern: bool = False  # Declaration of a global defined in another object file
+    arguments: Optional[List[Expression]] = None  # Object instance: T x(a, b);
 
     def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
         llvm_type = self.type_spec.get_llvm_type_with_array(module)
@@ -454,59 +2072,134 @@ class VariableDeclaration(ASTNode):
         # Handle global variables
         if builder.scope is None:
             # Check if global already exists
-            if self.name in module.globals:
-                return module.globals[self.name]
+            name = symbols(module).define(self.name)
+            if name in module.globals:
+                return module.globals[name]
                 
-            # Create new global
-            gvar = ir.GlobalVariable(module, llvm_type, self.name)
-            
-            # Set initializer
-            if self.initial_value:
-                # Handle array literals specially
-                if isinstance(llvm_type, ir.ArrayType) and hasattr(self.initial_value, 'value') and isinstance(self.initial_value.value, list):
-                    # Create array constant from list of values
-                    element_values = []
-                    for item in self.initial_value.value:
-                        if hasattr(item, 'value'):
-                            # Convert each element to LLVM constant
-                            element_values.append(ir.Constant(llvm_type.element, item.value))
-                        else:
-                            element_values.append(ir.Constant(llvm_type.element, item))
-                    gvar.initializer = ir.Constant(llvm_type, element_values)
-                else:
-                    init_val = self.initial_value.codegen(builder, module)
-                    if init_val is not None:
-                        gvar.initializer = init_val
-                    else:
-                        # Fallback for None return from codegen
-                        if isinstance(llvm_type, ir.ArrayType):
-                            gvar.initializer = ir.Constant(llvm_type, ir.Undefined)
-                        else:
-                            gvar.initializer = ir.Constant(llvm_type, 0)
-            else:
-                # Default initialize based on type
-                if isinstance(llvm_type, ir.ArrayType):
-                    gvar.initializer = ir.Constant(llvm_type, ir.Undefined)
-                elif isinstance(llvm_type, ir.IntType):
-                    gvar.initializer = ir.Constant(llvm_type, 0)
-                elif isinstance(llvm_type, ir.FloatType):
-                    gvar.initializer = ir.Constant(llvm_type, 0.0)
-                else:
-                    gvar.initializer = ir.Constant(llvm_type, None)
-            
-            # Set linkage and visibility
-            gvar.linkage = 'internal'
-            return gvar
+            if isinstance(self.initial_value, ArrayComprehension):
+                return self._global_comprehension(builder, module, llvm_type)
+            if self.arguments is not None:
+                raise ValueError(f"{self.name}: object instances with arguments must be local")
+            initializer = None
+            if self.initial_value is not None and (not self.is_extern or self.type_spec.is_const):
+                initializer = constant_initializer(self.initial_value, llvm_type, builder, module)
+            return self.define_global(module, llvm_type, initializer)
         
         # Handle local variables
-        alloca = builder.alloca(llvm_type, name=self.name)
-        if self.initial_value:
+        if isinstance(self.initial_value, ArrayComprehension):
+            llvm_type = self.initial_value.array_type(self.type_spec, builder, module)
+        alloca = entry_alloca(builder, llvm_type, self.name)
+        mark_unsigned(module, alloca, self.type_spec)
+        layout = type_layout(self.type_spec, module)
+        set_slot_layout(module, alloca, layout)
+        if getattr(builder, 'break_block', None) is not None:
+            # Each iteration's declaration revives a slot the previous one may have (void)ed
+            lifetime(builder, module, 'start', alloca)
+        if isinstance(self.initial_value, Literal) and isinstance(self.initial_value.value, list):
+            self._store_elements(builder, module, alloca, llvm_type, layout)
+        elif isinstance(self.initial_value, ArrayComprehension):
+            self.initial_value.lower_into(builder, module, alloca, layout)
+        elif self.initial_value:
             init_val = self.initial_value.codegen(builder, module)
-            builder.store(init_val, alloca)
+            signed = not is_unsigned(self.initial_value, builder, module)
+            store_value(builder, module, coerce_int(builder, init_val, llvm_type, signed), alloca, layout)
+        mark_owner(module, alloca, self.initial_value, builder)
         
         builder.scope[self.name] = alloca
+        if isinstance(llvm_type, ir.IdentifiedStructType) and self.initial_value is None:
+            construct(builder, module, alloca, self.arguments or [])
+        elif self.arguments is not None:
+            raise ValueError(f"{self.name} is not an object, so it takes no constructor arguments")
+        elif isinstance(self.initial_value, (FunctionCall, MethodCall)) and object_method(module, llvm_type, '__exit'):
+            # An instance a function returned is this block's to end now
+            builder.scope.objects.append(alloca)
         return alloca
+
+    def _store_elements(self, builder: ir.IRBuilder, module: ir.Module, alloca: ir.AllocaInstr,
+                        llvm_type: ir.Type, layout: Optional[MemoryLayout]) -> None:
+        """Initialize a local array from [a, b, ...]: one store of a constant table, else element by element"""
+        items = self.initial_value.value
+        if not isinstance(llvm_type, (ir.ArrayType, ir.VectorType)):
+            raise ValueError(f"Array initializer for {self.name}, which is not an array")
+        if len(items) > llvm_type.count:
+            raise ValueError(f"{len(items)} initializers for {self.name}[{llvm_type.count}]")
+        convert = convert_lane if isinstance(llvm_type, ir.VectorType) else coerce_int
+        values = [convert(builder, item.codegen(builder, module), llvm_type.element,
+                          not is_unsigned(item, builder, module)) for item in items]
+        values += [zero_constant(llvm_type.element)] * (llvm_type.count - len(values))
+        if isinstance(llvm_type, ir.VectorType):
+            # A vector is built in registers and stored whole
+            vector = ir.Constant(llvm_type, [value if isinstance(value, ir.Constant) else zero_constant(llvm_type.element)
+                                             for value in values])
+            for index, value in enumerate(values):
+                if not isinstance(value, ir.Constant):
+                    vector = builder.insert_element(vector, value, ir.Constant(ir.IntType(32), index))
+            store_value(builder, module, vector, alloca, layout)
+            return
+        if all(isinstance(value, ir.Constant) for value in values):
+            table = ir.Constant(llvm_type, values)
+            if layout is not None and layout.big_endian:
+                table = swap_constant(table)
+            builder.store(table, alloca, align=layout.align if layout is not None else None)
+            return
+        zero = ir.Constant(ir.IntType(32), 0)
+        for index, value in enumerate(values):
+            element_ptr = builder.gep(alloca, [zero, ir.Constant(ir.IntType(32), index)], inbounds=True)
+            store_value(builder, module, value, element_ptr, layout)
     
+    def _global_comprehension(self, builder: ir.IRBuilder, module: ir.Module,
+                              llvm_type: ir.Type) -> ir.GlobalVariable:
+        """A global comprehension runs at compile time; a T[] global is exactly as long as its result"""
+        element = llvm_type.element if isinstance(llvm_type, ir.ArrayType) else llvm_type
+        values = None if self.is_extern and not self.type_spec.is_const else \
+            self.initial_value.fold(element, builder, module)
+        if values is None:
+            if not isinstance(llvm_type, ir.ArrayType):
+                raise ValueError(f"The comprehension initializing {self.name} does not fold to constants, "
+                                 f"give the array a size: T[N]")
+            return self.define_global(module, llvm_type, None)
+        count = llvm_type.count if isinstance(llvm_type, ir.ArrayType) else len(values)
+        if len(values) > count:
+            raise ValueError(f"{len(values)} elements for {self.name}[{count}]")
+        values += [zero_constant(element)] * (count - len(values))
+        array_type = ir.ArrayType(element, count)
+        return self.define_global(module, array_type, ir.Constant(array_type, values))
+
+    def define_global(self, module: ir.Module, llvm_type: ir.Type,
+                      initializer: Optional[ir.Constant]) -> ir.GlobalVariable:
+        """Emit the global this declares; initializer is a folded constant in native byte order"""
+        name = symbols(module).define(self.name)
+        gvar = ir.GlobalVariable(module, llvm_type, name)
+        mark_unsigned(module, gvar, self.type_spec)
+        layout = type_layout(self.type_spec, module)
+        set_slot_layout(module, gvar, layout)
+        if self.type_spec.is_const:
+            # Read-only and address-insignificant: loads fold to the value, identical tables merge
+            gvar.global_constant = True
+            gvar.unnamed_addr = True
+            if initializer is not None:
+                if not hasattr(module, '_constants'):
+                    module._constants = {}
+                module._constants[name] = initializer
+        if self.is_extern:
+            return gvar
+
+        if initializer is None:
+            # Default initialize based on type
+            if isinstance(llvm_type, ir.ArrayType):
+                initializer = ir.Constant(llvm_type, ir.Undefined)
+            else:
+                initializer = zero_constant(llvm_type)
+        if layout is not None and layout.big_endian:
+            initializer = swap_constant(initializer)
+        gvar.initializer = initializer
+
+        # Set linkage and visibility
+        # Separately compiled modules export their globals to the modules importing them
+        if not getattr(module, '_export_globals', False):
+            gvar.linkage = 'internal'
+        return gvar
+
     def get_llvm_type(self, module: ir.Module) -> ir.Type:
         if isinstance(self.type_spec.base_type, str):
             # Check if it's a struct type
@@ -552,6 +2245,13 @@ class TypeDeclaration(Expression):
         if not hasattr(module, '_type_aliases'):
             module._type_aliases = {}
         module._type_aliases[self.name] = llvm_type
+        if not hasattr(module, '_type_layouts'):
+            module._type_layouts = {}
+        module._type_layouts[self.name] = type_layout(self.base_type, module)
+        if is_unsigned_type(self.base_type, module):
+            if not hasattr(module, '_unsigned_types'):
+                module._unsigned_types = set()
+            module._unsigned_types.add(self.name)
         
         if self.initial_value:
             init_val = self.initial_value.codegen(builder, module)
@@ -603,14 +2303,82 @@ class Assignment(Statement):
     target: Expression
     value: Expression
 
+    def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        lane = self._store_lane(builder, module)
+        if lane is not None:
+            return lane
+        if isinstance(self.value, ArrayComprehension):
+            dest = array_address(self.target, builder, module)
+            if dest is None:
+                raise ValueError("An array comprehension can only be assigned to a fixed-size array")
+            self.value.lower_into(builder, module, dest, slot_layout(module, dest))
+            return None
+        ptr, layout = self._address(builder, module)
+        signed = not is_unsigned(self.value, builder, module)
+        value = coerce_int(builder, self.value.codegen(builder, module), ptr.type.pointee, signed)
+        store_value(builder, module, value, ptr, layout)
+        if isinstance(self.target, Identifier):
+            mark_owner(module, ptr, self.value, builder)
+        return value
+
+    def _address(self, builder: ir.IRBuilder, module: ir.Module) -> Tuple[ir.Value, Optional[MemoryLayout]]:
+        """Pointer to the storage being assigned, and its memory layout"""
+        if isinstance(self.target, Identifier):
+            name = self.target.name
+            slot = named_value(builder, module, name)
+            if slot is not None and isinstance(slot.type, ir.PointerType):
+                return slot, slot_layout(module, slot)
+            raise NameError(f"Cannot assign to {name}")
+        if isinstance(self.target, ArrayAccess):
+            address = self.target.address(builder, module)
+            if address is not None:
+                return address
+        if isinstance(self.target, PointerDeref):
+            return self.target.address(builder, module), None
+        if isinstance(self.target, MemberAccess):
+            address = member_address(self.target.object, self.target.member, builder, module)
+            if address is not None:
+                return address
+        raise ValueError(f"Unsupported assignment target: {type(self.target).__name__}")
+
+    def _store_lane(self, builder: ir.IRBuilder, module: ir.Module) -> Optional[ir.Value]:
+        """v[i] = x on a vector variable replaces one lane of it"""
+        if not (isinstance(self.target, ArrayAccess) and isinstance(self.target.array, Identifier)):
+            return None
+        name = self.target.array.name
+        slot = named_value(builder, module, name)
+        if not (isinstance(slot, ir.Value) and isinstance(slot.type, ir.PointerType)
+                and isinstance(slot.type.pointee, ir.VectorType)):
+            return None
+        layout = slot_layout(module, slot)
+        vector = load_value(builder, module, slot, layout, name=name)
+        index = self.target.index.codegen(builder, module)
+        lane = convert_lane(builder, self.value.codegen(builder, module), vector.type.element,
+                            not is_unsigned(self.value, builder, module))
+        store_value(builder, module, builder.insert_element(vector, lane, index), slot, layout)
+        return lane
+
 @dataclass
 class Block(Statement):
     statements: List[Statement] = field(default_factory=list)
 
     def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        # Declarations end with the block that holds them
+        outer_scope = builder.scope
+        if outer_scope is not None:
+            builder.scope = outer_scope.child()
         result = None
-        for stmt in self.statements:
-            result = stmt.codegen(builder, module)
+        try:
+            for stmt in self.statements:
+                # Nothing after a return/break/continue is reachable
+                if builder.block is not None and builder.block.is_terminated:
+                    break
+                debug_location(builder, module, stmt)
+                result = stmt.codegen(builder, module)
+            if builder.scope is not outer_scope and builder.block is not None and not builder.block.is_terminated:
+                leave_scopes(builder, module, outer_scope)
+        finally:
+            builder.scope = outer_scope
         return result
 
 @dataclass
@@ -625,28 +2393,32 @@ class IfStatement(Statement):
     else_block: Optional[Block] = None
 
     def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
-        # Generate condition
-        cond_val = self.condition.codegen(builder, module)
-        
-        # Create basic blocks
         func = builder.block.function
-        then_block = func.append_basic_block('then')
-        else_block = func.append_basic_block('else')
-        merge_block = func.append_basic_block('ifcont')
-        
-        builder.cbranch(cond_val, then_block, else_block)
-        
-        # Emit then block
-        builder.position_at_start(then_block)
-        self.then_block.codegen(builder, module)
-        builder.branch(merge_block)
-        
+        merge_block = None
+
+        # Each elif is tested in the false side of the arm before it, a
+        # chain of branches that each count or weigh like a plain if
+        arms = [(self.condition, self.then_block)] + list(self.elif_blocks)
+        for position, (condition, block) in enumerate(arms):
+            cond_val = condition.codegen(builder, module)
+            then_block = func.append_basic_block('then' if position == 0 else 'elif.then')
+            else_block = func.append_basic_block('else' if position == len(arms) - 1 else 'elif')
+            if merge_block is None:
+                merge_block = func.append_basic_block('ifcont')
+            profiled_cbranch(builder, module, 'if', cond_val, then_block, else_block)
+
+            builder.position_at_start(then_block)
+            block.codegen(builder, module)
+            if not builder.block.is_terminated:
+                builder.branch(merge_block)
+            builder.position_at_start(else_block)
+
         # Emit else block
-        builder.position_at_start(else_block)
         if self.else_block:
             self.else_block.codegen(builder, module)
-        builder.branch(merge_block)
-        
+        if not builder.block.is_terminated:
+            builder.branch(merge_block)
+
         # Position builder at merge block
         builder.position_at_start(merge_block)
         return None
@@ -663,10 +2435,11 @@ class WhileLoop(Statement):
         end_block = func.append_basic_block('while.end')
         
         # Save current break/continue targets
-        old_break = getattr(builder, 'break_block', None)
-        old_continue = getattr(builder, 'continue_block', None)
+        old_break = getattr(builder, 'break_block', None), getattr(builder, 'break_scope', None)
+        old_continue = getattr(builder, 'continue_block', None), getattr(builder, 'continue_scope', None)
         builder.break_block = end_block
         builder.continue_block = cond_block
+        builder.break_scope = builder.continue_scope = builder.scope
         
         # Jump to condition block
         builder.branch(cond_block)
@@ -674,16 +2447,17 @@ class WhileLoop(Statement):
         # Emit condition block
         builder.position_at_start(cond_block)
         cond_val = self.condition.codegen(builder, module)
-        builder.cbranch(cond_val, body_block, end_block)
+        profiled_cbranch(builder, module, 'while', cond_val, body_block, end_block)
         
         # Emit body block
         builder.position_at_start(body_block)
         self.body.codegen(builder, module)
-        builder.branch(cond_block)  # Loop back
+        if not builder.block.is_terminated:
+            builder.branch(cond_block)  # Loop back
         
         # Restore break/continue targets
-        builder.break_block = old_break
-        builder.continue_block = old_continue
+        builder.break_block, builder.break_scope = old_break
+        builder.continue_block, builder.continue_scope = old_continue
         
         # Position builder at end block
         builder.position_at_start(end_block)
@@ -694,29 +2468,617 @@ class DoWhileLoop(Statement):
     body: Block
     condition: Expression
 
-@dataclass
-class ForLoop(Statement):
-    init: Optional[Statement]
-    condition: Optional[Expression]
+class LoopID(ir.MDValue):
+    """The distinct, self-referencing node that !llvm.loop attachments point at"""
+    def descr(self, buf):
+        buf.append("distinct ")
+        super().descr(buf)
+
+def loop_metadata(module: ir.Module, hints: dict) -> Optional[LoopID]:
+    """
+    Build the !llvm.loop node for a loop's unroll/vectorize hints:
+        unroll(0)     unroll fully          vectorize(1)  keep scalar
+        unroll(1)     do not unroll         vectorize(N)  vectorize N lanes wide
+        unroll(N)     unroll N times
+    """
+    if not hints:
+        return None
+    i1, i32 = ir.IntType(1), ir.IntType(32)
+
+    def prop(name, *values):
+        return module.add_metadata([ir.MetaDataString(module, name), *values])
+
+    props = []
+    unroll = hints.get('unroll')
+    if unroll == 0:
+        props.append(prop("llvm.loop.unroll.full"))
+    elif unroll == 1:
+        props.append(prop("llvm.loop.unroll.disable"))
+    elif unroll is not None:
+        props.append(prop("llvm.loop.unroll.count", ir.Constant(i32, unroll)))
+
+    width = hints.get('vectorize')
+    if width is not None and width <= 1:
+        props.append(prop("llvm.loop.vectorize.enable", ir.Constant(i1, 0)))
+    elif width is not None:
+        props.append(prop("llvm.loop.vectorize.enable", ir.Constant(i1, 1)))
+        props.append(prop("llvm.loop.vectorize.width", ir.Constant(i32, width)))
+
+    loop_id = LoopID(module, props, name=str(len(module.metadata)))
+    loop_id.operands = (loop_id,) + loop_id.operands
+    return loop_id
+
+def truth_value(builder: ir.IRBuilder, value: ir.Value) -> ir.Value:
+    """Condition value as an i1"""
+    if isinstance(value.type, ir.IntType) and value.type.width == 1:
+        return value
+    if isinstance(value.type, ir.IntType):
+        return builder.icmp_unsigned('!=', value, ir.Constant(value.type, 0))
+    if isinstance(value.type, (ir.FloatType, ir.DoubleType)):
+        return builder.fcmp_ordered('!=', value, ir.Constant(value.type, 0.0))
+    raise ValueError(f"Cannot use {value.type} as a condition")
+
+# ============ PROFILE-GUIDED OPTIMIZATION ============
+# --pgo-generate counts how often each function is entered and how often
+# each if/loop condition comes out true, and the program appends the
+# counts to a raw profile at exit (see fprofile.py). --pgo-use feeds merged
+# counts back in: conditions get !prof branch_weights for block placement
+# and the loop passes, and functions become hot or cold, which moves their
+# code apart and steers the inliner. Sites are named by function and
+# position (main:if2), so a function whose branches changed since the
+# profile was recorded is built as if it had none.
+
+def profile_site(builder: ir.IRBuilder, kind: str) -> str:
+    func = builder.function
+    func._profile_sites = getattr(func, '_profile_sites', 0) + 1
+    return f"{func.name}:{kind}{func._profile_sites - 1}"
+
+def profile_counters(module: ir.Module, name: str) -> ir.GlobalVariable:
+    counters = ir.GlobalVariable(module, ir.ArrayType(ir.IntType(64), 2), f"__flux_prof.{name}")
+    counters.initializer = ir.Constant(counters.type.pointee, None)
+    counters.linkage = 'internal'
+    return counters
+
+def bump_counter(builder: ir.IRBuilder, counters: ir.GlobalVariable, index: int, amount: ir.Value) -> None:
+    zero = ir.Constant(ir.IntType(32), 0)
+    slot = builder.gep(counters, [zero, ir.Constant(ir.IntType(32), index)], inbounds=True)
+    builder.store(builder.add(builder.load(slot), amount), slot)
+
+def branch_weights(module: ir.Module, taken: int, not_taken: int):
+    # Weights are i32; like clang, add one so neither side is ever impossible
+    scale = max(taken, not_taken) // 0xFFFFFFFF + 1
+    i32 = ir.IntType(32)
+    return module.add_metadata([ir.MetaDataString(module, "branch_weights"),
+                                ir.Constant(i32, taken // scale + 1), ir.Constant(i32, not_taken // scale + 1)])
+
+def profiled_cbranch(builder: ir.IRBuilder, module: ir.Module, kind: str, condition: ir.Value,
+                     true_block: ir.Block, false_block: ir.Block) -> ir.Instruction:
+    """A conditional branch that is counted or weighted when profiling"""
+    condition = truth_value(builder, condition)
+    site = profile_site(builder, kind)
+    if getattr(module, '_profile_instrument', False):
+        counters = profile_counters(module, site)
+        module._profile_branches = getattr(module, '_profile_branches', []) + [(site, counters)]
+        bump_counter(builder, counters, 0, ir.Constant(ir.IntType(64), 1))
+        bump_counter(builder, counters, 1, builder.zext(condition, ir.IntType(64)))
+    branch = builder.cbranch(condition, true_block, false_block)
+    profile = getattr(module, '_profile', None)
+    counts = profile.branch(site) if profile is not None else None
+    if counts is not None:
+        executions, taken = counts
+        branch.set_metadata('prof', branch_weights(module, taken, executions - taken))
+        builder.function._weighted_branches = getattr(builder.function, '_weighted_branches', []) + [branch]
+    return branch
+
+def profile_entry(builder: ir.IRBuilder, module: ir.Module) -> None:
+    """Count a call of the function being generated, at the top of its entry block"""
+    if getattr(module, '_profile_instrument', False):
+        func = builder.function
+        func._profile_calls = profile_counters(module, func.name)
+        bump_counter(builder, func._profile_calls, 0, ir.Constant(ir.IntType(64), 1))
+
+def finish_profile(module: ir.Module, func: ir.Function, definition: 'FunctionDef') -> None:
+    """Record func's branch count for the profile, or apply what the profile says about it"""
+    sites = getattr(func, '_profile_sites', 0)
+    if getattr(module, '_profile_instrument', False):
+        module._profile_functions = getattr(module, '_profile_functions', []) + [(func.name, func._profile_calls, sites)]
+    profile = getattr(module, '_profile', None)
+    if profile is None:
+        return
+    if not profile.fits(func.name, sites):
+        # Recorded from different source: the weights would land on the wrong branches
+        for branch in getattr(func, '_weighted_branches', []):
+            del branch.metadata['prof']
+        return
+    temperature = profile.temperature(func.name)
+    if temperature is not None and not getattr(definition, 'attributes', None):
+        # Explicit annotations win over the profile
+        add_function_attribute(func, temperature)
+        if temperature == 'hot':
+            add_function_attribute(func, 'inlinehint')
+
+def c_string(module: ir.Module, text: str, name: str) -> ir.Constant:
+    data = bytearray(text.encode('utf-8') + b'\0')
+    string = ir.GlobalVariable(module, ir.ArrayType(ir.IntType(8), len(data)), name)
+    string.initializer = ir.Constant(string.type.pointee, data)
+    string.global_constant = True
+    string.linkage = 'internal'
+    zero = ir.Constant(ir.IntType(32), 0)
+    return string.gep([zero, zero])
+
+def emit_profile_writer(module: ir.Module) -> None:
+    """
+    Register, from a global constructor, an atexit handler that appends
+    this module's counters to the raw profile
+    """
+    if not getattr(module, '_profile_instrument', False):
+        return
+    i8_ptr = ir.IntType(8).as_pointer()
+    void_fn = ir.FunctionType(ir.VoidType(), [])
+    getenv = runtime_function(module, 'getenv', i8_ptr, [i8_ptr])
+    fopen = runtime_function(module, 'fopen', i8_ptr, [i8_ptr, i8_ptr])
+    fprintf = runtime_function(module, 'fprintf', ir.IntType(32), [i8_ptr, i8_ptr], var_arg=True)
+    fclose = runtime_function(module, 'fclose', ir.IntType(32), [i8_ptr])
+    atexit = runtime_function(module, 'atexit', ir.IntType(32), [void_fn.as_pointer()])
+
+    writer = ir.Function(module, void_fn, module.get_unique_name('__flux_prof_write'))
+    writer.linkage = 'internal'
+    builder = ir.IRBuilder(writer.append_basic_block('entry'))
+    path = builder.call(getenv, [c_string(module, "FLUX_PROFILE_FILE", module.get_unique_name('__flux_prof.env'))])
+    unset = builder.icmp_unsigned('==', path, ir.Constant(i8_ptr, None))
+    default = c_string(module, "default.fxprofraw", module.get_unique_name('__flux_prof.default'))
+    file = builder.call(fopen, [builder.select(unset, default, path),
+                                c_string(module, "a", module.get_unique_name('__flux_prof.mode'))])
+    write_block = writer.append_basic_block('write')
+    done_block = writer.append_basic_block('done')
+    builder.cbranch(builder.icmp_unsigned('==', file, ir.Constant(i8_ptr, None)), done_block, write_block)
+
+    builder.position_at_end(write_block)
+    zero = ir.Constant(ir.IntType(32), 0)
+    def counter(counters, index):
+        return builder.load(builder.gep(counters, [zero, ir.Constant(ir.IntType(32), index)], inbounds=True))
+    for name, counters, sites in getattr(module, '_profile_functions', []):
+        line = c_string(module, f"F {name} %llu {sites}\n", module.get_unique_name('__flux_prof.line'))
+        builder.call(fprintf, [file, line, counter(counters, 0)])
+    for site, counters in getattr(module, '_profile_branches', []):
+        line = c_string(module, f"B {site} %llu %llu\n", module.get_unique_name('__flux_prof.line'))
+        builder.call(fprintf, [file, line, counter(counters, 0), counter(counters, 1)])
+    builder.call(fclose, [file])
+    builder.branch(done_block)
+    builder.position_at_end(done_block)
+    builder.ret_void()
+
+    register = ir.Function(module, void_fn, module.get_unique_name('__flux_prof_register'))
+    register.linkage = 'internal'
+    builder = ir.IRBuilder(register.append_basic_block('entry'))
+    builder.call(atexit, [writer])
+    builder.ret_void()
+
+    entry = ir.LiteralStructType([ir.IntType(32), void_fn.as_pointer(), i8_ptr])
+    ctors = ir.GlobalVariable(module, ir.ArrayType(entry, 1), 'llvm.global_ctors')
+    ctors.linkage = 'appending'
+    ctors.initializer = ir.Constant(ctors.type.pointee, [
+        ir.Constant(entry, [ir.Constant(ir.IntType(32), 65535), register, ir.Constant(i8_ptr, None)])])
+
+def emit_loop(builder: ir.IRBuilder, module: ir.Module, prefix: str,
+              condition, body, step, hints: dict) -> None:
+    """
+    Emit a canonical loop around the three callbacks. The current block is
+    the preheader; <prefix>.cond is the header, <prefix>.latch runs step()
+    and carries the only backedge, which gets the !llvm.loop hints. break
+    goes to <prefix>.end and continue to the latch. condition() may return
+    None for a loop without one.
+    """
+    func = builder.block.function
+    cond_block = func.append_basic_block(f'{prefix}.cond')
+    body_block = func.append_basic_block(f'{prefix}.body')
+    latch_block = func.append_basic_block(f'{prefix}.latch')
+    end_block = func.append_basic_block(f'{prefix}.end')
+
+    # Save current break/continue targets
+    old_break = getattr(builder, 'break_block', None), getattr(builder, 'break_scope', None)
+    old_continue = getattr(builder, 'continue_block', None), getattr(builder, 'continue_scope', None)
+    builder.break_block = end_block
+    builder.continue_block = latch_block
+    builder.break_scope = builder.continue_scope = builder.scope
+
+    builder.branch(cond_block)
+    builder.position_at_start(cond_block)
+    cond_val = condition()
+    if cond_val is None:
+        builder.branch(body_block)
+    else:
+        profiled_cbranch(builder, module, prefix, cond_val, body_block, end_block)
+
+    builder.position_at_start(body_block)
+    body()
+    if not builder.block.is_terminated:
+        builder.branch(latch_block)
+
+    builder.position_at_start(latch_block)
+    step()
+    backedge = builder.branch(cond_block)
+    loop_id = loop_metadata(module, hints)
+    if loop_id is not None:
+        backedge.set_metadata('llvm.loop', loop_id)
+
+    # Restore break/continue targets
+    builder.break_block, builder.break_scope = old_break
+    builder.continue_block, builder.continue_scope = old_continue
+    builder.position_at_start(end_block)
+
+@dataclass
+class ForLoop(Statement):
+    init: Optional[Statement]
+    condition: Optional[Expression]
     update: Optional[Statement]
     body: Block
+    hints: dict = field(default_factory=dict)  # unroll/vectorize, see loop_metadata
+
+    def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        # Variables declared in the header are scoped to the loop
+        outer_scope = builder.scope
+        builder.scope = outer_scope.child()
+        try:
+            if self.init is not None:
+                self.init.codegen(builder, module)
+            emit_loop(
+                builder, module, 'for',
+                condition=lambda: self.condition.codegen(builder, module) if self.condition is not None else None,
+                body=lambda: self.body.codegen(builder, module),
+                step=lambda: self.update.codegen(builder, module) if self.update is not None else None,
+                hints=self.hints,
+            )
+        finally:
+            builder.scope = outer_scope
+        return None
 
 @dataclass
 class ForInLoop(Statement):
     variables: List[str]
     iterable: Expression
     body: Block
+    hints: dict = field(default_factory=dict)  # unroll/vectorize, see loop_metadata
+
+    def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        """
+        for (x in a..b)       counts x from a to b inclusive
+        for (x in array)      x is each element of a fixed-size array
+        for (i, x in array)   i is the element's index
+        Both are counted loops whose induction variable is a phi, never memory.
+        """
+        self.lower(builder, module, lambda: self.body.codegen(builder, module))
+        return None
+
+    def lower(self, builder: ir.IRBuilder, module: ir.Module, body) -> None:
+        """The loop around body(), which runs with the loop variables in scope"""
+        outer_scope = builder.scope
+        builder.scope = outer_scope.child()
+        try:
+            if isinstance(self.iterable, RangeExpression):
+                self._range_loop(builder, module, body)
+            else:
+                self._array_loop(builder, module, body)
+        finally:
+            builder.scope = outer_scope
+
+    def _counted_loop(self, builder: ir.IRBuilder, module: ir.Module, start: ir.Value,
+                      in_bounds, bind, run_body, has_next=None) -> None:
+        """
+        Count up by one from start while in_bounds(iv). Given has_next, in_bounds
+        is only tested on start, and each iteration asks has_next(iv) before
+        the increment instead, so a count that ends at the type's maximum
+        never has to step past it.
+        """
+        preheader = builder.block
+        counter = {}
+        entering = in_bounds(start) if has_next is not None else None
+
+        def condition():
+            iv = builder.phi(start.type, name=f"{self.variables[0]}.iv")
+            iv.add_incoming(start, preheader)
+            counter['iv'] = iv
+            if has_next is None:
+                return in_bounds(iv)
+            more = builder.phi(ir.IntType(1), name=f"{self.variables[0]}.more")
+            more.add_incoming(entering, preheader)
+            counter['more'] = more
+            return more
+
+        def body():
+            bind(counter['iv'])
+            run_body()
+
+        def step():
+            iv = counter['iv']
+            if has_next is None:
+                # iv < count, so iv + 1 cannot wrap
+                iv.add_incoming(builder.add(iv, ir.Constant(iv.type, 1), name=f"{self.variables[0]}.next",
+                                            flags=['nsw']), builder.block)
+                return
+            counter['more'].add_incoming(has_next(iv), builder.block)
+            # Wraps after the last iteration, when the value is never used
+            iv.add_incoming(builder.add(iv, ir.Constant(iv.type, 1), name=f"{self.variables[0]}.next"),
+                            builder.block)
+
+        emit_loop(builder, module, 'for', condition, body, step, self.hints)
+
+    def _range_loop(self, builder: ir.IRBuilder, module: ir.Module, body) -> None:
+        if len(self.variables) != 1:
+            raise ValueError("A range loop takes exactly one variable")
+        start = self.iterable.start.codegen(builder, module)
+        end = self.iterable.end.codegen(builder, module)
+        if not isinstance(start.type, ir.IntType) or not isinstance(end.type, ir.IntType):
+            raise ValueError("Range bounds must be integers")
+        counter_type = start.type if start.type.width >= end.type.width else end.type
+        start_unsigned = is_unsigned(self.iterable.start, builder, module)
+        end_unsigned = is_unsigned(self.iterable.end, builder, module)
+        start = coerce_int(builder, start, counter_type, not start_unsigned)
+        end = coerce_int(builder, end, counter_type, not end_unsigned)
+
+        unsigned = start_unsigned or end_unsigned
+
+        def bind(iv):
+            # Counts like its bounds: unsigned if either is, as in a binary operation
+            mark_unsigned_value(module, iv, unsigned)
+            builder.scope[self.variables[0]] = iv
+
+        compare = builder.icmp_unsigned if unsigned else builder.icmp_signed
+        # Inclusive: a..b runs b == max too, so the loop stops on reaching end rather than passing it
+        self._counted_loop(builder, module, start,
+                           in_bounds=lambda iv: compare('<=', iv, end, name="for.inrange"),
+                           bind=bind, run_body=body,
+                           has_next=lambda iv: builder.icmp_unsigned('!=', iv, end, name="for.more"))
+
+    def _array_loop(self, builder: ir.IRBuilder, module: ir.Module, body) -> None:
+        if len(self.variables) > 2:
+            raise ValueError("An array loop takes an element variable and an optional index")
+        array_ptr = array_address(self.iterable, builder, module)
+        if array_ptr is None:
+            raise ValueError("for-in needs a range (a..b) or a fixed-size array")
+        index_type = ir.IntType(64)
+        count = array_length(builder, module, array_ptr)
+        *index_name, element_name = self.variables
+
+        def bind(iv):
+            zero = ir.Constant(ir.IntType(32), 0)
+            element_ptr = builder.gep(array_ptr, [zero, iv], inbounds=True, name="for.element")
+            element = load_value(builder, module, element_ptr, slot_layout(module, array_ptr), name=element_name)
+            mark_unsigned_value(module, element, array_ptr in getattr(module, '_unsigned_values', ()))
+            builder.scope[element_name] = element
+            if index_name:
+                builder.scope[index_name[0]] = iv
+
+        self._counted_loop(builder, module, ir.Constant(index_type, 0),
+                           in_bounds=lambda iv: builder.icmp_unsigned('<', iv, count, name="for.inrange"),
+                           bind=bind, run_body=body)
+
+# ============ ARRAY COMPREHENSIONS ============
+# A comprehension is written straight into the array it initializes by
+# one counted loop. Its size is the source's trip count, known at compile
+# time for constant ranges and fixed-size arrays; with a filter that is
+# an upper bound, and the number actually produced is kept beside the
+# array so for-in loops over it stop there. A comprehension over another
+# comprehension fuses with it: the inner element feeds the outer stage
+# inside the same iteration, and no intermediate array exists.
+
+def array_length(builder: ir.IRBuilder, module: ir.Module, array_ptr: ir.Value) -> ir.Value:
+    """Elements in use in the array at array_ptr, as an i64"""
+    filled = getattr(module, '_array_lengths', {}).get(array_ptr)
+    if filled is not None:
+        return builder.load(filled, name="array.length")
+    return ir.Constant(ir.IntType(64), array_ptr.type.pointee.count)
+
+def fill_memory(builder: ir.IRBuilder, module: ir.Module, ptr: ir.Value, byte: int, size: ir.Value) -> None:
+    i8_ptr = ir.PointerType(ir.IntType(8))
+    memset = module.declare_intrinsic('llvm.memset', [i8_ptr, size.type])
+    builder.call(memset, [builder.bitcast(ptr, i8_ptr), ir.Constant(ir.IntType(8), byte), size,
+                          ir.Constant(ir.IntType(1), 0)])
+
+def static_value(expr: 'Expression', builder: ir.IRBuilder, module: ir.Module) -> Optional[ir.Constant]:
+    """expr's value if it is a literal or a named constant, found without emitting code"""
+    value = None
+    if isinstance(expr, Literal) and not isinstance(expr.value, (list, dict)):
+        value = expr.codegen(builder, module)
+    elif isinstance(expr, Identifier):
+        if builder.scope is not None and expr.name in builder.scope:
+            value = builder.scope[expr.name]
+        else:
+            value = getattr(module, '_constants', {}).get(expr.name)
+    elif isinstance(expr, UnaryOp) and not expr.is_postfix:
+        operand = static_value(expr.operand, builder, module)
+        value = fold_unary(expr.operator, operand) if operand is not None else None
+    return value if isinstance(value, ir.Constant) else None
+
+@dataclass
+class ArrayComprehension(Expression):
+    """[element for (x in source) if (condition)]"""
+    element: Expression
+    variables: List[str]
+    iterable: Expression
+    condition: Optional[Expression] = None
+
+    def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        raise ValueError("An array comprehension can only initialize or be assigned to an array")
+
+    def stages(self) -> List['ArrayComprehension']:
+        """The fused chain, starting with the stage that reads the real source"""
+        chain = [self]
+        while isinstance(chain[-1].iterable, ArrayComprehension):
+            chain.append(chain[-1].iterable)
+        chain.reverse()
+        for stage in chain[1:]:
+            if len(stage.variables) != 1:
+                raise ValueError("A comprehension over a comprehension takes exactly one variable")
+        return chain
+
+    def static_range(self, builder: ir.IRBuilder, module: ir.Module) -> Optional[Tuple[ir.IntType, int, int, bool]]:
+        """The source range's counter type, first and last values and signedness when known at compile time"""
+        source = self.stages()[0].iterable
+        if not isinstance(source, RangeExpression):
+            return None
+        start = static_value(source.start, builder, module)
+        end = static_value(source.end, builder, module)
+        if constant_int(start) is None or constant_int(end) is None:
+            return None
+        # Counts like the run time loop: at the wider bound type, unsigned if either bound is
+        int_type = start.type if start.type.width >= end.type.width else end.type
+        start_unsigned = is_unsigned(source.start, builder, module)
+        end_unsigned = is_unsigned(source.end, builder, module)
+        first = constant_int(convert_constant(builder, start, int_type, not start_unsigned))
+        last = constant_int(convert_constant(builder, end, int_type, not end_unsigned))
+        if start_unsigned or end_unsigned:
+            return int_type, _unsigned(first, int_type.width), _unsigned(last, int_type.width), True
+        return int_type, _signed(first, int_type.width), _signed(last, int_type.width), False
+
+    def trip_count(self, builder: ir.IRBuilder, module: ir.Module) -> Optional[int]:
+        """Iterations of the source loop when known at compile time"""
+        source = self.stages()[0].iterable
+        if isinstance(source, RangeExpression):
+            bounds = self.static_range(builder, module)
+            if bounds is None:
+                return None
+            _, first, last, _ = bounds
+            return max(0, last - first + 1)
+        array_ptr = array_address(source, builder, module)
+        if array_ptr is not None:
+            return array_ptr.type.pointee.count
+        return None
+
+    def array_type(self, type_spec: 'TypeSpec', builder: ir.IRBuilder, module: ir.Module) -> ir.ArrayType:
+        """The array a declaration of type_spec holds; T[] takes the comprehension's size"""
+        llvm_type = type_spec.get_llvm_type_with_array(module)
+        if type_spec.is_array and type_spec.array_size:
+            return llvm_type
+        if not type_spec.is_array:
+            raise ValueError("An array comprehension initializes an array, declare it as T[] or T[N]")
+        count = self.trip_count(builder, module)
+        if count is None:
+            raise ValueError("The size of this comprehension is only known at run time, give the array a size: T[N]")
+        return ir.ArrayType(llvm_type, count)
+
+    def lower_into(self, builder: ir.IRBuilder, module: ir.Module, dest: ir.Value,
+                   layout: Optional[MemoryLayout]) -> None:
+        """One loop filling the array at dest"""
+        stages = self.stages()
+        array_type = dest.type.pointee
+        index_type = ir.IntType(64)
+        capacity = ir.Constant(index_type, array_type.count)
+        trips = self.trip_count(builder, module)
+        filtered = any(stage.condition is not None for stage in stages)
+        # Without a filter every iteration stores once, so a source that fits needs no bounds check
+        bounded = trips is None or trips > array_type.count
+        partial = filtered or bounded or trips < array_type.count
+
+        if not hasattr(module, '_array_lengths'):
+            module._array_lengths = {}
+        count = module._array_lengths.get(dest)
+        # The length is read wherever dest is, so before this comprehension
+        # runs, or on paths that never run it, it is the whole array
+        if count is None and isinstance(dest, ir.GlobalVariable):
+            # Any function may read a global array: its length is a global beside it
+            count = ir.GlobalVariable(module, index_type, f"{dest.name}.length")
+            count.initializer = capacity
+            count.linkage = 'internal'
+        elif count is None:
+            count = entry_alloca(builder, index_type, name="comp.count")
+            entry_store(builder, capacity, count)
+        builder.store(ir.Constant(index_type, 0), count)
+
+        def append():
+            value = None
+            for position, stage in enumerate(stages):
+                if position > 0:
+                    mark_unsigned_value(module, value, is_unsigned(stages[position - 1].element, builder, module))
+                    builder.scope[stage.variables[0]] = value
+                if stage.condition is not None:
+                    keep = truth_value(builder, stage.condition.codegen(builder, module))
+                    kept = builder.append_basic_block("comp.keep")
+                    builder.cbranch(keep, kept, builder.continue_block)
+                    builder.position_at_start(kept)
+                value = stage.element.codegen(builder, module)
+            value = convert_value(builder, value, array_type.element,
+                                  not is_unsigned(stages[-1].element, builder, module))
+            index = builder.load(count, name="comp.index")
+            if bounded:
+                room = builder.append_basic_block("comp.store")
+                builder.cbranch(builder.icmp_unsigned('<', index, capacity), room, builder.break_block)
+                builder.position_at_start(room)
+            zero = ir.Constant(ir.IntType(32), 0)
+            store_value(builder, module, value, builder.gep(dest, [zero, index], inbounds=True), layout)
+            builder.store(builder.add(index, ir.Constant(index_type, 1), flags=['nuw']), count)
+
+        first = stages[0]
+        ForInLoop(first.variables, first.iterable, Block([])).lower(builder, module, append)
+
+        if partial:
+            # Elements past the ones produced read as zero
+            produced = builder.load(count, name="comp.length")
+            zero = ir.Constant(ir.IntType(32), 0)
+            size = target_layout(module).alloc_size(array_type.element)
+            tail = builder.mul(builder.sub(capacity, produced), ir.Constant(index_type, size))
+            fill_memory(builder, module, builder.gep(dest, [zero, produced], inbounds=True), 0, tail)
+            module._array_lengths[dest] = count
+
+    def fold(self, llvm_type: ir.Type, builder: ir.IRBuilder, module: ir.Module) -> Optional[List[ir.Constant]]:
+        """The elements as constants, for a global; None if a stage does not fold"""
+        stages = self.stages()
+        source = stages[0].iterable
+        if not isinstance(source, RangeExpression) or len(stages[0].variables) != 1:
+            return None
+        bounds = self.static_range(builder, module)
+        if bounds is None:
+            return None
+        int_type, first, last, unsigned = bounds
+        outer_scope = builder.scope
+        elements = []
+        marked = set()
+        try:
+            builder.scope = Scope()
+            for counter in range(first, last + 1):
+                value = int_constant(int_type, counter)
+                if unsigned and value not in getattr(module, '_unsigned_values', ()):
+                    # Reads as unsigned like the run time loop's counter, while folding only
+                    mark_unsigned_value(module, value, True)
+                    marked.add(value)
+                for position, stage in enumerate(stages):
+                    builder.scope[stage.variables[0]] = value
+                    if stage.condition is not None:
+                        keep = stage.condition.codegen(builder, module)
+                        if not isinstance(keep, ir.Constant):
+                            return None
+                        if not constant_int(keep):
+                            value = None
+                            break
+                    value = stage.element.codegen(builder, module)
+                    if not isinstance(value, ir.Constant):
+                        return None
+                if value is not None:
+                    elements.append(convert_constant(builder, value, llvm_type,
+                                                     not is_unsigned(stages[-1].element, builder, module)))
+        except (NameError, ValueError, AttributeError):
+            return None
+        finally:
+            builder.scope = outer_scope
+            if marked:
+                module._unsigned_values -= marked
+        return elements
 
 @dataclass
 class ReturnStatement(Statement):
     value: Optional[Expression] = None
 
     def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
-        if self.value is not None:
-            ret_val = self.value.codegen(builder, module)
-            # Ensure we're not returning a pointer
-            if isinstance(ret_val.type, ir.PointerType):
+        ret_val = self.value.codegen(builder, module) if self.value is not None else None
+        if ret_val is not None:  # return void; has no value either
+            # A pointer to the value is loaded, a pointer the function returns is not
+            return_type = builder.function.function_type.return_type
+            if isinstance(ret_val.type, ir.PointerType) and ret_val.type != return_type:
                 ret_val = builder.load(ret_val)
+        # Every block being left ends its objects, except one returned by value, which the caller now owns
+        returned = variable_slot(self.value, builder, module) if self.value is not None else None
+        leave_scopes(builder, module, None, keep=returned)
+        if ret_val is not None:
             builder.ret(ret_val)
         else:
             builder.ret_void()
@@ -724,11 +3086,23 @@ class ReturnStatement(Statement):
 
 @dataclass
 class BreakStatement(Statement):
-    pass
+    def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        target = getattr(builder, 'break_block', None)
+        if target is None:
+            raise ValueError("break outside of a loop")
+        leave_scopes(builder, module, builder.break_scope)
+        builder.branch(target)
+        return None
 
 @dataclass
 class ContinueStatement(Statement):
-    pass
+    def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        target = getattr(builder, 'continue_block', None)
+        if target is None:
+            raise ValueError("continue outside of a loop")
+        leave_scopes(builder, module, builder.continue_scope)
+        builder.branch(target)
+        return None
 
 @dataclass
 class Case(ASTNode):
@@ -740,20 +3114,710 @@ class SwitchStatement(Statement):
     expression: Expression
     cases: List[Case] = field(default_factory=list)
 
+    def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        """
+        Constant case values lower to a single LLVM switch, which the backend
+        turns into a jump table for dense values and a balanced compare tree
+        for sparse ones. Cases do not fall through; break leaves the switch.
+        """
+        value = self.expression.codegen(builder, module)
+        if not isinstance(value.type, ir.IntType):
+            raise ValueError(f"Cannot switch on {value.type}")
+
+        cases = [case for case in self.cases if case.value is not None]
+        defaults = [case for case in self.cases if case.value is None]
+        if len(defaults) > 1:
+            raise ValueError("switch has more than one default")
+
+        func = builder.block.function
+        case_blocks = [func.append_basic_block(f'switch.case{i}') for i in range(len(cases))]
+        default_block = func.append_basic_block('switch.default') if defaults else None
+        end_block = func.append_basic_block('switch.end')
+        otherwise = default_block or end_block
+
+        labels = [self._case_constant(case.value, value.type, builder, module) for case in cases]
+        if None not in labels:
+            dispatch = builder.switch(value, otherwise)
+            seen = set()
+            for label, block in zip(labels, case_blocks):
+                key = label.constant % (1 << value.type.width)
+                if key in seen:
+                    raise ValueError(f"Duplicate case value {label.constant} in switch")
+                seen.add(key)
+                dispatch.add_case(label, block)
+        else:
+            # Some case value is only known at run time, test every case in order
+            for case, block in zip(cases, case_blocks):
+                label = coerce_int(builder, case.value.codegen(builder, module), value.type)
+                next_block = func.append_basic_block('switch.next')
+                builder.cbranch(builder.icmp_signed('==', value, label), block, next_block)
+                builder.position_at_start(next_block)
+            builder.branch(otherwise)
+
+        old_break = getattr(builder, 'break_block', None), getattr(builder, 'break_scope', None)
+        builder.break_block, builder.break_scope = end_block, builder.scope
+        bodies = list(zip(cases, case_blocks)) + ([(defaults[0], default_block)] if defaults else [])
+        for case, block in bodies:
+            builder.position_at_start(block)
+            case.body.codegen(builder, module)
+            if not builder.block.is_terminated:
+                builder.branch(end_block)
+        builder.break_block, builder.break_scope = old_break
+
+        builder.position_at_start(end_block)
+        if not any(end_block in block.terminator.operands for block in func.blocks if block.is_terminated):
+            # Every case returned, nothing after the switch is reachable
+            builder.unreachable()
+        return None
+
+    @staticmethod
+    def _case_constant(expr: Expression, llvm_type: ir.IntType, builder: ir.IRBuilder,
+                       module: ir.Module) -> Optional[ir.Constant]:
+        """The case value as a constant of the switched type, or None if it needs evaluating"""
+        negate = isinstance(expr, UnaryOp) and expr.operator == Operator.SUB and not expr.is_postfix
+        if negate:
+            expr = expr.operand
+        if not isinstance(expr, Literal):
+            return None
+        constant = expr.codegen(builder, module)
+        if not isinstance(constant, ir.Constant) or not isinstance(constant.type, ir.IntType):
+            return None
+        return ir.Constant(llvm_type, -int(constant.constant) if negate else int(constant.constant))
+
+# ============ EXCEPTIONS ============
+# Table-based unwinding on the Itanium C++ ABI. throw hands the value to
+# __cxa_throw; a call made inside a try is an invoke whose unwind edge
+# leads to a landing pad, and the personality routine finds that pad and
+# the matching catch from the unwind tables. Until something throws, a
+# call in a try runs exactly like one outside it: no flag checks, no
+# saved contexts, no setup on entry to the try.
+
+def runtime_function(module: ir.Module, name: str, ret: ir.Type, args: List[ir.Type],
+                     var_arg: bool = False) -> ir.Function:
+    func = module.globals.get(name)
+    if func is None:
+        func = ir.Function(module, ir.FunctionType(ret, args, var_arg=var_arg), name)
+    return func
+
+def type_info(module: ir.Module, llvm_type: ir.Type) -> ir.Constant:
+    """
+    The std::type_info the personality routine matches thrown values and
+    catch clauses by, as i8*. Each module emits its own linkonce_odr copy
+    and the runtime compares them by name.
+    """
+    i8_ptr = ir.IntType(8).as_pointer()
+    key = llvm_type.name if isinstance(llvm_type, ir.IdentifiedStructType) else str(llvm_type)
+    info = module.globals.get(f"__flux_typeinfo.{key}")
+    if info is None:
+        text = bytearray(f"flux.{key}".encode('utf-8') + b'\0')
+        name = ir.GlobalVariable(module, ir.ArrayType(ir.IntType(8), len(text)), f"__flux_typename.{key}")
+        name.initializer = ir.Constant(name.type.pointee, text)
+        name.global_constant = True
+        name.linkage = 'linkonce_odr'
+
+        # A plain class type_info: its vtable past the offset-to-top and RTTI slots, then the name
+        vtable = module.globals.get('_ZTVN10__cxxabiv117__class_type_infoE')
+        if vtable is None:
+            vtable = ir.GlobalVariable(module, i8_ptr, '_ZTVN10__cxxabiv117__class_type_infoE')
+        record = ir.LiteralStructType([i8_ptr, i8_ptr])
+        info = ir.GlobalVariable(module, record, f"__flux_typeinfo.{key}")
+        info.initializer = ir.Constant(record, [
+            vtable.gep([ir.Constant(ir.IntType(64), 2)]).bitcast(i8_ptr),
+            name.gep([ir.Constant(ir.IntType(32), 0), ir.Constant(ir.IntType(32), 0)])])
+        info.global_constant = True
+        info.linkage = 'linkonce_odr'
+    return info.bitcast(i8_ptr)
+
+def catch_type(type_spec: Optional['TypeSpec'], module: ir.Module) -> Optional[ir.Type]:
+    """The type a catch clause matches; None for catch (auto x), which takes anything"""
+    if type_spec is None:
+        return None
+    return type_spec.get_llvm_type_with_array(module)
+
+@dataclass
+class HandlerScope:
+    """An enclosing try: the block its landing pads continue at and what its catches match"""
+    dispatch: ir.Block
+    catches: List[Optional[ir.Constant]]  # type_info per catch, None for a catch-all
+
+def exception_slots(builder: ir.IRBuilder) -> Tuple[ir.AllocaInstr, ir.AllocaInstr]:
+    """The function's slots for the caught exception and its selector, shared by all its landing pads"""
+    func = builder.function
+    if not hasattr(func, '_exception_slots'):
+        func._exception_slots = (entry_alloca(builder, ir.IntType(8).as_pointer(), 'exn.slot'),
+                                 entry_alloca(builder, ir.IntType(32), 'sel.slot'))
+    return func._exception_slots
+
+def landing_pad(builder: ir.IRBuilder, module: ir.Module, scopes: List[HandlerScope],
+                cleanup: Optional[ir.Function] = None) -> ir.Block:
+    """
+    The unwind destination for calls inside scopes, the innermost last. It
+    must list the catches of every enclosing try in the function, or the
+    unwinder would skip them; the innermost dispatch passes on whatever it
+    does not handle itself. A cleanup runs before dispatching.
+    """
+    func = builder.function
+    pad = func.append_basic_block('lpad')
+    saved = builder.block
+    builder.position_at_end(pad)
+    i8_ptr = ir.IntType(8).as_pointer()
+    landing = builder.landingpad(ir.LiteralStructType([i8_ptr, ir.IntType(32)]), 'exn',
+                                 cleanup=cleanup is not None)
+    listed = []
+    for scope in reversed(scopes):
+        for info in scope.catches:
+            if info is None or info in listed:
+                continue
+            listed.append(info)
+            landing.add_clause(ir.CatchClause(info))
+    if any(None in scope.catches for scope in scopes):
+        landing.add_clause(ir.CatchClause(ir.Constant(i8_ptr, None)))
+
+    exn_slot, sel_slot = exception_slots(builder)
+    builder.store(builder.extract_value(landing, 0), exn_slot)
+    builder.store(builder.extract_value(landing, 1), sel_slot)
+    if cleanup is not None:
+        builder.call(cleanup, [])
+    if scopes:
+        builder.branch(scopes[-1].dispatch)
+    else:
+        resume_unwinding(builder)
+    builder.position_at_end(saved)
+    return pad
+
+def resume_unwinding(builder: ir.IRBuilder) -> None:
+    """Continue unwinding into the caller with the exception in the slots"""
+    exn_slot, sel_slot = exception_slots(builder)
+    i8_ptr = ir.IntType(8).as_pointer()
+    exception = ir.Constant(ir.LiteralStructType([i8_ptr, ir.IntType(32)]), None)
+    exception = builder.insert_value(exception, builder.load(exn_slot), 0)
+    exception = builder.insert_value(exception, builder.load(sel_slot), 1)
+    builder.resume(exception)
+
+def emit_call(builder: ir.IRBuilder, func: ir.Value, args: List[ir.Value]) -> ir.Value:
+    """A call, or within a try an invoke that unwinds to the try's landing pad"""
+    unwind_block = getattr(builder, 'unwind_block', None)
+    if unwind_block is None or (isinstance(func, ir.Function) and 'nounwind' in func.attributes):
+        return builder.call(func, args)
+    normal = builder.append_basic_block('invoke.cont')
+    result = builder.invoke(func, args, normal, unwind_block)
+    builder.position_at_end(normal)
+    return result
+
+def may_unwind(instr: ir.Instruction, unwinding: set) -> bool:
+    if instr.opname == 'resume':
+        return True
+    if not isinstance(instr, ir.CallInstr):
+        return False
+    if isinstance(instr.callee, ir.InlineAsm):
+        return False
+    if not isinstance(instr.callee, ir.Function):
+        return True  # Through a function pointer: anything
+    callee = instr.callee
+    if callee.name.startswith('llvm.') or 'nounwind' in callee.attributes:
+        return False
+    # Defined in another module, or found to throw
+    return callee.is_declaration or callee in unwinding
+
+def infer_nounwind(module: ir.Module) -> None:
+    """
+    Mark nounwind every function defined here that cannot throw: no throw of
+    its own and only calls to functions that cannot throw either. LLVM emits
+    no unwind table entry for nounwind functions and turns invokes of them
+    into plain calls.
+    """
+    defined = [func for func in module.functions if func.blocks and 'nounwind' not in func.attributes]
+    # Optimistic: a call cycle with no throw anywhere in it cannot throw
+    unwinding = set()
+    changed = True
+    while changed:
+        changed = False
+        for func in defined:
+            if func not in unwinding and any(may_unwind(instr, unwinding)
+                                             for block in func.blocks for instr in block.instructions):
+                unwinding.add(func)
+                changed = True
+    for func in defined:
+        if func not in unwinding:
+            add_function_attribute(func, 'nounwind')
+
 @dataclass
 class TryBlock(Statement):
     try_body: Block
     catch_blocks: List[tuple] = field(default_factory=list)  # (exception_type, exception_name, body) tuples
 
+    def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> None:
+        i8_ptr = ir.IntType(8).as_pointer()
+        func = builder.function
+        func.attributes.personality = runtime_function(module, '__gxx_personality_v0', ir.IntType(32), [], var_arg=True)
+        begin_catch = runtime_function(module, '__cxa_begin_catch', i8_ptr, [i8_ptr])
+        end_catch = runtime_function(module, '__cxa_end_catch', ir.VoidType(), [])
+
+        outer = getattr(builder, 'handler_scopes', [])
+        outer_unwind = getattr(builder, 'unwind_block', None)
+        types = [catch_type(type_spec, module) for type_spec, _, _ in self.catch_blocks]
+        scope = HandlerScope(func.append_basic_block('try.dispatch'),
+                             [None if t is None else type_info(module, t) for t in types])
+        end_block = func.append_basic_block('try.end')
+
+        builder.handler_scopes = outer + [scope]
+        builder.unwind_block = landing_pad(builder, module, builder.handler_scopes)
+        self.try_body.codegen(builder, module)
+        builder.handler_scopes = outer
+        builder.unwind_block = outer_unwind
+        if not builder.block.is_terminated:
+            builder.branch(end_block)
+
+        # Pick the catch by the selector the personality routine stored
+        exn_slot, sel_slot = exception_slots(builder)
+        builder.position_at_end(scope.dispatch)
+        selector = builder.load(sel_slot)
+        handlers = []
+        for info in scope.catches:
+            handler = func.append_basic_block('catch')
+            handlers.append(handler)
+            if info is None:
+                builder.branch(handler)
+                break
+            typeid = builder.call(module.declare_intrinsic('llvm.eh.typeid.for', (),
+                                  ir.FunctionType(ir.IntType(32), [i8_ptr])), [info])
+            next_block = func.append_basic_block('catch.next')
+            builder.cbranch(builder.icmp_signed('==', selector, typeid), handler, next_block)
+            builder.position_at_end(next_block)
+        if not builder.block.is_terminated:
+            # Not ours: on to the enclosing try, or out of the function
+            if outer:
+                builder.branch(outer[-1].dispatch)
+            else:
+                resume_unwinding(builder)
+
+        for handler, llvm_type, (_, name, body) in zip(handlers, types, self.catch_blocks):
+            builder.position_at_end(handler)
+            caught = builder.call(begin_catch, [builder.load(exn_slot)])
+            old_scope = builder.scope
+            builder.scope = old_scope.child()
+            if llvm_type is None:
+                slot = entry_alloca(builder, i8_ptr, name)
+                builder.store(caught, slot)
+            else:
+                slot = entry_alloca(builder, llvm_type, name)
+                builder.store(builder.load(builder.bitcast(caught, llvm_type.as_pointer())), slot)
+            builder.scope[name] = slot
+
+            # A throw out of the handler still ends the catch before it propagates
+            builder.unwind_block = landing_pad(builder, module, outer, cleanup=end_catch)
+            body.codegen(builder, module)
+            builder.unwind_block = outer_unwind
+            if not builder.block.is_terminated:
+                builder.call(end_catch, [])
+                builder.branch(end_block)
+            builder.scope = old_scope
+
+        builder.position_at_end(end_block)
+        return None
+
 @dataclass
 class ThrowStatement(Statement):
     expression: Expression
 
+    def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> None:
+        if getattr(builder.function, '_const', False):
+            raise ValueError(f"{builder.function.name} is const and cannot throw")
+        value = self.expression.codegen(builder, module)
+        if value is None or isinstance(value.type, ir.VoidType):
+            raise ValueError("throw needs a value")
+        i8_ptr = ir.IntType(8).as_pointer()
+        allocate = runtime_function(module, '__cxa_allocate_exception', i8_ptr, [ir.IntType(64)])
+        throw = runtime_function(module, '__cxa_throw', ir.VoidType(), [i8_ptr, i8_ptr, i8_ptr])
+        add_function_attribute(throw, 'noreturn')
+
+        size = max(target_layout(module).alloc_size(value.type), 1)
+        exception = builder.call(allocate, [ir.Constant(ir.IntType(64), size)])
+        builder.store(value, builder.bitcast(exception, value.type.as_pointer()))
+        # A throw inside a try unwinds to that try's landing pad like any other call would
+        emit_call(builder, throw, [exception, type_info(module, value.type), ir.Constant(i8_ptr, None)])
+        builder.unreachable()
+        return None
+
 @dataclass
 class AssertStatement(Statement):
     condition: Expression
     message: Optional[str] = None
 
+# ============ COMPILE-TIME EXECUTION ============
+# compt blocks run inside the compiler. Values are ir.Constants combined by
+# the same folding rules as generated code, so a table computed at compile
+# time holds exactly what the equivalent loop would have stored at run time.
+
+@dataclass
+class ComptVariable:
+    llvm_type: ir.Type
+    value: Any                    # ir.Constant, or a list of element values for an array
+    unsigned: bool
+    declaration: Optional['VariableDeclaration'] = None
+
+class _ComptBreak(Exception):
+    pass
+
+class _ComptContinue(Exception):
+    pass
+
+class _ComptReturn(Exception):
+    def __init__(self, value):
+        self.value = value
+
+class ComptInterpreter:
+    """
+    Executes the statements of a compt block. Variables declared at its top
+    level become initialized globals of the program; functions defined in it
+    only exist at compile time. Expressions evaluate to (value, unsigned)
+    pairs, where an array value is a list of such pairs.
+    """
+    def __init__(self, builder: ir.IRBuilder, module: ir.Module):
+        self.builder = builder  # At global scope, so codegen here can only fold
+        self.module = module
+        self.scopes = [{}]
+        self.functions = {}
+
+    def run(self, body: 'Block') -> None:
+        for stmt in body.statements:
+            try:
+                self.execute(stmt)
+            except _ComptReturn:
+                raise ValueError("return outside of a function in a compt block")
+            except (_ComptBreak, _ComptContinue):
+                raise ValueError("break or continue outside of a loop in a compt block")
+        for name, var in self.scopes[0].items():
+            if name in self.module.globals:
+                raise ValueError(f"compt block redefines global '{name}'")
+            var.declaration.define_global(self.module, var.llvm_type, self.constant(var.llvm_type, var.value))
+
+    # Statements
+
+    def execute(self, stmt: 'Statement') -> None:
+        if isinstance(stmt, ExpressionStatement):
+            if isinstance(stmt.expression, VariableDeclaration):
+                self.declare(stmt.expression)
+            else:
+                self.evaluate(stmt.expression)
+        elif isinstance(stmt, Assignment):
+            self.assign(stmt)
+        elif isinstance(stmt, Block):
+            self.execute_block(stmt)
+        elif isinstance(stmt, IfStatement):
+            for condition, block in [(stmt.condition, stmt.then_block)] + list(stmt.elif_blocks):
+                if self.truth(condition):
+                    self.execute_block(block)
+                    return
+            if stmt.else_block is not None:
+                self.execute_block(stmt.else_block)
+        elif isinstance(stmt, WhileLoop):
+            while self.truth(stmt.condition) and self.iterate(stmt.body):
+                pass
+        elif isinstance(stmt, DoWhileLoop):
+            while self.iterate(stmt.body) and self.truth(stmt.condition):
+                pass
+        elif isinstance(stmt, ForLoop):
+            self.scopes.append({})
+            try:
+                if stmt.init is not None:
+                    self.execute(stmt.init)
+                while stmt.condition is None or self.truth(stmt.condition):
+                    if not self.iterate(stmt.body):
+                        break
+                    if stmt.update is not None:
+                        self.execute(stmt.update)
+            finally:
+                self.scopes.pop()
+        elif isinstance(stmt, ForInLoop):
+            self.scopes.append({})
+            try:
+                self.for_in(stmt)
+            finally:
+                self.scopes.pop()
+        elif isinstance(stmt, ReturnStatement):
+            raise _ComptReturn(self.evaluate(stmt.value) if stmt.value is not None else None)
+        elif isinstance(stmt, BreakStatement):
+            raise _ComptBreak()
+        elif isinstance(stmt, ContinueStatement):
+            raise _ComptContinue()
+        elif isinstance(stmt, FunctionDef):
+            self.functions[stmt.name] = stmt
+        elif isinstance(stmt, AssertStatement):
+            # A failed contract at compile time halts compilation
+            if not self.truth(stmt.condition):
+                raise ValueError(f"compt assertion failed{': ' + stmt.message if stmt.message else ''}")
+        elif isinstance(stmt, TypeDeclaration):
+            stmt.codegen(self.builder, self.module)
+        else:
+            raise ValueError(f"{type(stmt).__name__} cannot run in a compt block")
+
+    def execute_block(self, block: 'Block') -> None:
+        self.scopes.append({})
+        try:
+            for stmt in block.statements:
+                self.execute(stmt)
+        finally:
+            self.scopes.pop()
+
+    def iterate(self, body: 'Block') -> bool:
+        """Run one loop iteration; False once the body breaks out"""
+        try:
+            self.execute_block(body)
+        except _ComptBreak:
+            return False
+        except _ComptContinue:
+            pass
+        return True
+
+    def for_in(self, stmt: 'ForInLoop') -> None:
+        scope = self.scopes[-1]
+        if isinstance(stmt.iterable, RangeExpression):
+            if len(stmt.variables) != 1:
+                raise ValueError("A range loop takes one variable")
+            start, start_unsigned = self.scalar(stmt.iterable.start)
+            end, end_unsigned = self.scalar(stmt.iterable.end)
+            if constant_int(start) is None or constant_int(end) is None:
+                raise ValueError("compt range bounds must be integers")
+            # Counts like the run time loop: at the wider bound type, inclusive
+            int_type = start.type if start.type.width >= end.type.width else end.type
+            unsigned = start_unsigned or end_unsigned
+            first = convert_constant(self.builder, start, int_type, not start_unsigned)
+            last = convert_constant(self.builder, end, int_type, not end_unsigned)
+            value = constant_int(first) if unsigned else _signed(constant_int(first), int_type.width)
+            stop = constant_int(last) if unsigned else _signed(constant_int(last), int_type.width)
+            while value <= stop:
+                scope[stmt.variables[0]] = ComptVariable(int_type, int_constant(int_type, value), unsigned)
+                if not self.iterate(stmt.body):
+                    break
+                value += 1
+            return
+        if len(stmt.variables) > 2:
+            raise ValueError("An array loop takes an element variable and an optional index")
+        elements, _ = self.evaluate(stmt.iterable)
+        if not isinstance(elements, list):
+            raise ValueError("for-in needs a range (a..b) or a fixed-size array")
+        *index_name, element_name = stmt.variables
+        index_type = ir.IntType(64)
+        for index, (element, unsigned) in enumerate(elements):
+            if index_name:
+                scope[index_name[0]] = ComptVariable(index_type, ir.Constant(index_type, index), False)
+            scope[element_name] = ComptVariable(element.type, element, unsigned)
+            if not self.iterate(stmt.body):
+                break
+
+    def declare(self, decl: 'VariableDeclaration') -> None:
+        llvm_type = decl.type_spec.get_llvm_type_with_array(self.module)
+        if decl.initial_value is not None:
+            value = self.convert(self.evaluate(decl.initial_value), llvm_type)
+        else:
+            value = self.zero(llvm_type)
+        unsigned = is_unsigned_type(decl.type_spec, self.module)
+        self.scopes[-1][decl.name] = ComptVariable(llvm_type, value, unsigned, decl)
+
+    def assign(self, stmt: 'Assignment') -> tuple:
+        target = stmt.target
+        if isinstance(target, Identifier):
+            var = self.variable(target.name)
+            var.value = self.convert(self.evaluate(stmt.value), var.llvm_type)
+            return self.read(var.value, var.unsigned)
+        if isinstance(target, ArrayAccess) and isinstance(target.array, Identifier):
+            var = self.variable(target.array.name)
+            if not isinstance(var.llvm_type, ir.ArrayType):
+                raise ValueError(f"'{target.array.name}' is not an array")
+            index = self.index(target.index, len(var.value))
+            var.value[index] = self.convert(self.evaluate(stmt.value), var.llvm_type.element)
+            return self.read(var.value[index], var.unsigned)
+        raise ValueError(f"Unsupported assignment target in a compt block: {type(target).__name__}")
+
+    def variable(self, name: str) -> ComptVariable:
+        """
+        A compt variable being written. const ones included: the block is
+        what computes them, they are read-only to the program it emits.
+        """
+        var = self.lookup(name)
+        if var is None:
+            raise NameError(f"Cannot assign to {name} in a compt block")
+        return var
+
+    def lookup(self, name: str) -> Optional[ComptVariable]:
+        for scope in reversed(self.scopes):
+            if name in scope:
+                return scope[name]
+        return None
+
+    # Expressions
+
+    def evaluate(self, expr: 'Expression') -> tuple:
+        if isinstance(expr, Identifier):
+            var = self.lookup(expr.name)
+            if var is not None:
+                return self.read(var.value, var.unsigned)
+            table = getattr(self.module, '_constants', {}).get(expr.name)
+            if table is not None and isinstance(table.type, ir.ArrayType):
+                gvar = self.module.globals[expr.name]
+                return self.read(list(table.constant), gvar in getattr(self.module, '_unsigned_values', ()))
+        elif isinstance(expr, Literal) and isinstance(expr.value, list):
+            return [self.evaluate(item) for item in expr.value], False
+        elif isinstance(expr, ArrayAccess):
+            elements, _ = self.evaluate(expr.array)
+            if not isinstance(elements, list):
+                raise ValueError("Indexing a value that is not an array in a compt block")
+            return elements[self.index(expr.index, len(elements))]
+        elif isinstance(expr, Assignment):
+            return self.assign(expr)
+        elif isinstance(expr, CastExpression):
+            value, unsigned = self.scalar(expr.expression)
+            llvm_type = expr.target_type.get_llvm_type_with_array(self.module)
+            return (convert_constant(self.builder, value, llvm_type, not unsigned),
+                    is_unsigned_type(expr.target_type, self.module))
+        elif isinstance(expr, BinaryOp):
+            left, left_unsigned = self.scalar(expr.left)
+            right, right_unsigned = self.scalar(expr.right)
+            result = fold_binary(expr.operator, left, right, left_unsigned, right_unsigned)
+            if result is None:
+                raise ValueError(f"compt: cannot evaluate {left} {expr.operator.value} {right}")
+            if expr.operator in COMPARISON_OPERATORS:
+                return result, False
+            if expr.operator in (Operator.BITSHIFT_LEFT, Operator.BITSHIFT_RIGHT,
+                                 Operator.ROTATE_LEFT, Operator.ROTATE_RIGHT):
+                return result, left_unsigned
+            return result, left_unsigned or right_unsigned
+        elif isinstance(expr, UnaryOp):
+            if expr.operator in (Operator.INCREMENT, Operator.DECREMENT):
+                return self.step(expr)
+            value, unsigned = self.scalar(expr.operand)
+            result = fold_unary(expr.operator, value)
+            if result is None:
+                raise ValueError(f"compt: cannot apply {expr.operator.value} to {value}")
+            return result, unsigned and expr.operator != Operator.NOT
+        elif isinstance(expr, FunctionCall):
+            if expr.name in self.functions:
+                return self.call(self.functions[expr.name], expr.arguments)
+            if expr.name in BIT_BUILTINS:
+                return self.bit_builtin(expr)
+
+        # Literals, sizeof/alignof and const globals fold on their own
+        if isinstance(expr, (Literal, Identifier, SizeOf, AlignOf)):
+            value = expr.codegen(self.builder, self.module)
+            if isinstance(value, ir.Constant):
+                return value, is_unsigned(expr, self.builder, self.module)
+        raise ValueError(f"{type(expr).__name__} is not resolvable at compile time")
+
+    def scalar(self, expr: 'Expression') -> tuple:
+        value, unsigned = self.evaluate(expr)
+        if not isinstance(value, ir.Constant):
+            raise ValueError("compt: expected a scalar value")
+        return value, unsigned
+
+    def truth(self, expr: 'Expression') -> bool:
+        value, _ = self.scalar(expr)
+        negated = fold_unary(Operator.NOT, value)
+        if negated is None:
+            raise ValueError(f"Cannot use {value.type} as a condition")
+        return not negated.constant
+
+    def index(self, expr: 'Expression', count: int) -> int:
+        value, unsigned = self.scalar(expr)
+        if constant_int(value) is None:
+            raise ValueError("compt: array index must be an integer")
+        index = constant_int(value) if unsigned else _signed(constant_int(value), value.type.width)
+        if not 0 <= index < count:
+            raise ValueError(f"compt: index {index} is out of bounds for an array of {count}")
+        return index
+
+    def step(self, expr: 'UnaryOp') -> tuple:
+        if not isinstance(expr.operand, Identifier):
+            raise ValueError(f"compt: {expr.operator.value} needs a variable")
+        var = self.variable(expr.operand.name)
+        old = var.value
+        operator = Operator.ADD if expr.operator == Operator.INCREMENT else Operator.SUB
+        new = fold_binary(operator, old, ir.Constant(old.type, 1), var.unsigned, var.unsigned) if isinstance(old, ir.Constant) else None
+        if new is None:
+            raise ValueError(f"compt: cannot apply {expr.operator.value} to '{expr.operand.name}'")
+        var.value = new
+        return (old if expr.is_postfix else new), var.unsigned
+
+    def call(self, func: 'FunctionDef', arguments: List['Expression']) -> tuple:
+        if len(arguments) != len(func.parameters):
+            raise ValueError(f"{func.name} takes {len(func.parameters)} arguments, got {len(arguments)}")
+        frame = {}
+        for param, arg in zip(func.parameters, arguments):
+            llvm_type = param.type_spec.get_llvm_type_with_array(self.module)
+            frame[param.name] = ComptVariable(llvm_type, self.convert(self.evaluate(arg), llvm_type),
+                                              is_unsigned_type(param.type_spec, self.module))
+        # Functions see the block's top level, not their caller's locals
+        saved = self.scopes
+        self.scopes = [saved[0], frame]
+        try:
+            self.execute_block(func.body)
+            result = None
+        except _ComptReturn as ret:
+            result = ret.value
+        except (_ComptBreak, _ComptContinue):
+            raise ValueError(f"break or continue outside of a loop in {func.name}")
+        finally:
+            self.scopes = saved
+        ret_type = func.return_type.get_llvm_type_with_array(self.module)
+        if isinstance(ret_type, ir.VoidType) or result is None:
+            return None, False
+        return self.read(self.convert(result, ret_type), is_unsigned_type(func.return_type, self.module))
+
+    def bit_builtin(self, expr: 'FunctionCall') -> tuple:
+        arity, _ = BIT_BUILTINS[expr.name]
+        if len(expr.arguments) != arity:
+            raise ValueError(f"{expr.name} takes {arity} argument{'s' if arity > 1 else ''}, got {len(expr.arguments)}")
+        args = [self.scalar(arg) for arg in expr.arguments]
+        value, unsigned = args[0]
+        coerced = [value] + [convert_constant(self.builder, arg, value.type, False) for arg, _ in args[1:]]
+        result = fold_bit_builtin(expr.name, coerced)
+        if result is None:
+            raise ValueError(f"compt: {expr.name} needs integer arguments")
+        return result, unsigned
+
+    # Values
+
+    def convert(self, evaluated: tuple, llvm_type: ir.Type) -> Any:
+        """An evaluated value as storage of llvm_type"""
+        value, unsigned = evaluated
+        if isinstance(llvm_type, ir.ArrayType):
+            if not isinstance(value, list):
+                raise ValueError(f"compt: cannot store a scalar in {llvm_type}")
+            if len(value) > llvm_type.count:
+                raise ValueError(f"compt: {len(value)} values for an array of {llvm_type.count}")
+            elements = [self.convert(item, llvm_type.element) for item in value]
+            return elements + [self.zero(llvm_type.element) for _ in range(llvm_type.count - len(elements))]
+        if not isinstance(value, ir.Constant):
+            raise ValueError(f"compt: cannot store an array in {llvm_type}")
+        return convert_constant(self.builder, value, llvm_type, not unsigned)
+
+    def read(self, value: Any, unsigned: bool) -> tuple:
+        """Storage back as an evaluated value"""
+        if isinstance(value, list):
+            return [self.read(item, unsigned) for item in value], unsigned
+        return value, unsigned
+
+    def zero(self, llvm_type: ir.Type) -> Any:
+        if isinstance(llvm_type, ir.ArrayType):
+            return [self.zero(llvm_type.element) for _ in range(llvm_type.count)]
+        return zero_constant(llvm_type)
+
+    def constant(self, llvm_type: ir.Type, value: Any) -> ir.Constant:
+        if isinstance(value, list):
+            return ir.Constant(llvm_type, [self.constant(llvm_type.element, item) for item in value])
+        return value
+
+@dataclass
+class ComptBlock(Statement):
+    """compt { ... }; evaluated while compiling, never at run time"""
+    body: 'Block'
+
+    def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Value:
+        if builder.scope is not None:
+            raise ValueError("compt blocks can only be declared in global scope")
+        ComptInterpreter(builder, module).run(self.body)
+        return None
+
 # Function parameter
 @dataclass
 class Parameter(ASTNode):
@@ -766,6 +3830,273 @@ class InlineAsm(Expression):
     body: str  # The raw assembly code
     is_volatile: bool = False  # New flag for volatile assembly
 
+# ============ FUNCTION ATTRIBUTES ============
+
+# Source annotations and the LLVM attributes they become
+FUNCTION_ANNOTATIONS = {
+    'inline': 'alwaysinline',
+    'noinline': 'noinline',
+    'cold': 'cold',
+    'hot': 'hot',
+}
+
+def add_function_attribute(func: ir.Function, name: str) -> None:
+    if name in func.attributes._known:
+        func.attributes.add(name)
+    else:
+        # llvmlite checks against a fixed list that predates some attributes (hot)
+        set.add(func.attributes, name)
+
+def is_exported(module: ir.Module, name: str) -> bool:
+    """
+    Whether code outside this module may call name. A whole-program build
+    links everything it imports into one module, so only main needs an
+    external symbol; separately compiled modules export everything to
+    their importers.
+    """
+    return name == 'main' or getattr(module, '_export_globals', False)
+
+def apply_function_attributes(func: ir.Function, definition: 'FunctionDef', module: ir.Module,
+                              this_type: Optional[ir.Type] = None) -> None:
+    """Linkage and the attributes a definition's annotations and signature allow"""
+    for annotation in definition.attributes:
+        add_function_attribute(func, FUNCTION_ANNOTATIONS[annotation])
+
+    if definition.is_const:
+        func._const = True
+        if definition.is_prototype:
+            # A const declaration is taken at its word; a definition is checked by apply_const_attributes
+            reads_memory = any(isinstance(arg.type, ir.PointerType) for arg in func.args)
+            add_function_attribute(func, 'readonly' if reads_memory else 'readnone')
+            add_function_attribute(func, 'nounwind')
+
+    if this_type is not None:
+        this = func.args[0]
+        this.add_attribute('nonnull')
+        size = target_layout(module).alloc_size(this_type)
+        if size:
+            this.attributes.dereferenceable = size
+
+    if codegen_options(module).frame_pointers and not definition.is_prototype:
+        add_function_attribute(func, '"frame-pointer"="all"')
+
+    if not definition.is_prototype and not is_exported(module, func.name):
+        func.linkage = 'internal'
+        module._local_functions = getattr(module, '_local_functions', [])
+        module._local_functions.append(func)
+
+def memory_root(pointer: ir.Value) -> ir.Value:
+    """The allocation pointer points into: what is left after its geps and casts"""
+    while isinstance(pointer, ir.Instruction) and pointer.opname in ('getelementptr', 'bitcast'):
+        pointer = pointer.operands[0]
+    return pointer
+
+def is_instrumentation(value: ir.Value) -> bool:
+    """A counter or hook of a profiling build, which every function touches"""
+    name = getattr(value, 'name', '')
+    return name.startswith('__flux_prof.') or name in INSTRUMENT_HOOKS
+
+def apply_const_attributes(func: ir.Function, definition: 'FunctionDef') -> None:
+    """
+    Check the body of a const function and mark it readnone, or readonly if
+    it reads memory other than its locals and constants, and nounwind. The
+    body may store only to its own locals and call only itself, intrinsics
+    and functions already known const: declare a const function ahead of
+    its first call when the definition comes later.
+    """
+    reads_memory = False
+    instrumented = False
+
+    def reject(reason: str) -> None:
+        raise ValueError(f"const function {definition.name} {reason}")
+
+    for block in func.blocks:
+        for instr in block.instructions:
+            if isinstance(instr, ir.CallInstr):
+                callee = instr.callee
+                if is_instrumentation(callee):
+                    instrumented = True
+                elif callee is func:
+                    continue
+                elif not isinstance(callee, ir.Function):
+                    reject("calls through a pointer or inline assembly")
+                elif callee.name.startswith(('llvm.memcpy', 'llvm.memmove', 'llvm.memset')):
+                    if not isinstance(memory_root(instr.args[0]), ir.AllocaInstr):
+                        reject("writes to memory outside its locals")
+                    if not callee.name.startswith('llvm.memset') and \
+                            not isinstance(memory_root(instr.args[1]), ir.AllocaInstr):
+                        reads_memory = True
+                elif callee.name.startswith('llvm.'):
+                    continue
+                elif 'readonly' in callee.attributes:
+                    reads_memory = True
+                elif 'readnone' not in callee.attributes:
+                    reject(f"calls {callee.name}, which is not const")
+            elif instr.opname in ('store', 'atomicrmw', 'cmpxchg'):
+                target = memory_root(instr.operands[1] if instr.opname == 'store' else instr.operands[0])
+                if is_instrumentation(target):
+                    instrumented = True
+                elif not isinstance(target, ir.AllocaInstr):
+                    reject("writes to memory outside its locals")
+            elif instr.opname == 'load':
+                source = memory_root(instr.operands[0])
+                if is_instrumentation(source):
+                    instrumented = True
+                elif not isinstance(source, ir.AllocaInstr) and \
+                        not (isinstance(source, ir.GlobalVariable) and source.global_constant):
+                    reads_memory = True
+
+    # A const declaration ahead of the body may have guessed differently
+    func.attributes.discard('readnone')
+    func.attributes.discard('readonly')
+    if not instrumented:
+        # Profiling counters are written on every call, so calls must not be merged then
+        add_function_attribute(func, 'readonly' if reads_memory else 'readnone')
+    add_function_attribute(func, 'nounwind')
+
+def mark_escaped(module: ir.Module, func: ir.Function) -> None:
+    """func is used as a value, so it may be called from code that only knows the C convention"""
+    if not hasattr(module, '_escaped_functions'):
+        module._escaped_functions = set()
+    module._escaped_functions.add(func.name)
+
+def assign_calling_conventions(module: ir.Module) -> None:
+    """
+    Switch internal functions whose address never escapes to fastcc. Every
+    call to them is in this module, so the call sites are rewritten to match.
+    """
+    escaped = getattr(module, '_escaped_functions', set())
+    local = {func for func in getattr(module, '_local_functions', []) if func.name not in escaped}
+    if not local:
+        return
+    for func in local:
+        func.calling_convention = 'fastcc'
+    for func in module.functions:
+        for block in func.blocks:
+            for instr in block.instructions:
+                if isinstance(instr, ir.CallInstr) and instr.callee in local:
+                    instr.cconv = 'fastcc'
+
+# ============ PROFILING BUILDS ============
+# Switches for binaries that are meant to be profiled. -g emits DWARF
+# line tables: a DISubprogram per function and a DILocation for every
+# statement, so perf and debuggers attribute samples to .fx lines rather
+# than mangled symbols and raw addresses. Variables and types are not
+# described. --frame-pointers keeps the frame pointer chain that
+# stack-walking profilers follow. --instrument-functions calls the hooks
+# of GCC's -finstrument-functions on entry to and return from every
+# function, so existing tracers work unchanged.
+
+@dataclass(frozen=True)
+class CodegenOptions:
+    debug_info: bool = False
+    frame_pointers: bool = False
+    instrument_functions: bool = False
+
+INSTRUMENT_HOOKS = ('__cyg_profile_func_enter', '__cyg_profile_func_exit')
+
+class DebugInfo:
+    """The module's compile unit, and a DIFile per source file that contributes code"""
+    def __init__(self, module: ir.Module, source: Path, optimized: bool):
+        self.module = module
+        self.files = {}
+        self.file = self.file_for(source)
+        self.compile_unit = module.add_debug_info("DICompileUnit", {
+            "language": ir.DIToken("DW_LANG_C"),
+            "file": self.file,
+            "producer": "Flux fc.py",
+            "runtimeVersion": 0,
+            "isOptimized": optimized,
+            "emissionKind": ir.DIToken("LineTablesOnly"),
+        }, is_distinct=True)
+        module.add_named_metadata("llvm.dbg.cu", self.compile_unit)
+        i32 = ir.IntType(32)
+        # 2: keep the larger value when modules with different versions are linked
+        module.add_named_metadata("llvm.module.flags", [ir.Constant(i32, 2), "Dwarf Version", ir.Constant(i32, 4)])
+        module.add_named_metadata("llvm.module.flags", [ir.Constant(i32, 2), "Debug Info Version", ir.Constant(i32, 3)])
+        self.subroutine_type = module.add_debug_info("DISubroutineType", {"types": module.add_metadata([])})
+
+    def file_for(self, path: Path):
+        path = Path(path).resolve()
+        if path not in self.files:
+            self.files[path] = self.module.add_debug_info(
+                "DIFile", {"filename": path.name, "directory": str(path.parent)})
+        return self.files[path]
+
+def apply_codegen_options(module: ir.Module, options: CodegenOptions, source: Path, optimized: bool) -> None:
+    """Set up module for options; source is the file its code comes from"""
+    module._codegen_options = options
+    if options.debug_info:
+        module._debug = DebugInfo(module, source, optimized)
+
+def codegen_options(module: ir.Module) -> CodegenOptions:
+    return getattr(module, '_codegen_options', None) or CodegenOptions()
+
+def debug_location(builder: ir.IRBuilder, module: ir.Module, node: ASTNode) -> None:
+    """Attribute what node generates to its source line"""
+    scope = getattr(builder, 'debug_scope', None)
+    if scope is not None and node.line:
+        builder.debug_metadata = module.add_debug_info(
+            "DILocation", {"line": node.line, "column": node.column, "scope": scope})
+
+def begin_function(builder: ir.IRBuilder, module: ir.Module, func: ir.Function,
+                   definition: ASTNode, name: str) -> None:
+    """At the top of func's entry block: its debug scope, then the entry hook"""
+    debug = getattr(module, '_debug', None)
+    builder.debug_scope = None
+    builder.debug_metadata = None
+    if debug is not None:
+        line = definition.line or 1  # Definitions built by the compiler have no source line
+        builder.debug_scope = module.add_debug_info("DISubprogram", {
+            "name": name,
+            "linkageName": func.name,
+            "scope": debug.file,
+            "file": debug.file,
+            "line": line,
+            "type": debug.subroutine_type,
+            "scopeLine": line,
+            "isLocal": func.linkage == 'internal',
+            "isDefinition": True,
+            "unit": debug.compile_unit,
+        }, is_distinct=True)
+        func.set_metadata('dbg', builder.debug_scope)
+        # Prologue code belongs to the definition's line
+        builder.debug_metadata = module.add_debug_info(
+            "DILocation", {"line": line, "column": definition.column, "scope": builder.debug_scope})
+
+    if codegen_options(module).instrument_functions and func.name not in INSTRUMENT_HOOKS:
+        enter, _ = instrument_hooks(module)
+        builder.call(enter, hook_arguments(builder, module, func))
+
+def end_function(builder: ir.IRBuilder, module: ir.Module, func: ir.Function) -> None:
+    """Call the exit hook before each of func's returns; unwinding out of func skips it"""
+    if codegen_options(module).instrument_functions and func.name not in INSTRUMENT_HOOKS:
+        _, leave = instrument_hooks(module)
+        for block in func.blocks:
+            terminator = block.terminator
+            if terminator is None or terminator.opname != 'ret':
+                continue
+            exit_builder = ir.IRBuilder(block)
+            exit_builder.position_before(terminator)
+            exit_builder.debug_metadata = terminator.metadata.get('dbg')
+            exit_builder.call(leave, hook_arguments(exit_builder, module, func))
+    check_releases(module, func)
+    builder.debug_scope = None
+    builder.debug_metadata = None
+
+def instrument_hooks(module: ir.Module) -> Tuple[ir.Function, ir.Function]:
+    """void hook(void *this_fn, void *call_site), declared nounwind so they leave nounwind inference alone"""
+    i8_ptr = ir.IntType(8).as_pointer()
+    hooks = tuple(runtime_function(module, name, ir.VoidType(), [i8_ptr, i8_ptr]) for name in INSTRUMENT_HOOKS)
+    for hook in hooks:
+        add_function_attribute(hook, 'nounwind')
+    return hooks
+
+def hook_arguments(builder: ir.IRBuilder, module: ir.Module, func: ir.Function) -> List[ir.Value]:
+    i8_ptr = ir.IntType(8).as_pointer()
+    return_address = runtime_function(module, 'llvm.returnaddress', i8_ptr, [ir.IntType(32)])
+    return [func.bitcast(i8_ptr), builder.call(return_address, [ir.Constant(ir.IntType(32), 0)])]
+
 # Function definition
 @dataclass
 class FunctionDef(ASTNode):
@@ -776,19 +4107,29 @@ class FunctionDef(ASTNode):
     is_const: bool = False
     is_volatile: bool = False
     is_prototype: bool = False
+    attributes: dict = field(default_factory=dict)  # inline, noinline, cold, hot; see FUNCTION_ANNOTATIONS
 
     def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Function:
         # Convert return type
-        ret_type = self._convert_type(self.return_type)
+        ret_type = self._convert_type(self.return_type, module)
         
         # Convert parameter types
-        param_types = [self._convert_type(param.type_spec) for param in self.parameters]
+        param_types = [self._convert_type(param.type_spec, module) for param in self.parameters]
         
         # Create function type
         func_type = ir.FunctionType(ret_type, param_types)
         
-        # Create function
-        func = ir.Function(module, func_type, self.name)
+        # Create function, under its namespace's mangled name
+        name = symbols(module).define(self.name)
+        declared = module.globals.get(name)
+        if isinstance(declared, ir.Function) and declared.is_declaration and declared.function_type == func_type:
+            # Declared already, by another import or ahead of this body: the same function
+            if self.is_prototype == True:
+                return declared
+            func = declared
+        else:
+            func = ir.Function(module, func_type, name)
+        apply_function_attributes(func, self, module)
 
         if self.is_prototype == True:
             return func
@@ -800,16 +4141,20 @@ class FunctionDef(ASTNode):
         # Create entry block
         entry_block = func.append_basic_block('entry')
         builder.position_at_start(entry_block)
+        namespace = symbols(module).current.path
+        begin_function(builder, module, func, self, f"{namespace}::{self.name}" if namespace else self.name)
         
         # Create new scope for function body
         old_scope = builder.scope
-        builder.scope = {}
+        builder.scope = Scope()
         
         # Allocate space for parameters and store initial values
         for i, param in enumerate(func.args):
             alloca = builder.alloca(param.type, name=f"{param.name}.addr")
             builder.store(param, alloca)
             builder.scope[self.parameters[i].name] = alloca
+            mark_unsigned(module, alloca, self.parameters[i].type_spec)
+        profile_entry(builder, module)
         
         # Generate function body
         self.body.codegen(builder, module)
@@ -820,12 +4165,28 @@ class FunctionDef(ASTNode):
                 builder.ret_void()
             else:
                 raise RuntimeError("Function must end with return statement")
+        if self.is_const:
+            apply_const_attributes(func, self)
+        finish_profile(module, func, self)
+        end_function(builder, module, func)
         
         # Restore previous scope
         builder.scope = old_scope
         return func
     
-    def _convert_type(self, type_spec: TypeSpec) -> ir.Type:
+    def _convert_type(self, type_spec: TypeSpec, module: ir.Module) -> ir.Type:
+        if type_spec.is_pointer:
+            return pointer_to(self._convert_type(replace(type_spec, is_pointer=False), module))
+        if type_spec.vector_lanes:
+            lane = self._convert_type(replace(type_spec, vector_lanes=None), module)
+            return vector_type(lane, type_spec.vector_lanes)
+        if isinstance(type_spec.base_type, str):
+            struct_type = named_struct(module, type_spec.base_type)
+            if struct_type is not None:
+                return struct_type
+            if hasattr(module, '_type_aliases') and type_spec.base_type in module._type_aliases:
+                return module._type_aliases[type_spec.base_type]
+            raise ValueError(f"Unknown type: {type_spec.base_type}")
         if type_spec.base_type == DataType.INT:
             return ir.IntType(32)
         elif type_spec.base_type == DataType.FLOAT:
@@ -838,6 +4199,8 @@ class FunctionDef(ASTNode):
             return ir.VoidType()
         elif type_spec.base_type == DataType.DATA:
             return ir.IntType(type_spec.bit_width or 8)
+        elif type_spec.base_type in INTEGER_WIDTHS:
+            return ir.IntType(INTEGER_WIDTHS[type_spec.base_type])
         else:
             raise ValueError(f"Unsupported type: {type_spec.base_type}")
 
@@ -880,10 +4243,7 @@ class UnionDef(ASTNode):
             member_names.append(member.name)
             
             # Calculate size
-            if hasattr(member_type, 'width'):  # For integer types
-                size = (member_type.width + 7) // 8  # Convert bits to bytes
-            else:
-                size = module.data_layout.get_type_size(member_type)
+            size = target_layout(module).alloc_size(member_type)
                 
             if size > max_size:
                 max_size = size
@@ -924,33 +4284,35 @@ class StructDef(ASTNode):
     members: List[StructMember] = field(default_factory=list)
     base_structs: List[str] = field(default_factory=list)  # inheritance
     nested_structs: List['StructDef'] = field(default_factory=list)
+    attributes: dict = field(default_factory=dict)  # align(bits), reorder; see define_struct
 
     def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Type:
-        # Convert member types
-        member_types = []
-        member_names = []
-        for member in self.members:
-            member_type = self._convert_type(member.type_spec, module)
-            member_types.append(member_type)
-            member_names.append(member.name)
-        
-        # Create the struct type
-        struct_type = ir.LiteralStructType(member_types)
-        struct_type.names = member_names
-        
-        # Store the type in the module's context
         if not hasattr(module, '_struct_types'):
             module._struct_types = {}
-        module._struct_types[self.name] = struct_type
+        name = symbols(module).define(self.name)
+        if not self.members:
+            # Forward declaration
+            struct_type = module.context.get_identified_type(name)
+            module._struct_types.setdefault(name, struct_type)
+            return struct_type
+
+        members = [(member.name, self._convert_type(member.type_spec, module), type_layout(member.type_spec, module))
+                   for member in self.members]
+        align = self.attributes.get('align')
+        if align is not None and (align % 8 or align & (align - 1)):
+            raise ValueError(f"Struct alignment must be a power of two number of bytes, not {align} bits")
+        struct_type = define_struct(module, name, members,
+                                    align=align // 8 if align else None, reorder='reorder' in self.attributes)
+        module._struct_types[name] = struct_type
         
         # Create global variables for initialized members
-        for member in self.members:
+        for member, (_, member_type, _) in zip(self.members, members):
             if member.initial_value is not None:  # Check for initial_value here
                 # Create global variable for initialized members
                 gvar = ir.GlobalVariable(
                     module, 
                     member_type, 
-                    f"{self.name}.{member.name}"
+                    f"{name}.{member.name}"
                 )
                 gvar.initializer = member.initial_value.codegen(builder, module)
                 gvar.linkage = 'internal'
@@ -958,10 +4320,20 @@ class StructDef(ASTNode):
         return struct_type
     
     def _convert_type(self, type_spec: TypeSpec, module: ir.Module) -> ir.Type:
+        if type_spec.is_array and type_spec.array_size:
+            # uint8[16] buffer; is the array itself, stored in the struct
+            element = self._convert_type(replace(type_spec, is_array=False, array_size=None), module)
+            return ir.ArrayType(element, type_spec.array_size)
+        if type_spec.is_pointer:
+            return pointer_to(self._convert_type(replace(type_spec, is_pointer=False), module))
+        if type_spec.vector_lanes:
+            lane = self._convert_type(replace(type_spec, vector_lanes=None), module)
+            return vector_type(lane, type_spec.vector_lanes)
         if isinstance(type_spec.base_type, str):
             # Check if it's a struct type
-            if hasattr(module, '_struct_types') and type_spec.base_type in module._struct_types:
-                return module._struct_types[type_spec.base_type]
+            struct_type = named_struct(module, type_spec.base_type)
+            if struct_type is not None:
+                return struct_type
             # Check if it's a type alias
             if hasattr(module, '_type_aliases') and type_spec.base_type in module._type_aliases:
                 return module._type_aliases[type_spec.base_type]
@@ -981,6 +4353,8 @@ class StructDef(ASTNode):
             return ir.VoidType()
         elif type_spec.base_type == DataType.DATA:
             return ir.IntType(type_spec.bit_width)
+        elif type_spec.base_type in INTEGER_WIDTHS:
+            return ir.IntType(INTEGER_WIDTHS[type_spec.base_type])
         else:
             raise ValueError(f"Unsupported type: {type_spec.base_type}")
 
@@ -1011,27 +4385,25 @@ class ObjectDef(ASTNode):
 
     def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> ir.Type:
         # First create a struct type for the object's data members
-        member_types = []
-        member_names = []
-        
-        for member in self.members:
-            member_type = self._convert_type(member.type_spec, module)
-            member_types.append(member_type)
-            member_names.append(member.name)
-        
-        # Create the struct type for data members
-        struct_type = ir.LiteralStructType(member_types)
-        struct_type.names = member_names
+        members = [(member.name, self._convert_type(member.type_spec, module), type_layout(member.type_spec, module))
+                   for member in self.members]
+        name = symbols(module).define(self.name)
+        struct_type = define_struct(module, name, members)
         
         # Store the struct type in the module
         if not hasattr(module, '_struct_types'):
             module._struct_types = {}
-        module._struct_types[self.name] = struct_type
+        module._struct_types[name] = struct_type
         
         # Create methods as functions with 'this' parameter
+        namespace = symbols(module).current.path
+        display_name = f"{namespace}::{self.name}" if namespace else self.name
         for method in self.methods:
-            # Convert return type
-            ret_type = self._convert_type(method.return_type, module)
+            # Convert return type; -> this returns the object's address
+            if method.return_type.base_type == DataType.THIS:
+                ret_type = ir.PointerType(struct_type)
+            else:
+                ret_type = self._convert_type(method.return_type, module)
             
             # Create parameter types - first parameter is always 'this' pointer
             param_types = [ir.PointerType(struct_type)]
@@ -1043,8 +4415,10 @@ class ObjectDef(ASTNode):
             func_type = ir.FunctionType(ret_type, param_types)
             
             # Create function with mangled name
-            func_name = f"{self.name}__{method.name}"
+            func_name = f"{name}__{method.name}"
             func = ir.Function(module, func_type, func_name)
+            if isinstance(method, FunctionDef):
+                apply_function_attributes(func, method, module, this_type=struct_type)
             
             # Set parameter names
             func.args[0].name = "this"  # First arg is 'this' pointer
@@ -1058,9 +4432,10 @@ class ObjectDef(ASTNode):
             # Create entry block
             entry_block = func.append_basic_block('entry')
             method_builder = ir.IRBuilder(entry_block)
+            begin_function(method_builder, module, func, method, f"{display_name}::{method.name}")
             
             # Create scope for method
-            method_builder.scope = {}
+            method_builder.scope = Scope()
             
             # Store parameters in scope
             for i, param in enumerate(func.args):
@@ -1070,6 +4445,7 @@ class ObjectDef(ASTNode):
                     method_builder.scope["this"] = alloca
                 else:
                     method_builder.scope[method.parameters[i-1].name] = alloca
+            profile_entry(method_builder, module)
             
             # Generate method body
             if isinstance(method, FunctionDef):
@@ -1081,8 +4457,14 @@ class ObjectDef(ASTNode):
             if not method_builder.block.is_terminated:
                 if isinstance(ret_type, ir.VoidType):
                     method_builder.ret_void()
+                elif method.return_type.base_type == DataType.THIS:
+                    method_builder.ret(func.args[0])
                 else:
                     raise RuntimeError(f"Method {method.name} must end with return statement")
+            if getattr(method, 'is_const', False):
+                apply_const_attributes(func, method)
+            finish_profile(module, func, method)
+            end_function(method_builder, module, func)
         
         # Handle nested objects and structs
         for nested_obj in self.nested_objects:
@@ -1094,10 +4476,20 @@ class ObjectDef(ASTNode):
         return struct_type
 
     def _convert_type(self, type_spec: TypeSpec, module: ir.Module) -> ir.Type:
+        if type_spec.is_array and type_spec.array_size:
+            # uint8[64] local; is the array itself, stored in the object
+            element = self._convert_type(replace(type_spec, is_array=False, array_size=None), module)
+            return ir.ArrayType(element, type_spec.array_size)
+        if type_spec.is_pointer:
+            return pointer_to(self._convert_type(replace(type_spec, is_pointer=False), module))
+        if type_spec.vector_lanes:
+            lane = self._convert_type(replace(type_spec, vector_lanes=None), module)
+            return vector_type(lane, type_spec.vector_lanes)
         if isinstance(type_spec.base_type, str):
             # Check if it's a struct type
-            if hasattr(module, '_struct_types') and type_spec.base_type in module._struct_types:
-                return module._struct_types[type_spec.base_type]
+            struct_type = named_struct(module, type_spec.base_type)
+            if struct_type is not None:
+                return struct_type
             # Check if it's a type alias
             if hasattr(module, '_type_aliases') and type_spec.base_type in module._type_aliases:
                 return module._type_aliases[type_spec.base_type]
@@ -1117,6 +4509,8 @@ class ObjectDef(ASTNode):
             return ir.VoidType()
         elif type_spec.base_type == DataType.DATA:
             return ir.IntType(type_spec.bit_width)
+        elif type_spec.base_type in INTEGER_WIDTHS:
+            return ir.IntType(INTEGER_WIDTHS[type_spec.base_type])
         else:
             raise ValueError(f"Unsupported type: {type_spec.base_type}")
 
@@ -1133,54 +4527,26 @@ class NamespaceDef(ASTNode):
 
     def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> None:
         """
-        Generate LLVM IR for a namespace definition.
-        
-        Namespaces in Flux are primarily a compile-time construct that affects name mangling.
-        At the LLVM level, we'll mangle names with the namespace prefix.
+        Namespaces are a compile-time construct: members are emitted under
+        mangled names (outer__inner__name), which the symbol table works out
+        when they are defined. Nothing here rewrites the members themselves.
         """
-        # Save the current module state
-        old_module = module
-        
-        # Create a new module for the namespace if we want isolation
-        # Alternatively, we can just mangle names in the existing module
-        # For now, we'll use name mangling in the existing module
-        
-        # Process all namespace members with name mangling
-        for struct in self.structs:
-            # Mangle the struct name with namespace
-            original_name = struct.name
-            struct.name = f"{self.name}__{struct.name}"
-            struct.codegen(builder, module)
-            struct.name = original_name  # Restore original name
-        
-        for obj in self.objects:
-            # Mangle the object name with namespace
-            original_name = obj.name
-            obj.name = f"{self.name}__{obj.name}"
-            obj.codegen(builder, module)
-            obj.name = original_name
-        
-        for func in self.functions:
-            # Mangle the function name with namespace
-            original_name = func.name
-            func.name = f"{self.name}__{func.name}"
-            func.codegen(builder, module)
-            func.name = original_name
-        
-        for var in self.variables:
-            # Mangle the variable name with namespace
-            original_name = var.name
-            var.name = f"{self.name}__{var.name}"
-            var.codegen(builder, module)
-            var.name = original_name
-        
-        # Process nested namespaces
-        for nested_ns in self.nested_namespaces:
-            # Mangle the nested namespace name
-            original_name = nested_ns.name
-            nested_ns.name = f"{self.name}__{nested_ns.name}"
-            nested_ns.codegen(builder, module)
-            nested_ns.name = original_name
+        table = symbols(module)
+        table.enter(self.name)
+        try:
+            for struct in self.structs:
+                struct.codegen(builder, module)
+            for obj in self.objects:
+                obj.codegen(builder, module)
+            # Globals first, so the namespace's functions can use them
+            for var in self.variables:
+                var.codegen(builder, module)
+            for func in self.functions:
+                func.codegen(builder, module)
+            for nested_ns in self.nested_namespaces:
+                nested_ns.codegen(builder, module)
+        finally:
+            table.leave()
         
         # Handle inheritance here
         
@@ -1193,15 +4559,13 @@ class UsingStatement(Statement):
     
     def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> None:
         """Using statements are compile-time directives - no runtime code generated"""
-        # For now, just store the namespace information for symbol resolution
-        if not hasattr(module, '_using_namespaces'):
-            module._using_namespaces = []
-        module._using_namespaces.append(self.namespace_path)
+        symbols(module).using(self.namespace_path.split('::'))
 
 @dataclass
 class ImportStatement(Statement):
     module_name: str
     _processed_imports: ClassVar[dict] = {}
+    _import_cache: ClassVar[Optional[Any]] = None  # fcache.ImportCache, set by the driver
 
     def codegen(self, builder: ir.IRBuilder, module: ir.Module) -> None:
         """
@@ -1223,29 +4587,29 @@ class ImportStatement(Statement):
             with open(resolved_path, 'r', encoding='utf-8') as f:
                 source = f.read()
 
-            # Create fresh parser/lexer instances
-            from flexer import FluxLexer
-            tokens = FluxLexer(source).tokenize()
-            
-            # Get parser class without circular import
-            parser_class = self._get_parser_class()
-            imported_ast = parser_class(tokens).parse()
+            debug = getattr(module, '_debug', None)
+            if debug is not None:
+                importer_file, debug.file = debug.file, debug.file_for(resolved_path)
+            with freport.phase(f"import {self.module_name}"):
+                imported_ast = self._parse_module(resolved_path, source)
 
-            # Create a new builder for the imported file
-            import_builder = ir.IRBuilder()
-            import_builder.scope = builder.scope  # Share the same scope
-            
-            # Generate code for each statement
-            for stmt in imported_ast.statements:
-                if isinstance(stmt, ImportStatement):
-                    stmt.codegen(import_builder, module)
-                else:
-                    try:
+                # Create a new builder for the imported file
+                import_builder = ir.IRBuilder()
+                import_builder.scope = builder.scope  # Share the same scope
+                
+                # Generate code for each statement
+                for stmt in imported_ast.statements:
+                    if isinstance(stmt, ImportStatement):
                         stmt.codegen(import_builder, module)
-                    except Exception as e:
-                        raise RuntimeError(
-                            f"Failed to generate code for {resolved_path}: {str(e)}"
-                        ) from e
+                    else:
+                        try:
+                            stmt.codegen(import_builder, module)
+                        except Exception as e:
+                            raise RuntimeError(
+                                f"Failed to generate code for {resolved_path}: {str(e)}"
+                            ) from e
+            if debug is not None:
+                debug.file = importer_file
 
             # Store the processed module
             self._processed_imports[str(resolved_path)] = module
@@ -1256,6 +4620,43 @@ class ImportStatement(Statement):
                 del self._processed_imports[str(resolved_path)]
             raise
 
+    def _parse_module(self, resolved_path: Path, source: str) -> 'Program':
+        """Lex and parse an imported file, going through the import cache when enabled"""
+        cache = self._import_cache
+        if cache is not None:
+            cached = cache.load(resolved_path, source)
+            if cached is not None:
+                self._count_nodes(cached)
+                return cached
+
+        # Create fresh parser/lexer instances
+        from flexer import FluxLexer
+        lexer = FluxLexer(source)
+        if freport.active_report() is not None:
+            with freport.phase("lex"):
+                tokens = lexer.tokenize()
+            freport.count("tokens", len(tokens))
+        else:
+            tokens = lexer.iter_tokens()
+        
+        # Get parser class without circular import
+        parser_class = self._get_parser_class()
+        with freport.phase("parse"):
+            parser = parser_class(tokens)
+            imported_ast = parser.parse()
+        self._count_nodes(imported_ast)
+
+        # Never cache a partial parse, the errors must show up again next build
+        if cache is not None and not parser.errors:
+            cache.store(resolved_path, source, imported_ast)
+        return imported_ast
+
+    @staticmethod
+    def _count_nodes(program: 'Program') -> None:
+        report = freport.active_report()
+        if report is not None:
+            report.count_ast(program)
+
     def _get_parser_class(self):
         """Dynamically imports the parser class to avoid circular imports"""
         import fparser
@@ -1273,6 +4674,7 @@ class ImportStatement(Statement):
                 Path.cwd(),
                 Path.cwd() / "lib",
                 Path(__file__).parent.parent / "lib",
+                Path(__file__).parent.parent / "stdlib",
                 Path.home() / ".flux" / "lib",
                 Path("/usr/local/lib/flux"),
                 Path("/usr/lib/flux")
@@ -1333,7 +4735,7 @@ class Program(ASTNode):
 
     def codegen(self, module: ir.Module = None) -> ir.Module:
         if module is None:
-            module = ir.Module(name='flux_module')
+            module = ir.Module(name='flux_module', context=ir.Context())
         
         # Create global builder with no function context
         builder = ir.IRBuilder()
@@ -1347,6 +4749,9 @@ class Program(ASTNode):
                 print(f"Error generating code for statement: {stmt}")
                 raise
         
+        assign_calling_conventions(module)
+        emit_profile_writer(module)
+        infer_nounwind(module)
         return module
 
 # Example usage
@@ -0,0 +1,111 @@
+"""
+Flux Compiler Backend
+
+In-process code generation through llvmlite's binding layer.
+Takes the textual module produced by codegen, parses and verifies it
+once in memory, runs the mid-level optimization pipeline for the -O
+level, and emits native objects or assembly without spawning llc or as.
+"""
+
+from llvmlite import ir
+from llvmlite import binding as llvm
+
+_llvm_initialized = False
+
+# LLVM's own inliner thresholds for -O2 and -O3
+INLINE_THRESHOLDS = {2: 225, 3: 250}
+
+def initialize_llvm() -> None:
+    """Initialize LLVM targets once per process"""
+    global _llvm_initialized
+    if _llvm_initialized:
+        return
+    llvm.initialize()
+    llvm.initialize_all_targets()
+    llvm.initialize_all_asmprinters()
+    _llvm_initialized = True
+
+class FluxBackend:
+    def __init__(self, triple: str, opt_level: int = 2, jit: bool = False):
+        if opt_level not in (0, 1, 2, 3):
+            raise ValueError(f"Invalid optimization level: {opt_level}")
+        initialize_llvm()
+        self.triple = triple
+        self.opt_level = opt_level
+        target = llvm.Target.from_triple(triple)
+        if jit:
+            # Code runs here and now: use everything this CPU has, and a code
+            # model that reaches libc wherever the JIT's memory lands
+            llvm.initialize_native_target()
+            llvm.initialize_native_asmprinter()
+            self.target_machine = target.create_target_machine(
+                cpu=llvm.get_host_cpu_name(),
+                features=llvm.get_host_cpu_features().flatten(),
+                opt=opt_level,
+                codemodel='jitdefault',
+                jit=True
+            )
+            return
+        # Static relocation model matches the `gcc -no-pie` link step
+        self.target_machine = target.create_target_machine(
+            opt=opt_level,
+            reloc='static',
+            codemodel='default'
+        )
+
+    @property
+    def data_layout(self) -> str:
+        return str(self.target_machine.target_data)
+
+    def parse(self, module: ir.Module) -> llvm.ModuleRef:
+        """Parse and verify an llvmlite IR module in memory"""
+        llvm_module = llvm.parse_assembly(str(module))
+        llvm_module.triple = self.triple
+        llvm_module.data_layout = self.data_layout
+        llvm_module.verify()
+        return llvm_module
+
+    def optimize(self, llvm_module: llvm.ModuleRef) -> llvm.ModuleRef:
+        """
+        Run the mid-level pipeline in place. llc only runs codegen passes,
+        so without this our allocas, loads and stores reach the backend
+        as written.
+
+            -O0  nothing
+            -O1  SROA/mem2reg, early CSE, instcombine, simplifycfg, LICM
+            -O2  adds GVN, the inliner and loop/SLP vectorization
+            -O3  adds argument promotion and more aggressive inlining
+        """
+        if self.opt_level == 0:
+            return llvm_module
+
+        pmb = llvm.create_pass_manager_builder()
+        pmb.opt_level = self.opt_level
+        if self.opt_level in INLINE_THRESHOLDS:
+            pmb.inlining_threshold = INLINE_THRESHOLDS[self.opt_level]
+        pmb.loop_vectorize = self.opt_level >= 2
+        pmb.slp_vectorize = self.opt_level >= 2
+
+        fpm = llvm.create_function_pass_manager(llvm_module)
+        mpm = llvm.create_module_pass_manager()
+        # Target cost models for the vectorizers and instcombine
+        self.target_machine.add_analysis_passes(fpm)
+        self.target_machine.add_analysis_passes(mpm)
+        pmb.populate(fpm)
+        pmb.populate(mpm)
+
+        fpm.initialize()
+        for func in llvm_module.functions:
+            if not func.is_declaration:
+                fpm.run(func)
+        fpm.finalize()
+        mpm.run(llvm_module)
+        return llvm_module
+
+    def emit_object(self, llvm_module: llvm.ModuleRef) -> bytes:
+        """Emit a native object file image"""
+        return self.target_machine.emit_object(llvm_module)
+
+    def emit_assembly(self, llvm_module: llvm.ModuleRef) -> str:
+        """Emit native assembly text"""
+        return self.target_machine.emit_assembly(llvm_module)
@@ -0,0 +1,329 @@
+"""
+Flux Incremental Builder
+
+Separate compilation of a program and its imports. Every module in the
+import graph is lowered to its own object file under flux_build_<name>/,
+next to an interface (.fxi) holding the prototypes and type definitions
+that importing modules compile against. A manifest records what each
+object was built from, so a rebuild only recompiles modules whose source
+changed or whose dependencies' interfaces changed.
+"""
+
+import json
+import pickle
+import hashlib
+from dataclasses import dataclass, field, replace
+from pathlib import Path
+from typing import Any, Dict, List, Optional
+
+from llvmlite import ir
+from fast import *
+from fcache import compiler_version
+
+MANIFEST_NAME = "build.manifest"
+
+def artifact_stem(path: Path) -> str:
+    """Base name for a module's build artifacts; same-named modules in different directories must not collide"""
+    return f"{path.stem}-{hashlib.sha256(str(path).encode('utf-8')).hexdigest()[:8]}"
+
+# ============ INTERFACES ============
+
+def _prototype(func: FunctionDef) -> FunctionDef:
+    return replace(func, body=Block([]), is_prototype=True)
+
+def _object_interface(obj: ObjectDef) -> ObjectDef:
+    return replace(obj,
+                   methods=[_prototype(m) for m in obj.methods],
+                   nested_objects=[_object_interface(o) for o in obj.nested_objects])
+
+def _variable_interface(var: Any) -> Any:
+    if isinstance(var, VariableDeclaration):
+        # Const values stay visible so importers fold them like their own
+        initial_value = var.initial_value if var.type_spec.is_const else None
+        return replace(var, initial_value=initial_value, is_extern=True)
+    return var  # TypeDeclaration
+
+def _namespace_interface(ns: NamespaceDef) -> NamespaceDef:
+    return replace(ns,
+                   functions=[_prototype(f) for f in ns.functions],
+                   objects=[_object_interface(o) for o in ns.objects],
+                   variables=[_variable_interface(v) for v in ns.variables],
+                   nested_namespaces=[_namespace_interface(n) for n in ns.nested_namespaces])
+
+def make_interface(program: Program) -> List[Statement]:
+    """
+    Reduce a module to what other modules need to compile against it:
+    function and method prototypes, extern global declarations (keeping
+    the values of const ones), and the struct/union/type definitions
+    unchanged. compt blocks run only in the module that contains them.
+    """
+    interface = []
+    for stmt in program.statements:
+        if isinstance(stmt, FunctionDef):
+            interface.append(_prototype(stmt))
+        elif isinstance(stmt, ObjectDef):
+            interface.append(_object_interface(stmt))
+        elif isinstance(stmt, NamespaceDef):
+            interface.append(_namespace_interface(stmt))
+        elif isinstance(stmt, (StructDef, UnionDef, TypeDeclaration, UsingStatement)):
+            interface.append(stmt)
+        elif isinstance(stmt, ExpressionStatement):
+            if isinstance(stmt.expression, VariableDeclaration):
+                interface.append(ExpressionStatement(_variable_interface(stmt.expression)))
+            elif isinstance(stmt.expression, TypeDeclaration):
+                interface.append(stmt)
+    return interface
+
+# ============ BUILD GRAPH ============
+
+@dataclass
+class ModuleUnit:
+    path: Path
+    source: str
+    source_hash: str
+    dependencies: List[str]                # Resolved paths of direct imports
+    interface_hash: str
+    interface: List[Statement] = field(default_factory=list)
+    program: Optional[Program] = None      # Parsed lazily when the manifest is stale
+
+    @property
+    def key(self) -> str:
+        return str(self.path)
+
+    def artifact_stem(self) -> str:
+        return artifact_stem(self.path)
+
+    def parse(self) -> Program:
+        if self.program is None:
+            self.program = ImportStatement(self.key)._parse_module(self.path, self.source)
+        return self.program
+
+# ============ WORKER JOBS ============
+# Module-level so a process pool can run them for -j N builds
+
+def _count_cache(cache, job, *args):
+    """Run job with cache as the import cache, returning its result and the hit/miss delta"""
+    ImportStatement._import_cache = cache
+    if cache is None:
+        return job(*args), (0, 0)
+    hits, misses = cache.hits, cache.misses
+    result = job(*args)
+    return result, (cache.hits - hits, cache.misses - misses)
+
+def load_unit(path: Path, manifest_entry: Optional[dict], build_dir: Path) -> ModuleUnit:
+    source = path.read_text(encoding='utf-8')
+    source_hash = hashlib.sha256(source.encode('utf-8')).hexdigest()
+
+    # Unchanged source: reuse the recorded imports and interface without parsing
+    interface_file = build_dir / f"{artifact_stem(path)}.fxi"
+    if manifest_entry and manifest_entry.get('source_hash') == source_hash and interface_file.exists():
+        data = interface_file.read_bytes()
+        return ModuleUnit(path, source, source_hash, manifest_entry['dependencies'],
+                          hashlib.sha256(data).hexdigest(), pickle.loads(data))
+
+    unit = ModuleUnit(path, source, source_hash, [], "")
+    program = unit.parse()
+    for stmt in program.statements:
+        if isinstance(stmt, ImportStatement):
+            resolved = stmt._resolve_path(stmt.module_name)
+            if not resolved:
+                raise ImportError(f"Module not found: {stmt.module_name} (imported by {path})")
+            unit.dependencies.append(str(resolved))
+    unit.interface = make_interface(program)
+    data = pickle.dumps(unit.interface, protocol=pickle.HIGHEST_PROTOCOL)
+    interface_file.write_bytes(data)
+    unit.interface_hash = hashlib.sha256(data).hexdigest()
+    return unit
+
+def lower_unit(unit: ModuleUnit, interfaces: List[List[Statement]], triple: str,
+               instrument: bool = False, profile=None, options: CodegenOptions = None,
+               optimized: bool = False) -> ir.Module:
+    """Generate IR for one module against its dependencies' interfaces, counted or weighted for PGO"""
+    from fbackend import FluxBackend
+    module = ir.Module(name=unit.path.stem, context=ir.Context())
+    module.triple = triple
+    module.data_layout = FluxBackend(triple, 0).data_layout
+    module._export_globals = True
+    module._profile_instrument = instrument
+    module._profile = profile
+    apply_codegen_options(module, options or CodegenOptions(), unit.path, optimized)
+
+    builder = ir.IRBuilder()
+    builder.scope = None  # Indicates global scope
+
+    for interface in interfaces:
+        for stmt in interface:
+            stmt.codegen(builder, module)
+
+    for stmt in unit.parse().statements:
+        if isinstance(stmt, ImportStatement):
+            continue  # Satisfied by the interfaces above
+        try:
+            stmt.codegen(builder, module)
+        except Exception as e:
+            raise RuntimeError(f"Failed to generate code for {unit.path}: {str(e)}") from e
+    emit_profile_writer(module)
+    infer_nounwind(module)
+    return module
+
+def compile_unit(unit: ModuleUnit, interfaces: List[List[Statement]], triple: str, opt_level: int,
+                 obj_file: Path, keep_ir: bool, options: CodegenOptions = None) -> Optional[str]:
+    """Lower one module and write its object; returns the IR text when keep_ir is set"""
+    from fbackend import FluxBackend
+    module = lower_unit(unit, interfaces, triple, options=options, optimized=opt_level > 0)
+
+    llvm_ir = None
+    if keep_ir:
+        llvm_ir = str(module)
+        with open(obj_file.with_suffix('.ll'), 'w') as f:
+            f.write(llvm_ir)
+
+    backend = FluxBackend(triple, opt_level)
+    llvm_module = backend.optimize(backend.parse(module))
+    with open(obj_file, 'wb') as f:
+        f.write(backend.emit_object(llvm_module))
+    return llvm_ir
+
+class IncrementalBuilder:
+    def __init__(self, build_dir: Path, triple: str, opt_level: int = 2, verbosity: int = None,
+                 jobs: int = 1, import_cache: Any = None, options: CodegenOptions = None):
+        self.build_dir = Path(build_dir)
+        self.triple = triple
+        self.opt_level = opt_level
+        self.options = options or CodegenOptions()
+        self.verbosity = verbosity
+        self.jobs = max(1, jobs)
+        self.import_cache = import_cache if import_cache is not None else ImportStatement._import_cache
+        self.manifest = self._load_manifest()
+        self.compiled = []
+        self.reused = []
+        self._pool = None
+
+    def _load_manifest(self) -> Dict[str, dict]:
+        try:
+            with open(self.build_dir / MANIFEST_NAME, 'r') as f:
+                manifest = json.load(f)
+        except (OSError, ValueError):
+            return {}
+        if manifest.get('compiler') != compiler_version():
+            return {}
+        return manifest.get('modules', {})
+
+    def _save_manifest(self, modules: Dict[str, dict]) -> None:
+        with open(self.build_dir / MANIFEST_NAME, 'w') as f:
+            json.dump({'compiler': compiler_version(), 'modules': modules}, f, indent=2, sort_keys=True)
+
+    def _map(self, job, arg_lists: List[tuple]) -> list:
+        """Run job over arg_lists, in worker processes when -j allows; results keep input order"""
+        if self.jobs == 1 or len(arg_lists) < 2:
+            return [_count_cache(self.import_cache, job, *args)[0] for args in arg_lists]
+
+        if self._pool is None:
+            from concurrent.futures import ProcessPoolExecutor
+            self._pool = ProcessPoolExecutor(max_workers=self.jobs)
+        futures = [self._pool.submit(_count_cache, self.import_cache, job, *args) for args in arg_lists]
+        results = []
+        for future in futures:
+            result, (hits, misses) = future.result()
+            # Workers count into their own copy of the cache
+            if self.import_cache is not None:
+                self.import_cache.hits += hits
+                self.import_cache.misses += misses
+            results.append(result)
+        return results
+
+    def _discover(self, entry: Path) -> Dict[str, ModuleUnit]:
+        """Load the import graph breadth-first, one wave of independent modules at a time"""
+        units = {}
+        frontier = [str(entry)]
+        while frontier:
+            loaded = self._map(load_unit, [(Path(key), self.manifest.get(key), self.build_dir) for key in frontier])
+            queued = set()
+            next_frontier = []
+            for unit in loaded:
+                units[unit.key] = unit
+            for unit in loaded:
+                for dep in unit.dependencies:
+                    if dep not in units and dep not in queued:
+                        queued.add(dep)
+                        next_frontier.append(dep)
+            frontier = next_frontier
+        return units
+
+    def _link_order(self, key: str, units: Dict[str, ModuleUnit], order: List[str], visited: set) -> None:
+        """Depth-first post-order from the entry, independent of how the graph was loaded"""
+        if key in visited:
+            return  # Circular import, or already placed
+        visited.add(key)
+        for dep in units[key].dependencies:
+            self._link_order(dep, units, order, visited)
+        order.append(key)
+
+    def _transitive_dependencies(self, key: str, units: Dict[str, ModuleUnit]) -> List[ModuleUnit]:
+        """All modules reachable from key, dependencies first, excluding key itself"""
+        seen = {key}
+        result = []
+        def visit(k: str) -> None:
+            for dep in units[k].dependencies:
+                if dep not in seen:
+                    seen.add(dep)
+                    visit(dep)
+                    result.append(units[dep])
+        visit(key)
+        return result
+
+    def _build_key(self, unit: ModuleUnit, deps: List[ModuleUnit]) -> str:
+        parts = [unit.source_hash, compiler_version(), str(self.opt_level), self.triple, repr(self.options)]
+        parts.extend(f"{dep.key}={dep.interface_hash}" for dep in deps)
+        return hashlib.sha256("\0".join(parts).encode('utf-8')).hexdigest()
+
+    def build(self, entry: Path) -> List[Path]:
+        """Bring every object in the import graph of entry up to date; returns them in link order"""
+        self.build_dir.mkdir(exist_ok=True)
+        try:
+            entry_key = str(Path(entry).resolve())
+            units = self._discover(Path(entry_key))
+            order = []
+            self._link_order(entry_key, units, order, set())
+
+            # Every module compiles against interfaces only, so all stale modules are independent
+            modules = {}
+            objects = []
+            stale = []
+            for key in order:
+                unit = units[key]
+                deps = self._transitive_dependencies(key, units)
+                build_key = self._build_key(unit, deps)
+                obj_file = self.build_dir / f"{unit.artifact_stem()}.o"
+
+                entry_info = self.manifest.get(key)
+                if entry_info and entry_info.get('build_key') == build_key and obj_file.exists():
+                    self.reused.append(key)
+                else:
+                    interfaces = [dep.interface for dep in deps]
+                    stale.append((unit, interfaces, self.triple, self.opt_level, obj_file,
+                                  self.verbosity in (2, 4), self.options))
+                    self.compiled.append(key)
+
+                modules[key] = {
+                    'source_hash': unit.source_hash,
+                    'dependencies': unit.dependencies,
+                    'interface_hash': unit.interface_hash,
+                    'build_key': build_key,
+                    'object': obj_file.name,
+                }
+                objects.append(obj_file)
+
+            for llvm_ir in self._map(compile_unit, stale):
+                if llvm_ir is not None:
+                    print(llvm_ir)
+
+            self._save_manifest(modules)
+            return objects
+        finally:
+            if self._pool is not None:
+                self._pool.shutdown()
+                self._pool = None
+
+    def report(self) -> str:
+        return f"Incremental build: {len(self.compiled)} compiled, {len(self.reused)} up to date"
@@ -4,17 +4,42 @@ Flux Compiler with Full Toolchain Integration
 
 import sys
 import os
+import time
 import subprocess
 from pathlib import Path
 from llvmlite import ir
 from flexer import FluxLexer
 from fparser import FluxParser, ParseError
 from fast import *
+from fcache import ImportCache
+from fprofile import read_profile, merge_profiles
+import freport
 
 class FluxCompiler:
-    def __init__(self, /, verbosity: int = None):
+    def __init__(self, /, verbosity: int = None, opt_level: int = 2, use_llc: bool = False,
+                 use_cache: bool = True, cache_stats: bool = False, incremental: bool = False,
+                 jobs: int = 1, time_report: str = None, trace_memory: bool = False, lto: bool = False,
+                 pgo_generate: bool = False, pgo_use: str = None, debug_info: bool = False,
+                 frame_pointers: bool = False, instrument_functions: bool = False):
         self.verbosity = int(verbosity) if verbosity != None else None
-        self.module = ir.Module(name="flux_module")
+        self.opt_level = opt_level
+        self.use_llc = use_llc
+        self.incremental = incremental
+        self.lto = lto
+        self.pgo_generate = pgo_generate
+        self.profile = read_profile(Path(pgo_use)) if pgo_use else None
+        self.codegen_options = CodegenOptions(debug_info, frame_pointers, instrument_functions)
+        self.jobs = jobs
+        self.cache_stats = cache_stats
+        self.time_report = freport.TimeReport(trace_memory) if time_report else None
+        self.time_report_format = time_report
+        self.import_cache = ImportCache(enabled=use_cache)
+        ImportStatement._import_cache = self.import_cache
+        # One compiler, one module: a process that builds again (--server, --watch) starts afresh
+        ImportStatement._processed_imports = {}
+        self.sources = []  # Every file the last build read, for --watch
+        # Struct types are named per module rather than in llvmlite's process-wide context
+        self.module = ir.Module(name="flux_module", context=ir.Context())
         import platform
         if platform.system() == "Darwin":  # macOS
             # Detect macOS architecture
@@ -29,30 +54,55 @@ class FluxCompiler:
                 self.module.triple = "arm64-apple-macosx11.0.0"  # Default to ARM64
         else:  # Linux and others
             self.module.triple = "x86_64-pc-linux-gnu"
-        #self.module.data_layout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+        # Struct layout and sizeof/alignof are computed against the target's data layout
+        from fbackend import FluxBackend
+        self.module.data_layout = FluxBackend(self.module.triple, self.opt_level).data_layout
+        self.module._profile_instrument = self.pgo_generate
+        self.module._profile = self.profile
         self.temp_files = []
 
     def compile_file(self, filename: str, output_bin: str = None) -> str:
+        if self.time_report:
+            self.time_report.start()
+        if self.incremental:
+            return self.compile_incremental(filename, output_bin)
+        if self.lto:
+            return self.compile_lto(filename, output_bin)
         try:
             # 1. Parse and generate LLVM IR
             with open(filename, 'r') as f:
                 source = f.read()
             
             lexer = FluxLexer(source)
-            tokens = lexer.tokenize()
+            if self.verbosity in (0, 4) or self.time_report:
+                # Materialize the tokens to print them or to time lexing on its own
+                with freport.phase("lex"):
+                    tokens = lexer.tokenize()
+                freport.count("tokens", len(tokens))
+            else:
+                # Otherwise the parser pulls them from the lexer as it goes
+                tokens = lexer.iter_tokens()
 
             if self.verbosity == 0:
                 print(tokens)
             
-            parser = FluxParser(tokens)
-            ast = parser.parse()
+            with freport.phase("parse"):
+                parser = FluxParser(tokens)
+                ast = parser.parse()
+            if self.time_report:
+                self.time_report.count_ast(ast)
 
             if self.verbosity == 1:
                 print(ast)
             
-            print(ast)
-            self.module = ast.codegen(self.module)
-            llvm_ir = str(self.module)
+            apply_codegen_options(self.module, self.codegen_options, Path(filename), self.opt_level > 0)
+            with freport.phase("codegen"):
+                self.module = ast.codegen(self.module)
+            self.sources = [str(Path(filename).resolve())] + list(ImportStatement._processed_imports)
+            with freport.phase("ir print"):
+                llvm_ir = str(self.module)
+            if self.time_report:
+                self.time_report.count_ir(self.module, llvm_ir)
 
             if self.verbosity == 2:
                 print(llvm_ir)
@@ -62,42 +112,12 @@ class FluxCompiler:
             temp_dir = Path(f"flux_build_{base_name}")
             temp_dir.mkdir(exist_ok=True)
             
-            # 2. Generate LLVM IR file
-            ll_file = temp_dir / f"{base_name}.ll"
-            with open(ll_file, 'w') as f:
-                f.write(llvm_ir)
-            self.temp_files.append(ll_file)
-            
-            # 3. Compile directly to object file (skip assembly step on macOS)
             obj_file = temp_dir / f"{base_name}.o"
-            import platform
-            if platform.system() == "Darwin":  # macOS
-                # Compile directly to object file to avoid assembly issues
-                subprocess.run([
-                    "llc",
-                    "-O2",               # Enable optimizations  
-                    "-filetype=obj",     # Output object file directly
-                    str(ll_file),
-                    "-o", str(obj_file)
-                ], check=True)
-            else:  # Linux - use traditional assembly step
-                asm_file = temp_dir / f"{base_name}.s"
-                subprocess.run([
-                    "llc",
-                    "-O2",               # Enable optimizations
-                    str(ll_file),
-                    "-o", str(asm_file)
-                ], check=True)
-                self.temp_files.append(asm_file)
-
-                if self.verbosity == 3:
-                    with open(asm_file, "r") as f:
-                        f.seek(0)
-                        print(f.read())
-                
-                subprocess.run([
-                    "as", "--64", str(asm_file), "-o", str(obj_file)
-                ], check=True)
+            asm_text = None
+            if self.use_llc:
+                asm_text = self._compile_with_toolchain(llvm_ir, temp_dir, base_name, obj_file)
+            else:
+                asm_text = self._compile_in_process(llvm_ir, temp_dir, base_name, obj_file)
             
             self.temp_files.append(obj_file)
 
@@ -105,19 +125,16 @@ class FluxCompiler:
                 print(tokens)
                 print(ast)
                 print(llvm_ir)
-                with open(asm_file, "r") as f:
-                    f.seek(0)
-                    print(f.read())
+                if asm_text is not None:
+                    print(asm_text)
             
             # 5. Link executable
             output_bin = output_bin or f"./{base_name}"
-            link_args = [str(obj_file), "-o", output_bin]
+            self._link([str(obj_file)], output_bin)
             
-            if platform.system() == "Darwin":  # macOS
-                # Use clang for linking on macOS
-                subprocess.run(["clang"] + link_args, check=True)
-            else:  # Linux
-                subprocess.run(["gcc", "-no-pie"] + link_args, check=True)
+            if self.cache_stats:
+                print(self.import_cache.report())
+            self._finish_time_report(base_name)
             
             print(f"Successfully built: {output_bin}")
             return output_bin
@@ -126,6 +143,224 @@ class FluxCompiler:
             self.cleanup()
             print(f"Compilation failed: {e}", file=sys.stderr)
             sys.exit(1)
+
+    def compile_incremental(self, filename: str, output_bin: str = None) -> str:
+        """Build each module of the import graph into its own object, reusing the up-to-date ones"""
+        from fbuild import IncrementalBuilder
+        try:
+            base_name = Path(filename).stem
+            temp_dir = Path(f"flux_build_{base_name}")
+            builder = IncrementalBuilder(temp_dir, self.module.triple, self.opt_level, self.verbosity,
+                                         jobs=self.jobs, import_cache=self.import_cache,
+                                         options=self.codegen_options)
+            with freport.phase("build modules"):
+                objects = builder.build(Path(filename))
+            self.sources = builder.compiled + builder.reused
+            freport.count("modules compiled", len(builder.compiled))
+            freport.count("modules up to date", len(builder.reused))
+            print(builder.report())
+
+            # Objects persist in the build directory between builds, only the link is redone
+            output_bin = output_bin or f"./{base_name}"
+            self._link([str(obj) for obj in objects], output_bin)
+
+            if self.cache_stats:
+                print(self.import_cache.report())
+            self._finish_time_report(base_name)
+
+            print(f"Successfully built: {output_bin}")
+            return output_bin
+
+        except Exception as e:
+            print(f"Compilation failed: {e}", file=sys.stderr)
+            sys.exit(1)
+
+    def compile_lto(self, filename: str, output_bin: str = None) -> str:
+        """Link the program with the prebuilt stdlib bitcode and optimize it as one module"""
+        from flto import link_program
+        from fbackend import FluxBackend
+        try:
+            base_name = Path(filename).stem
+            temp_dir = Path(f"flux_build_{base_name}")
+            llvm_module = link_program(Path(filename), self.module.triple, self.opt_level, temp_dir,
+                                       instrument=self.pgo_generate, profile=self.profile,
+                                       options=self.codegen_options)
+
+            if self.verbosity in (2, 4):
+                print(str(llvm_module))
+            backend = FluxBackend(self.module.triple, self.opt_level)
+            if self.verbosity in (3, 4):
+                with freport.phase("emit assembly"):
+                    print(backend.emit_assembly(llvm_module))
+
+            obj_file = temp_dir / f"{base_name}.o"
+            with freport.phase("emit object"), open(obj_file, 'wb') as f:
+                f.write(backend.emit_object(llvm_module))
+            self.temp_files.append(obj_file)
+
+            output_bin = output_bin or f"./{base_name}"
+            self._link([str(obj_file)], output_bin)
+
+            if self.cache_stats:
+                print(self.import_cache.report())
+            self._finish_time_report(base_name)
+
+            print(f"Successfully built: {output_bin}")
+            return output_bin
+
+        except Exception as e:
+            self.cleanup()
+            print(f"Compilation failed: {e}", file=sys.stderr)
+            sys.exit(1)
+
+    def run_file(self, filename: str, args: list = ()) -> int:
+        """JIT-compile the program, or reuse this session's compilation of it, and return main's exit code"""
+        from fjit import cached_program, jit_compile, run_main
+        if self.time_report:
+            self.time_report.start()
+        try:
+            program = cached_program(Path(filename), self.opt_level, self.codegen_options)
+            if program is None:
+                with open(filename, 'r') as f:
+                    source = f.read()
+                with freport.phase("parse"):
+                    ast = FluxParser(FluxLexer(source).iter_tokens()).parse()
+
+                # A fresh module and import set, or a second program in this session would skip its imports
+                module = ir.Module(name=Path(filename).stem, context=ir.Context())
+                module.triple = self.module.triple
+                module.data_layout = self.module.data_layout
+                ImportStatement._processed_imports = {}
+                apply_codegen_options(module, self.codegen_options, Path(filename), self.opt_level > 0)
+                with freport.phase("codegen"):
+                    module = ast.codegen(module)
+                if self.verbosity in (2, 4):
+                    print(str(module))
+
+                sources = [str(Path(filename).resolve())] + list(ImportStatement._processed_imports)
+                program = jit_compile(module, Path(filename), sources, self.opt_level, self.codegen_options)
+            else:
+                freport.count("jit cache hits")
+            self.sources = list(program.sources)
+        except Exception as e:
+            print(f"Compilation failed: {e}", file=sys.stderr)
+            sys.exit(1)
+
+        with freport.phase("run"):
+            status = run_main(program, [filename] + list(args))
+        self._finish_time_report(Path(filename).stem)
+        return status
+
+    def _finish_time_report(self, base_name: str) -> None:
+        if not self.time_report:
+            return
+        self.time_report.count("import cache hits", self.import_cache.hits)
+        self.time_report.count("import cache misses", self.import_cache.misses)
+        self.time_report.stop()
+        if self.time_report_format == "json":
+            report_file = f"{base_name}.time-report.json"
+            self.time_report.write_json(report_file)
+            print(f"Time report written to: {report_file}")
+        else:
+            print(self.time_report.format_text(), file=sys.stderr)
+
+    def _link(self, objects: list, output_bin: str) -> None:
+        link_args = objects + ["-o", output_bin]
+        import platform
+        with freport.phase("link", subprocess=True):
+            # The C++ runtime provides __cxa_throw and the personality routine behind
+            # try/catch; it is only recorded as a dependency of programs that use it
+            if platform.system() == "Darwin":  # macOS
+                # Use clang for linking on macOS
+                freport.run(["clang"] + link_args + ["-lc++", "-Wl,-dead_strip_dylibs"], check=True)
+            else:  # Linux
+                freport.run(["gcc", "-no-pie"] + link_args + ["-Wl,--as-needed", "-lstdc++", "-Wl,--no-as-needed"], check=True)
+
+    def _compile_in_process(self, llvm_ir: str, temp_dir: Path, base_name: str, obj_file: Path) -> str:
+        """Emit the object file through llvmlite, writing .ll/.s only when asked to"""
+        from fbackend import FluxBackend
+        backend = FluxBackend(self.module.triple, self.opt_level)
+
+        # 2. Parse and verify the module in memory
+        with freport.phase("ir verify"):
+            llvm_module = backend.parse(self.module)
+        with freport.phase("optimize"):
+            backend.optimize(llvm_module)
+
+        if self.verbosity in (2, 4):
+            ll_file = temp_dir / f"{base_name}.ll"
+            with open(ll_file, 'w') as f:
+                f.write(llvm_ir)
+            self.temp_files.append(ll_file)
+
+        # 3. Emit assembly only for -v3/-v4
+        asm_text = None
+        if self.verbosity in (3, 4):
+            with freport.phase("emit assembly"):
+                asm_text = backend.emit_assembly(llvm_module)
+            asm_file = temp_dir / f"{base_name}.s"
+            with open(asm_file, 'w') as f:
+                f.write(asm_text)
+            self.temp_files.append(asm_file)
+            if self.verbosity == 3:
+                print(asm_text)
+
+        # 4. Emit the object file straight from memory
+        with freport.phase("emit object"), open(obj_file, 'wb') as f:
+            f.write(backend.emit_object(llvm_module))
+        return asm_text
+
+    def _compile_with_toolchain(self, llvm_ir: str, temp_dir: Path, base_name: str, obj_file: Path) -> str:
+        """Emit the object file by running the external llc/as toolchain"""
+        # 2. llc only runs backend passes, so hand it IR that went through the mid-level pipeline
+        from fbackend import FluxBackend
+        backend = FluxBackend(self.module.triple, self.opt_level)
+        with freport.phase("ir verify"):
+            llvm_module = backend.parse(self.module)
+        with freport.phase("optimize"):
+            backend.optimize(llvm_module)
+
+        ll_file = temp_dir / f"{base_name}.ll"
+        with open(ll_file, 'w') as f:
+            f.write(str(llvm_module))
+        self.temp_files.append(ll_file)
+        
+        # 3. Compile directly to object file (skip assembly step on macOS)
+        opt_flag = f"-O{self.opt_level}"
+        import platform
+        if platform.system() == "Darwin":  # macOS
+            # Compile directly to object file to avoid assembly issues
+            with freport.phase("llc", subprocess=True):
+                freport.run([
+                    "llc",
+                    opt_flag,            # Optimization level
+                    "-filetype=obj",     # Output object file directly
+                    str(ll_file),
+                    "-o", str(obj_file)
+                ], check=True)
+            return None
+
+        # Linux - use traditional assembly step
+        asm_file = temp_dir / f"{base_name}.s"
+        with freport.phase("llc", subprocess=True):
+            freport.run([
+                "llc",
+                opt_flag,                # Optimization level
+                str(ll_file),
+                "-o", str(asm_file)
+            ], check=True)
+        self.temp_files.append(asm_file)
+
+        with open(asm_file, "r") as f:
+            asm_text = f.read()
+        if self.verbosity == 3:
+            print(asm_text)
+        
+        with freport.phase("as", subprocess=True):
+            freport.run([
+                "as", "--64", str(asm_file), "-o", str(obj_file)
+            ], check=True)
+        return asm_text
     
     def cleanup(self):
         """Remove temporary files"""
@@ -136,50 +371,255 @@ class FluxCompiler:
             except:
                 pass
 
+def build_stdlib() -> None:
+    """Compile the standard library into libfx for --lto builds"""
+    from flto import build_library
+    triple = FluxCompiler().module.triple
+    library = build_library(triple)
+    print(library.report())
+
+def merge_profile_files(output: str, inputs: list) -> None:
+    """Sum the counts of several profiling runs into one profile for --pgo-use"""
+    if not inputs:
+        print("Error: --pgo-merge needs an output file and at least one profile", file=sys.stderr)
+        sys.exit(1)
+    try:
+        merged = merge_profiles(Path(path) for path in inputs)
+    except (OSError, ValueError) as e:
+        print(f"Error: {e}", file=sys.stderr)
+        sys.exit(1)
+    merged.write(Path(output))
+    print(f"Merged {len(inputs)} profiles into {output}: "
+          f"{len(merged.functions)} functions, {len(merged.branches)} branches")
+
+def watch(make_compiler, input_file: str, build) -> None:
+    """
+    Build, then build again whenever one of the files the build read
+    changes. Each build is a fresh compiler in this warm process; with
+    --incremental (implied by --watch) only changed modules and the
+    modules compiled against them are recompiled.
+    """
+    ImportCache.keep_in_memory = True
+    watched = {str(Path(input_file).resolve())}
+
+    def snapshot():
+        stamps = {}
+        for path in watched:
+            try:
+                stat = os.stat(path)
+                stamps[path] = (stat.st_mtime_ns, stat.st_size)
+            except OSError:
+                stamps[path] = None  # Deleted, or mid-save
+        return stamps
+
+    while True:
+        compiler = make_compiler()
+        started = time.perf_counter()
+        try:
+            build(compiler)
+        except SystemExit:
+            pass  # The error is reported; wait for the fix
+        finally:
+            compiler.cleanup()
+        # A failed build may not have reached every import, so never stop watching a file
+        watched.update(compiler.sources)
+        print(f"[watch] done in {time.perf_counter() - started:.2f}s, watching {len(watched)} files (Ctrl+C to stop)")
+        sys.stdout.flush()
+
+        stamps = snapshot()
+        try:
+            while snapshot() == stamps:
+                time.sleep(0.2)
+        except KeyboardInterrupt:
+            return
+        time.sleep(0.05)  # Let an editor finish writing
+
 def main():
+    if len(sys.argv) >= 2 and sys.argv[1] == "--server":
+        from fserver import serve
+        try:
+            serve(main, Path(sys.argv[2]) if len(sys.argv) >= 3 else None)
+        except (OSError, RuntimeError) as e:
+            print(f"Error: {e}", file=sys.stderr)
+            sys.exit(1)
+        return
+    if len(sys.argv) >= 2 and sys.argv[1] == "--build-stdlib":
+        build_stdlib()
+        return
+    if len(sys.argv) >= 3 and sys.argv[1] == "--pgo-merge":
+        merge_profile_files(sys.argv[2], sys.argv[3:])
+        return
+
     if len(sys.argv) < 2:
-        print("Usage: python fc.py input.fx [output_binary] ...arguments...\n\n")
+        print("Usage: python fc.py input.fx [output_binary] ...arguments...")
+        print("       python fc.py --build-stdlib\tPrecompile the standard library into libfx (~/.flux/libfx)")
+        print("       python fc.py --pgo-merge out.fxprofdata run1.fxprofraw ...\tSum profiles from several runs")
+        print("       python fc.py --server [socket]\tKeep a warm compiler running; build through it with")
+        print("       \t\t\t\tpython fserver.py input.fx ...arguments..., stop it with python fserver.py --stop\n\n")
         print("\tArguments:\n")
         print("\t\t-vX\tVerbose output. X = 0..4\n")
         print("\t\t\t\t0: Tokens")
         print("\t\t\t\t1: AST")
         print("\t\t\t\t2: LLVM IR")
         print("\t\t\t\t3: ASM")
-        print("\t\t\t\t4: Everything")
+        print("\t\t\t\t4: Everything\n")
+        print("\t\t-OX\tOptimization level. X = 0..3 (default 2)\n")
+        print("\t\t--llc\tUse the external llc/as toolchain instead of the in-process backend\n")
+        print("\t\t--no-cache\tDo not read or write the parsed import cache (~/.flux/cache)\n")
+        print("\t\t--cache-stats\tReport import cache hits and misses\n")
+        print("\t\t--incremental\tCompile each imported module to its own object and only rebuild what changed\n")
+        print("\t\t-j N\tCompile modules in N worker processes (implies --incremental, 0 = all cores)\n")
+        print("\t\t--lto\tLink with the prebuilt stdlib bitcode and optimize the whole program as one module\n")
+        print("\t\t--run\tJIT-compile and run main in memory, writing nothing to disk; arguments")
+        print("\t\t\t\tafter -- are passed to the program and its exit code is returned\n")
+        print("\t\t--pgo-generate\tInstrument the binary to append call and branch counts to $FLUX_PROFILE_FILE")
+        print("\t\t\t\t(default.fxprofraw) at exit")
+        print("\t\t--pgo-use=FILE\tWeight branches and mark hot/cold functions from a profile\n")
+        print("\t\t-g\tEmit DWARF line tables so debuggers and profilers map code to .fx lines\n")
+        print("\t\t--frame-pointers\tKeep frame pointers in every function, for stack-walking profilers\n")
+        print("\t\t--instrument-functions\tCall __cyg_profile_func_enter/__cyg_profile_func_exit on every")
+        print("\t\t\t\tfunction entry and return, as GCC's -finstrument-functions does\n")
+        print("\t\t--watch\tRebuild (or rerun, with --run) whenever the program or one of its imports")
+        print("\t\t\t\tchanges; implies --incremental for builds\n")
+        print("\t\t--time-report\tReport wall time and peak memory per phase, plus token/AST/IR counts")
+        print("\t\t--time-report=json\tWrite the same report to <input>.time-report.json")
+        print("\t\t--trace-memory\tAlso trace Python heap peaks per phase (slow; implies --time-report)\n")
         sys.exit(1)
 
-    input_file = None
+    input_file = sys.argv[1]
     output_bin = None
-
-    if len(sys.argv) == 2:
-        input_file = sys.argv[1]
-        output_bin = sys.argv[2] if len(sys.argv) > 2 else None
-
     verbosity = None
+    opt_level = 2
+    use_llc = False
+    use_cache = True
+    cache_stats = False
+    incremental = False
+    jobs = 1
+    time_report = None
+    lto = False
+    pgo_generate = False
+    pgo_use = None
+    run = False
+    watch_files = False
+    debug_info = False
+    frame_pointers = False
+    instrument_functions = False
+    trace_memory = False
+    program_args = []
 
-    if len(sys.argv) > 2:
-        input_file = sys.argv[1]
-        output_bin = sys.argv[2] if len(sys.argv) > 2 else None
-        for arg in sys.argv:
-            if arg.lower().startswith("-v"):
-                if len(arg) > 2 and arg[2:].isdigit():
-                    verbosity = int(arg[2:])
-            elif arg.lower() == "-o":
-                    with open(input_file, 'r') as f:
-                        source = f.read()
-                    lexer = FluxLexer(source)
-                    tokens = lexer.tokenize()
-                    parser = FluxParser(tokens)
-                    ast = parser.parse()
-                    print(ast)
-                    return
+    args = iter(sys.argv[2:])
+    for arg in args:
+        if arg.lower().startswith("-v"):
+            if len(arg) > 2 and arg[2:].isdigit():
+                verbosity = int(arg[2:])
+        elif arg.startswith("-O") and len(arg) > 2:
+            if arg[2:] not in ("0", "1", "2", "3"):
+                print(f"Error: Invalid optimization level '{arg}', expected -O0..-O3", file=sys.stderr)
+                sys.exit(1)
+            opt_level = int(arg[2:])
+        elif arg == "--llc":
+            use_llc = True
+        elif arg == "--no-cache":
+            use_cache = False
+        elif arg == "--cache-stats":
+            cache_stats = True
+        elif arg == "--incremental":
+            incremental = True
+        elif arg == "--lto":
+            lto = True
+        elif arg == "--run":
+            run = True
+        elif arg == "--watch":
+            watch_files = True
+        elif arg == "-g":
+            debug_info = True
+        elif arg == "--frame-pointers":
+            frame_pointers = True
+        elif arg == "--instrument-functions":
+            instrument_functions = True
+        elif arg == "--":
+            program_args = list(args)
+            break
+        elif arg == "--pgo-generate":
+            pgo_generate = True
+        elif arg.startswith("--pgo-use="):
+            pgo_use = arg.split("=", 1)[1]
+            if not os.path.exists(pgo_use):
+                print(f"Error: Profile '{pgo_use}' not found", file=sys.stderr)
+                sys.exit(1)
+        elif arg == "--time-report":
+            time_report = "text"
+        elif arg == "--trace-memory":
+            trace_memory = True
+            time_report = time_report or "text"
+        elif arg.startswith("--time-report="):
+            time_report = arg.split("=", 1)[1]
+            if time_report not in ("text", "json"):
+                print(f"Error: Unknown time report format '{time_report}', expected text or json", file=sys.stderr)
+                sys.exit(1)
+        elif arg.startswith("-j"):
+            value = arg[2:] or next(args, "")
+            if not value.isdigit():
+                print(f"Error: Expected a job count after -j, got '{value}'", file=sys.stderr)
+                sys.exit(1)
+            jobs = int(value) or os.cpu_count() or 1
+            incremental = True
+        elif arg.lower() == "-o":
+            with open(input_file, 'r') as f:
+                source = f.read()
+            lexer = FluxLexer(source)
+            tokens = lexer.iter_tokens()
+            parser = FluxParser(tokens)
+            ast = parser.parse()
+            print(ast)
+            return
+        elif not arg.startswith("-") and output_bin is None:
+            output_bin = arg
 
     
+    if watch_files and (lto or pgo_generate or pgo_use):
+        print("Error: --watch rebuilds incrementally and cannot be combined with --lto or --pgo-*", file=sys.stderr)
+        sys.exit(1)
+    if watch_files and not run:
+        incremental = True
+
+    if lto and (incremental or use_llc):
+        print("Error: --lto links in process and cannot be combined with --incremental, -j or --llc", file=sys.stderr)
+        sys.exit(1)
+    if pgo_generate and pgo_use:
+        print("Error: --pgo-generate and --pgo-use are separate builds", file=sys.stderr)
+        sys.exit(1)
+    if (pgo_generate or pgo_use) and incremental:
+        # Reused objects would keep whatever counters or weights they were built with
+        print("Error: --pgo-generate and --pgo-use cannot be combined with --incremental or -j", file=sys.stderr)
+        sys.exit(1)
+
+    if run and (incremental or lto or use_llc or pgo_generate or pgo_use or output_bin):
+        print("Error: --run compiles in memory and cannot be combined with an output binary, "
+              "--incremental, -j, --lto, --llc or --pgo-*", file=sys.stderr)
+        sys.exit(1)
+
     if not input_file.endswith('.fx'):
         print("Error: Input file must have .fx extension", file=sys.stderr)
         sys.exit(1)
     
-    compiler = FluxCompiler(verbosity=verbosity)
+    def make_compiler():
+        return FluxCompiler(verbosity=verbosity, opt_level=opt_level, use_llc=use_llc,
+                            use_cache=use_cache, cache_stats=cache_stats, incremental=incremental,
+                            jobs=jobs, time_report=time_report, trace_memory=trace_memory, lto=lto,
+                            pgo_generate=pgo_generate, pgo_use=pgo_use, debug_info=debug_info,
+                            frame_pointers=frame_pointers, instrument_functions=instrument_functions)
+    if watch_files:
+        if run:
+            watch(make_compiler, input_file, lambda compiler: print(
+                f"[watch] exit code {compiler.run_file(input_file, program_args)}"))
+        else:
+            watch(make_compiler, input_file, lambda compiler: compiler.compile_file(input_file, output_bin))
+        return
+
+    compiler = make_compiler()
+    if run:
+        sys.exit(compiler.run_file(input_file, program_args))
     try:
         binary_path = compiler.compile_file(input_file, output_bin)
         print(f"Executable created at: {binary_path}")
@@ -187,4 +627,4 @@ def main():
         compiler.cleanup()
 
 if __name__ == "__main__":
-    main()
\ No newline at end of file
+    main()
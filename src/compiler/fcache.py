@@ -0,0 +1,114 @@
+"""
+Flux Import Cache
+
+Persistent on-disk cache of parsed import modules. Entries are keyed by
+the module's resolved path, a hash of its source and the compiler
+version, so a changed module or a changed compiler never reuses a stale
+Program.
+
+Set FLUX_NO_CACHE=1 (or pass --no-cache to fc.py) to disable it and
+FLUX_CACHE_DIR to move it away from ~/.flux/cache.
+
+A long-lived compiler (fc.py --server or --watch) also keeps the modules
+it loads in memory, so a rebuild neither parses nor unpickles them again.
+Codegen does not modify the AST, which makes sharing them safe.
+"""
+
+import os
+import pickle
+import hashlib
+from pathlib import Path
+from typing import Dict, Optional, Any, Tuple
+
+# Bump when the cache entry format changes
+CACHE_FORMAT = 1
+
+_compiler_version = None
+
+def compiler_version() -> str:
+    """Fingerprint of the front end sources that produce cached ASTs"""
+    global _compiler_version
+    if _compiler_version is None:
+        digest = hashlib.sha256(f"flux-cache-{CACHE_FORMAT}".encode())
+        compiler_dir = Path(__file__).parent
+        for name in ("flexer.py", "fparser.py", "fast.py"):
+            digest.update((compiler_dir / name).read_bytes())
+        _compiler_version = digest.hexdigest()[:16]
+    return _compiler_version
+
+def default_cache_dir() -> Path:
+    return Path(os.environ.get("FLUX_CACHE_DIR", Path.home() / ".flux" / "cache"))
+
+def cache_disabled_by_env() -> bool:
+    return os.environ.get("FLUX_NO_CACHE", "") not in ("", "0")
+
+class ImportCache:
+    keep_in_memory = False                     # Set for the whole process by --server and --watch
+    _parsed: Dict[str, Tuple[Path, Any]] = {}  # Module path -> entry path and Program, latest version only
+
+    def __init__(self, cache_dir: Optional[Path] = None, enabled: bool = True):
+        self.cache_dir = Path(cache_dir) if cache_dir else default_cache_dir()
+        self.enabled = enabled and not cache_disabled_by_env()
+        self.hits = 0
+        self.misses = 0
+
+    def _entry_path(self, path: Path, source: str) -> Path:
+        content_hash = hashlib.sha256(source.encode('utf-8')).hexdigest()
+        key = hashlib.sha256(
+            f"{Path(path).resolve()}\0{content_hash}\0{compiler_version()}".encode('utf-8')
+        ).hexdigest()
+        return self.cache_dir / f"{key}.pickle"
+
+    def load(self, path: Path, source: str) -> Optional[Any]:
+        """Return the cached Program for this exact source, or None"""
+        if not self.enabled:
+            return None
+        entry = self._entry_path(path, source)
+        remembered = self._parsed.get(str(path))
+        if self.keep_in_memory and remembered is not None and remembered[0] == entry:
+            self.hits += 1
+            return remembered[1]
+        try:
+            with open(entry, 'rb') as f:
+                program = pickle.load(f)
+        except FileNotFoundError:
+            self.misses += 1
+            return None
+        except Exception:
+            # Corrupt or unreadable entry, drop it and reparse
+            self.misses += 1
+            try:
+                os.remove(entry)
+            except OSError:
+                pass
+            return None
+        self.hits += 1
+        self._remember(path, entry, program)
+        return program
+
+    def _remember(self, path: Path, entry: Path, program: Any) -> None:
+        if self.keep_in_memory:
+            self._parsed[str(path)] = (entry, program)
+
+    def store(self, path: Path, source: str, program: Any) -> None:
+        """Write a parsed Program; failures only cost the cache entry"""
+        if not self.enabled:
+            return
+        entry = self._entry_path(path, source)
+        self._remember(path, entry, program)
+        temp = entry.with_suffix(f".{os.getpid()}.tmp")
+        try:
+            self.cache_dir.mkdir(parents=True, exist_ok=True)
+            with open(temp, 'wb') as f:
+                pickle.dump(program, f, protocol=pickle.HIGHEST_PROTOCOL)
+            os.replace(temp, entry)
+        except (OSError, pickle.PicklingError, RecursionError):
+            try:
+                os.remove(temp)
+            except OSError:
+                pass
+
+    def report(self) -> str:
+        if not self.enabled:
+            return "Import cache: disabled"
+        return f"Import cache: {self.hits} hits, {self.misses} misses ({self.cache_dir})"
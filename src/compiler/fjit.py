@@ -0,0 +1,134 @@
+"""
+Flux JIT
+
+fc.py --run compiles a program with MCJIT into this process and runs its
+main in a forked child: no build directory, no object file, no link
+step. Symbols the program does not define (libc, and the C++ runtime
+behind try/catch) are resolved from the libraries loaded into the process.
+
+Compiled programs stay in memory for the rest of the session, keyed by
+entry file, -O level and codegen options. A later run of the same program only rehashes
+its source files and, if none changed, forks straight into the existing
+code. Since every run is a child, the compiler process (a --server or
+--watch loop) survives a program that exits, aborts or crashes.
+"""
+
+import os
+import sys
+import ctypes
+import ctypes.util
+import hashlib
+import signal
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Any, Callable, Dict, List, Optional, Tuple
+
+from llvmlite import ir
+from llvmlite import binding as llvm
+import freport
+
+@dataclass
+class JitProgram:
+    engine: llvm.ExecutionEngine
+    sources: Dict[str, str]  # Resolved path -> hash of every file compiled in
+    main: Callable
+    takes_arguments: bool
+
+# (entry file, opt level, codegen options) -> program, for the whole session
+_programs: Dict[Tuple[str, int, Any], JitProgram] = {}
+
+_loaded_libraries = set()
+
+def file_hash(path: str) -> Optional[str]:
+    try:
+        return hashlib.sha256(Path(path).read_bytes()).hexdigest()
+    except OSError:
+        return None
+
+def cached_program(entry: Path, opt_level: int, options: Any = None) -> Optional[JitProgram]:
+    """The compiled program, unless one of its source files changed since"""
+    program = _programs.get((str(entry.resolve()), opt_level, options))
+    if program is None:
+        return None
+    if any(file_hash(path) != digest for path, digest in program.sources.items()):
+        return None
+    return program
+
+def load_runtime(module: ir.Module) -> None:
+    """Make the C++ runtime's symbols visible to the JIT when the program throws or catches"""
+    if not any(name.startswith(('__cxa_', '__gxx_personality')) for name in module.globals):
+        return
+    name = ctypes.util.find_library('c++' if sys.platform == 'darwin' else 'stdc++')
+    if name is not None and name not in _loaded_libraries:
+        llvm.load_library_permanently(name)
+        _loaded_libraries.add(name)
+
+def jit_compile(module: ir.Module, entry: Path, sources: List[str], opt_level: int,
+                options: Any = None) -> JitProgram:
+    """Optimize and compile module into this process and remember it for the session"""
+    from fbackend import FluxBackend
+    main = module.globals.get('main')
+    if not isinstance(main, ir.Function) or not main.blocks:
+        raise ValueError("No main function to run")
+
+    backend = FluxBackend(module.triple, opt_level, jit=True)
+    with freport.phase("ir verify"):
+        llvm_module = backend.parse(module)
+    with freport.phase("optimize"):
+        backend.optimize(llvm_module)
+    load_runtime(module)
+    with freport.phase("jit"):
+        # The engine owns llvm_module from here on
+        engine = llvm.create_mcjit_compiler(llvm_module, backend.target_machine)
+        engine.finalize_object()
+        engine.run_static_constructors()
+
+    takes_arguments = len(main.args) >= 2
+    signature = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_int, ctypes.POINTER(ctypes.c_char_p)) \
+        if takes_arguments else ctypes.CFUNCTYPE(ctypes.c_int)
+    digests = {path: file_hash(path) for path in sources}
+    program = JitProgram(engine, digests, signature(engine.get_function_address('main')), takes_arguments)
+    _programs[(str(entry.resolve()), opt_level, options)] = program
+    return program
+
+def call_main(program: JitProgram, argv: List[str]) -> int:
+    """Call main with argv in this process"""
+    if program.takes_arguments:
+        args = (ctypes.c_char_p * (len(argv) + 1))(*[arg.encode() for arg in argv], None)
+        return program.main(len(argv), args)
+    return program.main()
+
+def run_main(program: JitProgram, argv: List[str]) -> int:
+    """Run main with argv in a child process and return its exit code
+
+    The child is forked from this one, so it already has the compiled code
+    mapped and starts from the program's initial globals every run. An
+    exit(), abort() or crash in the program ends only the child, and the
+    handlers it registers with atexit run when the child exits instead of
+    piling up in a long-lived compiler. Without fork, main runs in-process.
+    """
+    libc = ctypes.CDLL(None)
+    sys.stdout.flush()
+    sys.stderr.flush()
+    if not hasattr(os, 'fork'):
+        status = call_main(program, argv)
+        # The program's stdio buffers would otherwise only be flushed when this process exits
+        libc.fflush(None)
+        return status & 0xFF
+
+    pid = os.fork()
+    if pid == 0:
+        try:
+            status = call_main(program, argv) & 0xFF
+        except BaseException as e:
+            print(f"Could not run main: {e}", file=sys.stderr)
+            sys.stderr.flush()
+            status = 70  # EX_SOFTWARE
+        # C's exit, not Python's: runs the program's atexit handlers and flushes its stdio
+        libc.exit(status)
+    _, wait_status = os.waitpid(pid, 0)
+    if os.WIFSIGNALED(wait_status):
+        signal_number = os.WTERMSIG(wait_status)
+        print(f"main was killed by {signal.Signals(signal_number).name}", file=sys.stderr)
+        return 128 + signal_number  # What a shell reports
+    return os.WEXITSTATUS(wait_status)
@@ -7,12 +7,15 @@ Usage:
     python3 flexer.py file.fx -v       # Verbose output with token positions
     python3 flexer.py file.fx -c       # Show token count summary
     python3 flexer.py file.fx -v -c    # Both verbose and count summary
+    python3 flexer.py file.fx --check  # Compare tokenize against the reference tokenizer
 """
 
 import re
+import sys
 from enum import Enum, auto
 from dataclasses import dataclass
-from typing import List, Optional, Iterator
+from typing import Iterable, Iterator, List, Optional, Tuple
+from collections import deque
 
 class TokenType(Enum):
     # Literals
@@ -127,11 +130,15 @@ class TokenType(Enum):
     DIVIDE_ASSIGN = auto()  # /=
     MODULO_ASSIGN = auto()  # %=
     POWER_ASSIGN = auto()   # ^=
+    XOR_ASSIGN = auto()     # ^^=
+    AND_ASSIGN = auto()     # &=
+    OR_ASSIGN = auto()      # |=
     LEFT_SHIFT_ASSIGN = auto()  # <<=
     RIGHT_SHIFT_ASSIGN = auto() # >>=
     
     # Other operators
     ADDRESS_OF = auto()     # @
+    BITWISE_NOT = auto()    # ~
     RANGE = auto()          # ..
     SCOPE = auto()          # ::
     QUESTION = auto()       # ?
@@ -159,11 +166,214 @@ class TokenType(Enum):
 
 @dataclass
 class Token:
+    __slots__ = ('type', 'value', 'line', 'column')  # One of these per token, keep them small
     type: TokenType
     value: str
     line: int
     column: int
 
+# TokenStream trims its window once this many consumed tokens have built up
+DISCARD_BATCH = 64
+
+class TokenStream:
+    """
+    Token source for FluxParser with bounded lookahead.
+
+    Pulls tokens lazily from any iterable (normally FluxLexer.iter_tokens)
+    and only holds a window of them: the previous token, whatever the
+    parser has peeked ahead, and everything since the oldest outstanding
+    mark so speculative parses can backtrack.
+    """
+    def __init__(self, tokens: Iterable[Token]):
+        self._source = iter(tokens)
+        self._window = deque()
+        self._base = 0       # Index of _window[0] in the whole token sequence
+        self._marks = []     # Positions a speculative parse may reset to
+        self._exhausted = False
+
+    @property
+    def pulled(self) -> int:
+        """Number of tokens read from the source so far"""
+        return self._base + len(self._window)
+
+    def get(self, index: int) -> Optional[Token]:
+        """Token at index, or None past the end of the source"""
+        offset = index - self._base
+        window = self._window
+        if 0 <= offset < len(window):
+            return window[offset]
+        if offset < 0:
+            raise IndexError(f"Token {index} is no longer buffered (window starts at {self._base})")
+        while offset >= len(window):
+            if self._exhausted:
+                return None
+            token = next(self._source, None)
+            if token is None:
+                self._exhausted = True
+                return None
+            window.append(token)
+        return window[offset]
+
+    def mark(self, index: int) -> None:
+        self._marks.append(index)
+
+    def release(self, index: int) -> None:
+        self._marks.remove(index)
+
+    def discard_before(self, index: int) -> None:
+        """Drop buffered tokens before index that no mark still needs"""
+        if index - self._base < DISCARD_BATCH:
+            return
+        if self._marks:
+            index = min(index, min(self._marks))
+        window = self._window
+        while self._base < index and window:
+            window.popleft()
+            self._base += 1
+
+# Operator tables for maximal-munch matching in FluxLexer.tokenize
+THREE_CHAR_OPERATORS = {
+    '<<=': TokenType.LEFT_SHIFT_ASSIGN,
+    '>>=': TokenType.RIGHT_SHIFT_ASSIGN,
+    '^^=': TokenType.XOR_ASSIGN,
+}
+
+TWO_CHAR_OPERATORS = {
+    '==': TokenType.EQUAL,
+    '!=': TokenType.NOT_EQUAL,
+    '<=': TokenType.LESS_EQUAL,
+    '<-': TokenType.CHAIN_ARROW,
+    '<~': TokenType.RECURSE_ARROW,
+    '>=': TokenType.GREATER_EQUAL,
+    '<<': TokenType.LEFT_SHIFT,
+    '>>': TokenType.RIGHT_SHIFT,
+    '++': TokenType.INCREMENT,
+    '--': TokenType.DECREMENT,
+    '+=': TokenType.PLUS_ASSIGN,
+    '-=': TokenType.MINUS_ASSIGN,
+    '->': TokenType.RETURN_ARROW,
+    '*=': TokenType.MULTIPLY_ASSIGN,
+    '/=': TokenType.DIVIDE_ASSIGN,
+    '%=': TokenType.MODULO_ASSIGN,
+    '^=': TokenType.POWER_ASSIGN,
+    '&=': TokenType.AND_ASSIGN,
+    '|=': TokenType.OR_ASSIGN,
+    '..': TokenType.RANGE,
+    '::': TokenType.SCOPE,
+}
+
+SINGLE_CHAR_TOKENS = {
+    '+': TokenType.PLUS,
+    '-': TokenType.MINUS,
+    '*': TokenType.MULTIPLY,
+    '/': TokenType.DIVIDE,
+    '%': TokenType.MODULO,
+    '^': TokenType.POWER,
+    '<': TokenType.LESS_THAN,
+    '>': TokenType.GREATER_THAN,
+    '&': TokenType.AND,
+    '|': TokenType.OR,
+    '!': TokenType.NOT,
+    '~': TokenType.BITWISE_NOT,
+    '@': TokenType.ADDRESS_OF,
+    '=': TokenType.ASSIGN,
+    '?': TokenType.QUESTION,
+    ':': TokenType.COLON,
+    '(': TokenType.LEFT_PAREN,
+    ')': TokenType.RIGHT_PAREN,
+    '[': TokenType.LEFT_BRACKET,
+    ']': TokenType.RIGHT_BRACKET,
+    '{': TokenType.LEFT_BRACE,
+    '}': TokenType.RIGHT_BRACE,
+    ';': TokenType.SEMICOLON,
+    ',': TokenType.COMMA,
+    '.': TokenType.DOT,
+}
+
+# Built once per process; every lexer shares it
+KEYWORDS = {
+    'alignof': TokenType.ALIGNOF,
+    'and': TokenType.AND,
+    'as': TokenType.AS,
+    'asm': TokenType.ASM,
+    'at': TokenType.AT,
+    'asm': TokenType.ASM,
+    'assert': TokenType.ASSERT,
+    'auto': TokenType.AUTO,
+    'break': TokenType.BREAK,
+    'bool': TokenType.BOOL_KW,
+    'case': TokenType.CASE,
+    'catch': TokenType.CATCH,
+    'char': TokenType.CHAR,
+    'compt': TokenType.COMPT,
+    'const': TokenType.CONST,
+    'continue': TokenType.CONTINUE,
+    'data': TokenType.DATA,
+    'def': TokenType.DEF,
+    'default': TokenType.DEFAULT,
+    'do': TokenType.DO,
+    'elif': TokenType.ELIF,
+    'else': TokenType.ELSE,
+    'extern': TokenType.EXTERN,
+    'false': TokenType.FALSE,
+    'float': TokenType.FLOAT_KW,
+    'from': TokenType.FROM,
+    'for': TokenType.FOR,
+    'if': TokenType.IF,
+    'import': TokenType.IMPORT,
+    'in': TokenType.IN,
+    'int': TokenType.INT,
+    'namespace': TokenType.NAMESPACE,
+    'not': TokenType.NOT,
+    'object': TokenType.OBJECT,
+    'or': TokenType.OR,
+    'private': TokenType.PRIVATE,
+    'public': TokenType.PUBLIC,
+    'return': TokenType.RETURN,
+    'signed': TokenType.SIGNED,
+    'sizeof': TokenType.SIZEOF,
+    'struct': TokenType.STRUCT,
+    'super': TokenType.SUPER,
+    'switch': TokenType.SWITCH,
+    'this': TokenType.THIS,
+    'throw': TokenType.THROW,
+    'true': TokenType.TRUE,
+    'try': TokenType.TRY,
+    'typeof': TokenType.TYPEOF,
+    'union': TokenType.UNION,
+    'unsigned': TokenType.UNSIGNED,
+    'using': TokenType.USING,
+    'virtual': TokenType.VIRTUAL,
+    'void': TokenType.VOID,
+    'volatile': TokenType.VOLATILE,
+    'while': TokenType.WHILE,
+    'xor': TokenType.XOR,
+    # Fixed-width integer types
+    'uint8': TokenType.UINT8,
+    'uint16': TokenType.UINT16,
+    'uint32': TokenType.UINT32,
+    'uint64': TokenType.UINT64,
+    'int8': TokenType.INT8,
+    'int16': TokenType.INT16,
+    'int32': TokenType.INT32,
+    'int64': TokenType.INT64
+}
+
+ESCAPE_MAP = {'n': '\n', 't': '\t', 'r': '\r', '\\': '\\', '"': '"'}
+HEX_DIGITS = '0123456789abcdefABCDEF'
+
+_WHITESPACE_RE = re.compile(r'[ \t\r\n]+')
+_IDENTIFIER_RE = re.compile(r'\w+')  # \w is isalnum() or '_', as in read_identifier
+_HEX_RE = re.compile(r'0[xX][0-9a-fA-F]*')
+_BINARY_RE = re.compile(r'0[bB][01]*')
+_DECIMAL_RE = re.compile(r'[0-9]+(?:\.[0-9]+)?')
+_BRACE_RE = re.compile(r'[{}]')
+_F_STRING_STOP_RE = re.compile(r'[{\\"]')
+_STRING_STOP_RE = {
+    '"': re.compile(r'[\\"]'),
+    "'": re.compile(r"[\\']"),
+}
+
 class FluxLexer:
     def __init__(self, source_code: str):
         self.source = source_code
@@ -172,74 +382,7 @@ class FluxLexer:
         self.column = 1
         self.length = len(source_code)
         
-        # Keywords mapping
-        self.keywords = {
-            'alignof': TokenType.ALIGNOF,
-            'and': TokenType.AND,
-            'as': TokenType.AS,
-            'asm': TokenType.ASM,
-            'at': TokenType.AT,
-            'asm': TokenType.ASM,
-            'assert': TokenType.ASSERT,
-            'auto': TokenType.AUTO,
-            'break': TokenType.BREAK,
-            'bool': TokenType.BOOL_KW,
-            'case': TokenType.CASE,
-            'catch': TokenType.CATCH,
-            'char': TokenType.CHAR,
-            'compt': TokenType.COMPT,
-            'const': TokenType.CONST,
-            'continue': TokenType.CONTINUE,
-            'data': TokenType.DATA,
-            'def': TokenType.DEF,
-            'default': TokenType.DEFAULT,
-            'do': TokenType.DO,
-            'elif': TokenType.ELIF,
-            'else': TokenType.ELSE,
-            'extern': TokenType.EXTERN,
-            'false': TokenType.FALSE,
-            'float': TokenType.FLOAT_KW,
-            'from': TokenType.FROM,
-            'for': TokenType.FOR,
-            'if': TokenType.IF,
-            'import': TokenType.IMPORT,
-            'in': TokenType.IN,
-            'int': TokenType.INT,
-            'namespace': TokenType.NAMESPACE,
-            'not': TokenType.NOT,
-            'object': TokenType.OBJECT,
-            'or': TokenType.OR,
-            'private': TokenType.PRIVATE,
-            'public': TokenType.PUBLIC,
-            'return': TokenType.RETURN,
-            'signed': TokenType.SIGNED,
-            'sizeof': TokenType.SIZEOF,
-            'struct': TokenType.STRUCT,
-            'super': TokenType.SUPER,
-            'switch': TokenType.SWITCH,
-            'this': TokenType.THIS,
-            'throw': TokenType.THROW,
-            'true': TokenType.TRUE,
-            'try': TokenType.TRY,
-            'typeof': TokenType.TYPEOF,
-            'union': TokenType.UNION,
-            'unsigned': TokenType.UNSIGNED,
-            'using': TokenType.USING,
-            'virtual': TokenType.VIRTUAL,
-            'void': TokenType.VOID,
-            'volatile': TokenType.VOLATILE,
-            'while': TokenType.WHILE,
-            'xor': TokenType.XOR,
-            # Fixed-width integer types
-            'uint8': TokenType.UINT8,
-            'uint16': TokenType.UINT16,
-            'uint32': TokenType.UINT32,
-            'uint64': TokenType.UINT64,
-            'int8': TokenType.INT8,
-            'int16': TokenType.INT16,
-            'int32': TokenType.INT32,
-            'int64': TokenType.INT64
-        }
+        self.keywords = KEYWORDS
     
     def current_char(self) -> Optional[str]:
         if self.position >= self.length:
@@ -419,6 +562,8 @@ class FluxLexer:
         if result == 'true' or result == 'false':
             token_type = TokenType.BOOL
         
+        if token_type is TokenType.IDENTIFIER:
+            result = sys.intern(result)
         return Token(token_type, result, start_pos[0], start_pos[1])
     
     def read_interpolation_string(self) -> Token:
@@ -455,7 +600,234 @@ class FluxLexer:
         
         return Token(TokenType.I_STRING, result, start_pos[0], start_pos[1])
     
+    def _scan_braces(self, pos: int) -> int:
+        """Return the index just past the '}' matching the '{' at pos"""
+        depth = 0
+        search = _BRACE_RE.search
+        while True:
+            match = search(self.source, pos)
+            if match is None:
+                return self.length
+            depth += 1 if match.group() == '{' else -1
+            pos = match.end()
+            if depth == 0:
+                return pos
+
+    def _scan_string(self, pos: int, quote_char: str) -> Tuple[str, int]:
+        """Bulk equivalent of read_string; pos is the opening quote"""
+        source = self.source
+        length = self.length
+        search = _STRING_STOP_RE[quote_char].search
+        parts = []
+        pos += 1
+        while True:
+            match = search(source, pos)
+            if match is None:
+                # A bare \x at EOF leaves read_string one past the end
+                parts.append(source[pos:])
+                return ''.join(parts), max(pos, length)
+            stop = match.start()
+            if stop > pos:
+                parts.append(source[pos:stop])
+            if source[stop] == quote_char:
+                return ''.join(parts), stop + 1
+            # Backslash escape
+            escape_char = source[stop + 1] if stop + 1 < length else None
+            if escape_char in ESCAPE_MAP:
+                parts.append(ESCAPE_MAP[escape_char])
+                pos = stop + 2
+            elif escape_char == 'x':
+                pos = stop + 2
+                end = pos
+                while end < length and end - pos < 2 and source[end] in HEX_DIGITS:
+                    end += 1
+                if end > pos:
+                    parts.append(chr(int(source[pos:end], 16)))
+                    pos = end
+                else:
+                    # read_string skips the character after a bare \x
+                    pos += 1
+            else:
+                parts.append(escape_char if escape_char else '\\')
+                pos = stop + 2
+
+    def _scan_f_string(self, pos: int) -> Tuple[str, int]:
+        """Bulk equivalent of read_f_string; pos is the opening quote"""
+        source = self.source
+        length = self.length
+        search = _F_STRING_STOP_RE.search
+        parts = []
+        pos += 1
+        while True:
+            match = search(source, pos)
+            if match is None:
+                parts.append(source[pos:])
+                return ''.join(parts), length
+            stop = match.start()
+            if stop > pos:
+                parts.append(source[pos:stop])
+            char = source[stop]
+            if char == '"':
+                return ''.join(parts), stop + 1
+            if char == '{':
+                # Embedded expressions are kept verbatim
+                pos = self._scan_braces(stop)
+                parts.append(source[stop:pos])
+            else:
+                escape_char = source[stop + 1] if stop + 1 < length else None
+                if escape_char in ESCAPE_MAP:
+                    parts.append(ESCAPE_MAP[escape_char])
+                else:
+                    parts.append(escape_char if escape_char else '\\')
+                pos = stop + 2
+
+    def _scan_number(self, pos: int) -> Optional[Tuple[TokenType, int]]:
+        """Match an ASCII number at pos, or None if read_number must decide"""
+        source = self.source
+        if source[pos] == '0' and pos + 1 < self.length and source[pos + 1] in 'xXbB':
+            regex = _HEX_RE if source[pos + 1] in 'xX' else _BINARY_RE
+            return TokenType.INTEGER, regex.match(source, pos).end()
+        match = _DECIMAL_RE.match(source, pos)
+        if match is None:
+            return None
+        end = match.end()
+        # Non-ASCII digits are rare; leave them to the character walker
+        if not source[end:end + 2].isascii():
+            return None
+        token_type = TokenType.FLOAT if '.' in match.group() else TokenType.INTEGER
+        return token_type, end
+
     def tokenize(self) -> List[Token]:
+        """Tokenize the whole source into a list, see iter_tokens"""
+        return list(self.iter_tokens())
+
+    def iter_tokens(self) -> Iterator[Token]:
+        """
+        Lazily tokenize the source, ending with an EOF token.
+
+        Produces the same tokens and positions as tokenize_reference, but
+        skips whitespace, comments and literal bodies with precompiled
+        regexes and matches operators through the maximal-munch tables.
+        FluxParser consumes this directly, so the compiler never holds
+        the whole token list.
+        """
+        source = self.source
+        length = self.length
+        keywords = self.keywords
+
+        pos = self.position
+        line = self.line
+        line_start = pos - (self.column - 1)
+
+        while pos < length:
+            char = source[pos]
+
+            if char in ' \t\r\n':
+                end = _WHITESPACE_RE.match(source, pos).end()
+                newlines = source.count('\n', pos, end)
+                if newlines:
+                    line += newlines
+                    line_start = source.rfind('\n', pos, end) + 1
+                pos = end
+                continue
+
+            next_char = source[pos + 1] if pos + 1 < length else ''
+
+            if char == '/' and next_char == '/':
+                end = source.find('\n', pos)
+                pos = length if end < 0 else end
+                continue
+
+            column = pos - line_start + 1
+            start = pos
+
+            if char == 'i' and next_char == '"':
+                # Token position is the opening quote, as in read_interpolation_string
+                string_part, pos = self._scan_string(pos + 1, '"')
+                pos = _WHITESPACE_RE.match(source, pos).end() if pos < length and source[pos] in ' \t\r\n' else pos
+                if pos < length and source[pos] == ':':
+                    pos += 1
+                pos = _WHITESPACE_RE.match(source, pos).end() if pos < length and source[pos] in ' \t\r\n' else pos
+                if pos < length and source[pos] == '{':
+                    end = self._scan_braces(pos)
+                    value = f'i"{string_part}":{source[pos:end]}'
+                    pos = end
+                else:
+                    value = f'i"{string_part}"'
+                yield Token(TokenType.I_STRING, value, line, column + 1)
+            elif char == 'f' and next_char == '"':
+                content, pos = self._scan_f_string(pos + 1)
+                yield Token(TokenType.F_STRING, f'f"{content}"', line, column)
+            elif char == '"' or char == "'":
+                content, pos = self._scan_string(pos, char)
+                yield Token(TokenType.STRING_LITERAL, content, line, column)
+            elif char == 'a' and source.startswith('sm"', pos + 1):
+                yield Token(TokenType.ASM, 'asm', line, column)
+                body_start = pos + 4
+                end = source.find('""', body_start)
+                if end < 0:
+                    yield Token(TokenType.ASM_BLOCK, source[body_start:], line, column + 3)
+                    pos = length
+                else:
+                    yield Token(TokenType.ASM_BLOCK, source[body_start:end], line, column + 3)
+                    pos = end + 2
+            elif char.isdigit():
+                number = self._scan_number(pos) if char.isascii() else None
+                if number is None:
+                    self.position, self.line, self.column = pos, line, column
+                    yield self.read_number()
+                    pos = self.position
+                    continue
+                token_type, pos = number
+                yield Token(token_type, source[start:pos], line, column)
+                continue
+            elif char.isalpha() or char == '_':
+                pos = _IDENTIFIER_RE.match(source, pos).end()
+                word = source[start:pos]
+                if word == 'true' or word == 'false':
+                    token_type = TokenType.BOOL
+                else:
+                    token_type = keywords.get(word, TokenType.IDENTIFIER)
+                    if token_type is TokenType.IDENTIFIER:
+                        # One string object per name, so symbol lookups compare by identity
+                        word = sys.intern(word)
+                yield Token(token_type, word, line, column)
+                continue
+            else:
+                operator = source[pos:pos + 3]
+                token_type = THREE_CHAR_OPERATORS.get(operator)
+                if token_type is None:
+                    operator = operator[:2]
+                    token_type = TWO_CHAR_OPERATORS.get(operator)
+                    if token_type is None:
+                        operator = char
+                        token_type = SINGLE_CHAR_TOKENS.get(char)
+                pos += len(operator)
+                if token_type is not None:
+                    yield Token(token_type, operator, line, column)
+                # Unknown characters are skipped
+                continue
+
+            # Literal bodies may span lines
+            newlines = source.count('\n', start, pos)
+            if newlines:
+                line += newlines
+                line_start = source.rfind('\n', start, pos) + 1
+
+        self.position = pos
+        self.line = line
+        self.column = pos - line_start + 1
+
+        # Add EOF token
+        yield Token(TokenType.EOF, '', self.line, self.column)
+    
+    def tokenize_reference(self) -> List[Token]:
+        """
+        Original character-at-a-time tokenizer.
+
+        Kept as the reference implementation for differential checks of
+        tokenize (see `flexer.py file.fx --check`).
+        """
         tokens = []
         
         while self.position < self.length:
@@ -594,7 +966,7 @@ class FluxLexer:
                     self.advance(count=2)
                     continue
                 if self.peek_char() == '>':
-                    tokens.append(Token(TokenType.RETURN_ARROW, '-=', start_pos[0], start_pos[1]))
+                    tokens.append(Token(TokenType.RETURN_ARROW, '->', start_pos[0], start_pos[1]))
                     self.advance(count=2)
                     continue
             
@@ -651,6 +1023,7 @@ class FluxLexer:
                 '&': TokenType.AND,
                 '|': TokenType.OR,
                 '!': TokenType.NOT,
+                '~': TokenType.BITWISE_NOT,
                 '@': TokenType.ADDRESS_OF,
                 '=': TokenType.ASSIGN,
                 '?': TokenType.QUESTION,
@@ -678,6 +1051,22 @@ class FluxLexer:
         tokens.append(Token(TokenType.EOF, '', self.line, self.column))
         return tokens
 
+def check_tokenizers(source_code: str, name: str = "<source>") -> int:
+    """Differential check of tokenize against tokenize_reference; returns an exit status"""
+    expected = FluxLexer(source_code).tokenize_reference()
+    actual = FluxLexer(source_code).tokenize()
+    for i, (want, got) in enumerate(zip(expected, actual)):
+        if want != got:
+            print(f"{name}: token {i} differs", file=sys.stderr)
+            print(f"  reference: {want}", file=sys.stderr)
+            print(f"  tokenize:  {got}", file=sys.stderr)
+            return 1
+    if len(expected) != len(actual):
+        print(f"{name}: token count differs ({len(expected)} reference, {len(actual)} tokenize)", file=sys.stderr)
+        return 1
+    print(f"{name}: {len(actual)} tokens match")
+    return 0
+
 # Example usage and testing
 if __name__ == "__main__":
     import sys
@@ -690,6 +1079,8 @@ if __name__ == "__main__":
                           help='Show detailed token information')
         parser.add_argument('-c', '--count', action='store_true',
                           help='Show token count summary')
+        parser.add_argument('--check', action='store_true',
+                          help='Compare tokenize against tokenize_reference and report the first difference')
         
         args = parser.parse_args()
         
@@ -703,6 +1094,9 @@ if __name__ == "__main__":
             print(f"Error reading file '{args.file}': {e}", file=sys.stderr)
             sys.exit(1)
         
+        if args.check:
+            sys.exit(check_tokenizers(source_code, args.file))
+        
         lexer = FluxLexer(source_code)
         
         try:
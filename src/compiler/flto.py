@@ -0,0 +1,254 @@
+"""
+Flux Link-Time Optimization
+
+libfx is the standard library compiled once into a single bitcode file,
+with the interfaces programs compile against stored next to it. An --lto
+build lowers only the program's own modules, links them and libfx into
+one LLVM module in memory, internalizes every definition except main and
+then optimizes the whole program at once: stdlib helpers inline across
+module boundaries and whatever the program never calls is deleted.
+
+libfx lives in ~/.flux/libfx/<compiler version>-<triple>/ (FLUX_LIB_DIR
+moves it) and is rebuilt on demand when a stdlib source changes. Modules
+that do not compile yet are left out of the library and reported; a
+program importing one lowers it itself.
+"""
+
+import io
+import os
+import json
+import pickle
+import hashlib
+import contextlib
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Dict, List, Optional
+
+from llvmlite import binding as llvm
+from fast import *
+from fparser import FluxParser
+from flexer import FluxLexer
+from fcache import compiler_version
+from fbuild import ModuleUnit, artifact_stem, load_unit, lower_unit
+import freport
+
+LIBRARY_NAME = "libfx"
+
+# libfx is stored after this much optimization; the whole-program
+# pipeline runs again after linking
+LIBRARY_OPT_LEVEL = 1
+
+def stdlib_dir() -> Path:
+    return Path(__file__).resolve().parent.parent / "stdlib"
+
+def default_library_root() -> Path:
+    return Path(os.environ.get("FLUX_LIB_DIR", Path.home() / ".flux" / LIBRARY_NAME))
+
+def stdlib_sources() -> Dict[str, str]:
+    """Resolved path -> source hash of every stdlib module"""
+    return {str(path.resolve()): hashlib.sha256(path.read_bytes()).hexdigest()
+            for path in sorted(stdlib_dir().glob("*.fx"))}
+
+@dataclass
+class Library:
+    directory: Path
+    modules: Dict[str, dict]                             # Resolved path -> source hash and imports
+    skipped: Dict[str, str] = field(default_factory=dict)  # Resolved path -> why it is not in the library
+
+    @property
+    def bitcode_path(self) -> Path:
+        return self.directory / f"{LIBRARY_NAME}.bc"
+
+    @property
+    def manifest_path(self) -> Path:
+        return self.directory / f"{LIBRARY_NAME}.json"
+
+    def provides(self, key: str, source_hash: str) -> bool:
+        return key in self.modules and self.modules[key]['source_hash'] == source_hash
+
+    def unit(self, key: str, source: str, source_hash: str) -> ModuleUnit:
+        """A library module as its stored interface, without parsing it"""
+        data = (self.directory / f"{artifact_stem(Path(key))}.fxi").read_bytes()
+        return ModuleUnit(Path(key), source, source_hash, self.modules[key]['dependencies'],
+                          hashlib.sha256(data).hexdigest(), pickle.loads(data))
+
+    def report(self) -> str:
+        lines = [f"{LIBRARY_NAME}: {len(self.modules)} modules in {self.bitcode_path}"]
+        for key, reason in sorted(self.skipped.items()):
+            lines.append(f"  skipped {Path(key).name}: {reason}")
+        return "\n".join(lines)
+
+def library_dir(triple: str, root: Optional[Path] = None) -> Path:
+    return (root or default_library_root()) / f"{compiler_version()}-{triple}"
+
+def load_library(triple: str, root: Optional[Path] = None) -> Optional[Library]:
+    """The built library for this compiler and target, or None when missing or out of date"""
+    directory = library_dir(triple, root)
+    try:
+        with open(directory / f"{LIBRARY_NAME}.json", 'r') as f:
+            manifest = json.load(f)
+    except (OSError, ValueError):
+        return None
+    library = Library(directory, manifest.get('modules', {}), manifest.get('skipped', {}))
+    if manifest.get('sources') != stdlib_sources() or not library.bitcode_path.exists():
+        return None
+    return library
+
+# ============ LIBRARY BUILD ============
+
+def _parse_errors(unit: ModuleUnit) -> Optional[str]:
+    """First parse error of unit"""
+    parser = FluxParser(FluxLexer(unit.source).iter_tokens())
+    parser.parse()
+    return str(parser.errors[0]) if parser.errors else None
+
+def build_library(triple: str, root: Optional[Path] = None) -> Library:
+    """Compile every stdlib module that compiles into one bitcode file"""
+    from fbackend import FluxBackend
+    directory = library_dir(triple, root)
+    directory.mkdir(parents=True, exist_ok=True)
+    sources = stdlib_sources()
+    library = Library(directory, {})
+
+    units: Dict[str, ModuleUnit] = {}
+    for key in sources:
+        # Unfinished modules are expected; their parse errors go to the report, not the terminal
+        with contextlib.redirect_stderr(io.StringIO()):
+            try:
+                unit = load_unit(Path(key), None, directory)
+                error = _parse_errors(unit)
+            except Exception as e:
+                library.skipped[key] = str(e)
+                continue
+        if error:
+            library.skipped[key] = error
+        units[key] = unit
+
+    backend = FluxBackend(triple, LIBRARY_OPT_LEVEL)
+    linked = None
+    for key, unit in units.items():
+        if key in library.skipped:
+            continue
+        deps = _transitive(unit, units, library)
+        if deps is None:
+            library.skipped[key] = "imports a module that is not in the library"
+            continue
+        try:
+            module = lower_unit(unit, [dep.interface for dep in deps], triple)
+            entry = module.globals.get('main')
+            if isinstance(entry, ir.Function) and entry.blocks:
+                library.skipped[key] = "defines main"
+                continue
+            llvm_module = backend.optimize(backend.parse(module))
+        except Exception as e:
+            library.skipped[key] = str(e).splitlines()[0] if str(e) else type(e).__name__
+            continue
+        if linked is None:
+            linked = llvm_module
+        else:
+            linked.link_in(llvm_module)
+        library.modules[key] = {'source_hash': unit.source_hash, 'dependencies': unit.dependencies}
+
+    if linked is None:
+        linked = llvm.parse_assembly("")
+        linked.triple = triple
+    library.bitcode_path.write_bytes(linked.as_bitcode())
+    with open(library.manifest_path, 'w') as f:
+        json.dump({'compiler': compiler_version(), 'triple': triple, 'sources': sources,
+                   'modules': library.modules, 'skipped': library.skipped}, f, indent=2, sort_keys=True)
+    return library
+
+def _transitive(unit: ModuleUnit, units: Dict[str, ModuleUnit], library: Library) -> Optional[List[ModuleUnit]]:
+    """unit's imports, dependencies first; None if one of them cannot be in the library"""
+    seen = {unit.key}
+    result = []
+    def visit(u: ModuleUnit) -> bool:
+        for dep in u.dependencies:
+            if dep in seen:
+                continue
+            seen.add(dep)
+            if dep not in units or dep in library.skipped or not visit(units[dep]):
+                return False
+            result.append(units[dep])
+        return True
+    return result if visit(unit) else None
+
+def ensure_library(triple: str, root: Optional[Path] = None) -> Library:
+    library = load_library(triple, root)
+    if library is None:
+        with freport.phase(f"build {LIBRARY_NAME}"):
+            library = build_library(triple, root)
+        print(library.report())
+    return library
+
+# ============ WHOLE-PROGRAM LINK ============
+
+def internalize(llvm_module: llvm.ModuleRef, keep: set) -> None:
+    """Give every definition but those in keep internal linkage, so unused ones can go"""
+    for value in list(llvm_module.functions) + list(llvm_module.global_variables):
+        # llvm.global_ctors and friends are appending arrays the linker reads by name
+        if not value.is_declaration and value.name not in keep and not value.name.startswith('llvm.'):
+            value.linkage = llvm.Linkage.internal
+
+def link_program(entry: Path, triple: str, opt_level: int, build_dir: Path,
+                 root: Optional[Path] = None, instrument: bool = False, profile=None,
+                 options: CodegenOptions = None) -> llvm.ModuleRef:
+    """
+    Lower the program's own modules, link them with libfx and optimize the
+    result as one module. Profiling, debug info and the other codegen
+    options apply to the program's modules; libfx is built without them.
+    """
+    from fbackend import FluxBackend
+    library = ensure_library(triple, root)
+    build_dir.mkdir(exist_ok=True)
+
+    # The program's import graph; library modules contribute only their interface
+    units: Dict[str, ModuleUnit] = {}
+    order: List[str] = []
+    def discover(key: str) -> None:
+        if key in units:
+            return
+        source = Path(key).read_text(encoding='utf-8')
+        source_hash = hashlib.sha256(source.encode('utf-8')).hexdigest()
+        provided = library.provides(key, source_hash)
+        unit = library.unit(key, source, source_hash) if provided else load_unit(Path(key), None, build_dir)
+        units[key] = unit
+        for dep in unit.dependencies:
+            discover(dep)
+        if not provided:
+            order.append(key)
+    discover(str(Path(entry).resolve()))
+
+    # No one-module-at-a-time optimization: the pipeline runs once after the link
+    backend = FluxBackend(triple, 0)
+    linked = llvm.parse_bitcode(library.bitcode_path.read_bytes())
+    with freport.phase("lower modules"):
+        for key in order:
+            deps = _transitive_dependencies(units[key], units)
+            module = lower_unit(units[key], [dep.interface for dep in deps], triple, instrument, profile,
+                                options, opt_level > 0)
+            linked.link_in(backend.parse(module))
+    freport.count("modules lowered", len(order))
+    freport.count("library modules", len(units) - len(order))
+
+    internalize(linked, {'main'})
+    linked.verify()
+    with freport.phase("optimize"):
+        FluxBackend(triple, opt_level).optimize(linked)
+    # Drop unreferenced definitions even at -O0, where the pipeline does nothing
+    dce = llvm.create_module_pass_manager()
+    dce.add_global_dce_pass()
+    dce.run(linked)
+    return linked
+
+def _transitive_dependencies(unit: ModuleUnit, units: Dict[str, ModuleUnit]) -> List[ModuleUnit]:
+    seen = {unit.key}
+    result = []
+    def visit(u: ModuleUnit) -> None:
+        for dep in u.dependencies:
+            if dep not in seen and dep in units:
+                seen.add(dep)
+                visit(units[dep])
+                result.append(units[dep])
+    visit(unit)
+    return result
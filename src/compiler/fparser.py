@@ -12,8 +12,9 @@ Usage:
 """
 
 import sys
-from typing import List, Optional, Union, Any
-from flexer import FluxLexer, TokenType, Token
+import functools
+from typing import Iterable, List, Optional, Union, Any
+from flexer import FluxLexer, TokenType, Token, TokenStream
 from fast import *
 
 class ParseError(Exception):
@@ -23,11 +24,69 @@ class ParseError(Exception):
         self.token = token
         super().__init__(f"Parse error: {message}" + (f" at {token.line}:{token.column}" if token else ""))
 
+# Binary operators by token, as (precedence, operator). Higher binds tighter;
+# every level is left-associative unless listed in RIGHT_ASSOCIATIVE.
+BINARY_OPERATORS = {
+    TokenType.OR:            (1, Operator.OR),
+    TokenType.AND:           (2, Operator.AND),
+    TokenType.XOR:           (3, Operator.XOR),
+    TokenType.EQUAL:         (4, Operator.EQUAL),
+    TokenType.NOT_EQUAL:     (4, Operator.NOT_EQUAL),
+    TokenType.LESS_THAN:     (5, Operator.LESS_THAN),
+    TokenType.LESS_EQUAL:    (5, Operator.LESS_EQUAL),
+    TokenType.GREATER_THAN:  (5, Operator.GREATER_THAN),
+    TokenType.GREATER_EQUAL: (5, Operator.GREATER_EQUAL),
+    TokenType.RANGE:         (6, Operator.RANGE),
+    TokenType.LEFT_SHIFT:    (7, Operator.BITSHIFT_LEFT),
+    TokenType.RIGHT_SHIFT:   (7, Operator.BITSHIFT_RIGHT),
+    TokenType.PLUS:          (8, Operator.ADD),
+    TokenType.MINUS:         (8, Operator.SUB),
+    TokenType.MULTIPLY:      (9, Operator.MUL),
+    TokenType.DIVIDE:        (9, Operator.DIV),
+    TokenType.MODULO:        (9, Operator.MOD),
+    TokenType.POWER:         (10, Operator.POWER),
+}
+
+# Operators spelled as words that are not reserved keywords (x rotl 2)
+WORD_OPERATORS = {
+    'rotl': (7, Operator.ROTATE_LEFT),
+    'rotr': (7, Operator.ROTATE_RIGHT),
+}
+
+# Optimizer hints accepted between a for loop's header and its body
+LOOP_HINTS = ('unroll', 'vectorize')
+
+# Layout controls accepted between a struct's name and its body
+STRUCT_ATTRIBUTES = ('align', 'reorder')
+
+# Optimizer hints accepted between a function's return type and its body
+FUNCTION_ATTRIBUTES = ('inline', 'noinline', 'cold', 'hot')
+
+RIGHT_ASSOCIATIVE = {Operator.POWER}
+
+PREFIX_TOKENS = {
+    TokenType.NOT, TokenType.BITWISE_NOT, TokenType.MINUS, TokenType.PLUS, TokenType.MULTIPLY,
+    TokenType.ADDRESS_OF, TokenType.INCREMENT, TokenType.DECREMENT,
+}
+
+def located(parse_rule):
+    """Tag the node a rule returns with the line and column of its first token"""
+    @functools.wraps(parse_rule)
+    def rule(self, *args):
+        token = self.current_token
+        node = parse_rule(self, *args)
+        if isinstance(node, ASTNode) and token is not None:
+            node.line, node.column = token.line, token.column
+        return node
+    return rule
+
 class FluxParser:
-    def __init__(self, tokens: List[Token]):
-        self.tokens = tokens
+    def __init__(self, tokens: Iterable[Token]):
+        """tokens may be a list or a lazy source such as FluxLexer.iter_tokens()"""
+        self.tokens = TokenStream(tokens)
         self.position = 0
-        self.current_token = self.tokens[0] if tokens else None
+        self.current_token = self.tokens.get(0)
+        self.errors = []
     
     def error(self, message: str) -> None:
         """Raise a parse error with current token context"""
@@ -35,17 +94,32 @@ class FluxParser:
     
     def advance(self) -> Token:
         """Move to the next token"""
-        if self.position < len(self.tokens) - 1:
+        next_token = self.tokens.get(self.position + 1)
+        if next_token is not None:
             self.position += 1
-            self.current_token = self.tokens[self.position]
+            self.current_token = next_token
+            # Keep the previous token for synchronize()
+            self.tokens.discard_before(self.position - 1)
         return self.current_token
     
     def peek(self, offset: int = 1) -> Optional[Token]:
         """Look ahead at the next token without consuming it"""
-        pos = self.position + offset
-        if pos < len(self.tokens):
-            return self.tokens[pos]
-        return None
+        return self.tokens.get(self.position + offset)
+    
+    def mark(self) -> int:
+        """Save the position for a speculative parse; pair with reset() or release()"""
+        self.tokens.mark(self.position)
+        return self.position
+    
+    def reset(self, saved_pos: int) -> None:
+        """Backtrack to a position returned by mark()"""
+        self.tokens.release(saved_pos)
+        self.position = saved_pos
+        self.current_token = self.tokens.get(saved_pos)
+    
+    def release(self, saved_pos: int) -> None:
+        """Keep the speculative parse since mark()"""
+        self.tokens.release(saved_pos)
     
     def expect(self, *token_types: TokenType) -> bool:
         """Check if current token matches any of the given types"""
@@ -66,7 +140,7 @@ class FluxParser:
         """Synchronize parser state after an error"""
         self.advance()
         while not self.expect(TokenType.EOF):
-            if self.tokens[self.position - 1].type == TokenType.SEMICOLON:
+            if self.tokens.get(self.position - 1).type == TokenType.SEMICOLON:
                 return
             if self.expect(TokenType.DEF, TokenType.STRUCT, TokenType.OBJECT, 
                          TokenType.NAMESPACE, TokenType.IF, TokenType.WHILE,
@@ -90,9 +164,11 @@ class FluxParser:
                     statements.append(stmt)
             except ParseError as e:
                 print(f"Parse error: {e}", file=sys.stderr)
+                self.errors.append(e)
                 self.synchronize()
         return Program(statements)
     
+    @located
     def statement(self) -> Optional[Statement]:
         """
         statement -> import_statement
@@ -100,6 +176,7 @@ class FluxParser:
                   | struct_def
                   | object_def_statement
                   | namespace_def
+                  | compt_block
                   | custom_type_statement
                   | variable_declaration ';'
                   | expression_statement
@@ -120,6 +197,8 @@ class FluxParser:
             return self.object_def()
         elif self.expect(TokenType.NAMESPACE):
             return self.namespace_def()
+        elif self.expect(TokenType.COMPT):
+            return self.compt_block()
         elif self.expect(TokenType.IF):
             return self.if_statement()
         elif self.expect(TokenType.WHILE):
@@ -150,14 +229,8 @@ class FluxParser:
             return self.variable_declaration_statement()
         elif self.expect(TokenType.SIGNED):
             return self.variable_declaration_statement()
-        elif self.expect(TokenType.CONST):
-            self.advance()
-            if self.expect(TokenType.VOLATILE):
-                self.advance()
-                if self.expect(TokenType.DEF):
-                    return self.function_def()
-                else:
-                    return self.variable_declaration_statement()
+        elif self.expect(TokenType.CONST, TokenType.VOLATILE) and self.is_function_def():
+            return self.function_def()
         elif self.expect(TokenType.SEMICOLON):
             self.advance()
             return None
@@ -198,10 +271,11 @@ class FluxParser:
         self.consume(TokenType.SEMICOLON)
         return UsingStatement(namespace_path)
     
+    @located
     def function_def(self) -> FunctionDef:
         """
-        function_def -> ('const')? ('volatile')? 'def' IDENTIFIER '(' parameter_list? ')' '->' type_spec ';'
-        function_def -> ('const')? ('volatile')? 'def' IDENTIFIER '(' parameter_list? ')' '->' type_spec block ';'
+        function_def -> ('const')? ('volatile')? 'def' IDENTIFIER '(' parameter_list? ')' '->' type_spec function_attributes ';'
+        function_def -> ('const')? ('volatile')? 'def' IDENTIFIER '(' parameter_list? ')' '->' type_spec function_attributes block ';'
         """
         is_const = False
         is_volatile = False
@@ -223,6 +297,7 @@ class FluxParser:
         
         self.consume(TokenType.RETURN_ARROW)
         return_type = self.type_spec()
+        attributes = self.function_attributes()
         
         # Check if this is a prototype (ends with semicolon) or definition (has block)
         is_prototype = False
@@ -235,7 +310,30 @@ class FluxParser:
             body = self.block()
             self.consume(TokenType.SEMICOLON)
         
-        return FunctionDef(name, parameters, return_type, body, is_const, is_volatile, is_prototype)
+        return FunctionDef(name, parameters, return_type, body, is_const, is_volatile, is_prototype, attributes)
+    
+    def is_function_def(self) -> bool:
+        """('const')? ('volatile')? 'def' ahead"""
+        offset = 0
+        for qualifier in (TokenType.CONST, TokenType.VOLATILE):
+            token = self.peek(offset)
+            if token is not None and token.type == qualifier:
+                offset += 1
+        token = self.peek(offset)
+        return token is not None and token.type == TokenType.DEF
+    
+    def function_attributes(self) -> dict:
+        """
+        function_attributes -> ('inline' | 'noinline' | 'cold' | 'hot')*
+        """
+        attributes = {}
+        while self.expect(TokenType.IDENTIFIER) and self.current_token.value in FUNCTION_ATTRIBUTES:
+            attributes[self.current_token.value] = 1
+            self.advance()
+        for a, b in (('inline', 'noinline'), ('hot', 'cold')):
+            if a in attributes and b in attributes:
+                self.error(f"A function cannot be both {a} and {b}")
+        return attributes
     
     def parameter_list(self) -> List[Parameter]:
         """
@@ -297,10 +395,11 @@ class FluxParser:
     
     def struct_def(self) -> StructDef:
         """
-        struct_def -> 'struct' IDENTIFIER'{' struct_member* '}'
+        struct_def -> 'struct' IDENTIFIER struct_attributes '{' struct_member* '}'
         """
         self.consume(TokenType.STRUCT)
         name = self.consume(TokenType.IDENTIFIER).value
+        attributes = self.struct_attributes()
         
         base_structs = []
         members = []
@@ -356,7 +455,23 @@ class FluxParser:
         # Make semicolon optional after struct definition
         if self.expect(TokenType.SEMICOLON):
             self.advance()
-        return StructDef(name, members, base_structs, nested_structs)
+        return StructDef(name, members, base_structs, nested_structs, attributes)
+    
+    def struct_attributes(self) -> dict:
+        """
+        struct_attributes -> ('align' '(' INTEGER ')' | 'reorder')*
+        """
+        attributes = {}
+        while self.expect(TokenType.IDENTIFIER) and self.current_token.value in STRUCT_ATTRIBUTES:
+            name = self.current_token.value
+            self.advance()
+            if name == 'reorder':
+                attributes[name] = 1
+            else:
+                self.consume(TokenType.LEFT_PAREN)
+                attributes[name] = int(self.consume(TokenType.INTEGER).value, 0)
+                self.consume(TokenType.RIGHT_PAREN)
+        return attributes
     
     def struct_member(self) -> StructMember:
         """
@@ -419,7 +534,7 @@ class FluxParser:
                 self.consume(TokenType.LEFT_BRACE)
                 
                 while not self.expect(TokenType.RIGHT_BRACE):
-                    if self.expect(TokenType.DEF):
+                    if self.is_function_def():
                         method = self.function_def()
                         method.is_private = is_private
                         methods.append(method)
@@ -444,7 +559,7 @@ class FluxParser:
                 self.consume(TokenType.SEMICOLON)
             else:
                 # Regular member (defaults to public)
-                if self.expect(TokenType.DEF):
+                if self.is_function_def():
                     method = self.function_def()
                     methods.append(method)
                 elif self.expect(TokenType.OBJECT):
@@ -495,7 +610,7 @@ class FluxParser:
         self.consume(TokenType.LEFT_BRACE)
         
         while not self.expect(TokenType.RIGHT_BRACE):
-            if self.expect(TokenType.DEF):
+            if self.is_function_def():
                 functions.append(self.function_def())
             elif self.expect(TokenType.STRUCT):
                 structs.append(self.struct_def())
@@ -514,9 +629,19 @@ class FluxParser:
         self.consume(TokenType.SEMICOLON)
         return NamespaceDef(name, functions, structs, objects, variables, nested_namespaces, base_namespaces)
     
+    def compt_block(self) -> ComptBlock:
+        """
+        compt_block -> 'compt' block ';'
+        """
+        self.consume(TokenType.COMPT)
+        body = self.block()
+        self.consume(TokenType.SEMICOLON)
+        return ComptBlock(body)
+
     def type_spec(self) -> TypeSpec:
         """
-        type_spec -> ('const')? ('volatile')? ('signed'|'unsigned')? base_type alignment? array_spec? pointer_spec?
+        type_spec -> ('const')? ('volatile')? ('signed'|'unsigned')? base_type alignment? vector_spec? array_spec? pointer_spec?
+        vector_spec -> '<' INTEGER '>'
         """
         is_const = False
         is_volatile = False
@@ -542,20 +667,40 @@ class FluxParser:
         # Base type
         base_type = self.base_type()
         
-        # Bit width and alignment for data types
+        # Bit width, alignment and endianness for data types: data{bits:align:endian}
         bit_width = None
         alignment = None
+        endianness = None
         
         if base_type == DataType.DATA and self.expect(TokenType.LEFT_BRACE):
             self.advance()
             bit_width = int(self.consume(TokenType.INTEGER).value, 0)
             
-            if self.expect(TokenType.COLON):
+            # The alignment may be left empty, data{24::0} lexes as 24 '::' 0
+            if self.expect(TokenType.SCOPE):
+                self.advance()
+                endianness = int(self.consume(TokenType.INTEGER).value, 0)
+            elif self.expect(TokenType.COLON):
                 self.advance()
-                alignment = int(self.consume(TokenType.INTEGER).value, 0)
+                if self.expect(TokenType.INTEGER):
+                    alignment = int(self.consume(TokenType.INTEGER).value, 0)
+                if self.expect(TokenType.COLON):
+                    self.advance()
+                    endianness = int(self.consume(TokenType.INTEGER).value, 0)
+            if endianness not in (None, 0, 1):
+                self.error("Endianness must be 0 (little) or 1 (big)")
             
             self.consume(TokenType.RIGHT_BRACE)
         
+        # Vector lanes: uint32<4>
+        vector_lanes = None
+        if self.is_vector_spec():
+            self.advance()
+            vector_lanes = int(self.consume(TokenType.INTEGER).value, 0)
+            self.consume(TokenType.GREATER_THAN)
+            if vector_lanes < 1:
+                self.error("A vector needs at least one lane")
+        
         # Array specification
         is_array = False
         array_size = None
@@ -574,9 +719,17 @@ class FluxParser:
             self.advance()
         
         return TypeSpec(base_type, is_signed, is_const, is_volatile, 
-                       bit_width, alignment, is_array, array_size, is_pointer)
+                       bit_width, alignment, is_array, array_size, is_pointer, endianness, vector_lanes)
     
-    def base_type(self) -> DataType:
+    def is_vector_spec(self) -> bool:
+        """'<' INTEGER '>' after a base type"""
+        if not self.expect(TokenType.LESS_THAN):
+            return False
+        lanes, close = self.peek(1), self.peek(2)
+        return (lanes is not None and lanes.type == TokenType.INTEGER
+                and close is not None and close.type == TokenType.GREATER_THAN)
+    
+    def base_type(self) -> Union[DataType, str]:
         """
         base_type -> 'int' | 'float' | 'char' | 'bool' | 'data' | 'void' | IDENTIFIER
         """
@@ -627,15 +780,16 @@ class FluxParser:
             self.advance()
             return DataType.INT64
         elif self.expect(TokenType.IDENTIFIER):
-            # Custom type - for now treat as DATA
+            # Custom type, resolved by name during codegen
+            name = self.current_token.value
             self.advance()
-            return DataType.DATA
+            return name
         else:
             self.error("Expected type specifier")
     
     def is_variable_declaration(self) -> bool:
         """Check if current position starts a variable declaration"""
-        saved_pos = self.position
+        saved_pos = self.mark()
         try:
             # Skip type specifiers
             if self.expect(TokenType.CONST):
@@ -653,6 +807,7 @@ class FluxParser:
                              TokenType.INT16, TokenType.INT32, TokenType.INT64):
                 return False
             
+            base_token = self.current_token
             self.advance()
             
             # Skip data type specification
@@ -667,10 +822,16 @@ class FluxParser:
                 if self.expect(TokenType.RIGHT_BRACE):
                     self.advance()
             
+            # Skip vector lanes
+            if self.is_vector_spec():
+                for _ in range(3):
+                    self.advance()
+            
             # Skip array specification
             if self.expect(TokenType.LEFT_BRACKET):
                 self.advance()
-                if self.expect(TokenType.INTEGER):
+                # The size, so that table[i] = x still reads as an element access below
+                if self.expect(TokenType.INTEGER, TokenType.IDENTIFIER):
                     self.advance()
                 if self.expect(TokenType.RIGHT_BRACKET):
                     self.advance()
@@ -679,11 +840,15 @@ class FluxParser:
             if self.expect(TokenType.MULTIPLY):
                 self.advance()
             
+            # `x rotl 2` is an expression, not a declaration of a variable named rotl
+            if (base_token.type == TokenType.IDENTIFIER and self.expect(TokenType.IDENTIFIER)
+                    and self.current_token.value in WORD_OPERATORS):
+                return False
+            
             # Must have identifier or 'as' keyword
             return self.expect(TokenType.IDENTIFIER, TokenType.AS)
         finally:
-            self.position = saved_pos
-            self.current_token = self.tokens[self.position] if self.position < len(self.tokens) else None
+            self.reset(saved_pos)
     
     def variable_declaration_statement(self) -> Statement:
         """
@@ -696,6 +861,7 @@ class FluxParser:
     def variable_declaration(self) -> Union[VariableDeclaration, TypeDeclaration]:
         """
         variable_declaration -> type_spec IDENTIFIER ('=' expression)?
+                             | type_spec IDENTIFIER '(' argument_list? ')'
                              | type_spec 'as' IDENTIFIER ('=' expression)?
         """
         type_spec = self.type_spec()
@@ -722,6 +888,15 @@ class FluxParser:
                 self.advance()
                 names.append(self.consume(TokenType.IDENTIFIER).value)
             
+            # Object instance: the arguments go to its __init
+            if len(names) == 1 and self.expect(TokenType.LEFT_PAREN):
+                self.advance()
+                arguments = []
+                if not self.expect(TokenType.RIGHT_PAREN):
+                    arguments = self.argument_list()
+                self.consume(TokenType.RIGHT_PAREN)
+                return VariableDeclaration(name, type_spec, arguments=arguments)
+            
             # Optional initial value (only for last variable)
             initial_value = None
             if self.expect(TokenType.ASSIGN):
@@ -833,13 +1008,13 @@ class FluxParser:
     
     def for_statement(self) -> Union[ForLoop, ForInLoop]:
         """
-        for_statement -> 'for' '(' (for_in_loop | for_c_loop) ')' block ';'
+        for_statement -> 'for' '(' (for_in_loop | for_c_loop) ')' loop_hints block ';'
         """
         self.consume(TokenType.FOR)
         self.consume(TokenType.LEFT_PAREN)
         
         # Check if it's a for-in loop by looking ahead
-        saved_pos = self.position
+        saved_pos = self.mark()
         is_for_in = False
         
         # Look for pattern: identifier (',' identifier)* 'in' expression
@@ -855,8 +1030,7 @@ class FluxParser:
                 is_for_in = True
         
         # Restore position
-        self.position = saved_pos
-        self.current_token = self.tokens[self.position]
+        self.reset(saved_pos)
         
         if is_for_in:
             # for-in loop
@@ -870,16 +1044,18 @@ class FluxParser:
             self.consume(TokenType.IN)
             iterable = self.expression()
             self.consume(TokenType.RIGHT_PAREN)
+            hints = self.loop_hints()
             body = self.block()
             self.consume(TokenType.SEMICOLON)
             
-            return ForInLoop(variables, iterable, body)
+            return ForInLoop(variables, iterable, body, hints)
         else:
             # C-style for loop
             init = None
             if not self.expect(TokenType.SEMICOLON):
                 if self.is_variable_declaration():
                     init = ExpressionStatement(self.variable_declaration())
+                    self.consume(TokenType.SEMICOLON)
                 else:
                     init = self.expression_statement()
             else:
@@ -892,13 +1068,27 @@ class FluxParser:
             
             update = None
             if not self.expect(TokenType.RIGHT_PAREN):
-                update = self.expression_statement()
+                update = ExpressionStatement(self.expression())
             
             self.consume(TokenType.RIGHT_PAREN)
+            hints = self.loop_hints()
             body = self.block()
             self.consume(TokenType.SEMICOLON)
             
-            return ForLoop(init, condition, update, body)
+            return ForLoop(init, condition, update, body, hints)
+    
+    def loop_hints(self) -> dict:
+        """
+        loop_hints -> (('unroll' | 'vectorize') '(' INTEGER ')')*
+        """
+        hints = {}
+        while self.expect(TokenType.IDENTIFIER) and self.current_token.value in LOOP_HINTS:
+            name = self.current_token.value
+            self.advance()
+            self.consume(TokenType.LEFT_PAREN)
+            hints[name] = int(self.consume(TokenType.INTEGER).value, 0)
+            self.consume(TokenType.RIGHT_PAREN)
+        return hints
     
     def switch_statement(self) -> SwitchStatement:
         """
@@ -1038,9 +1228,9 @@ class FluxParser:
     
     def assignment_expression(self) -> Expression:
         """
-        assignment_expression -> logical_or_expression ('=' assignment_expression)?
+        assignment_expression -> binary_expression ('=' assignment_expression)?
         """
-        expr = self.logical_or_expression()
+        expr = self.binary_expression()
         
         if self.expect(TokenType.ASSIGN):
             self.advance()
@@ -1049,179 +1239,81 @@ class FluxParser:
         
         return expr
     
-    def logical_or_expression(self) -> Expression:
-        """
-        logical_or_expression -> logical_and_expression ('or' logical_and_expression)*
-        """
-        expr = self.logical_and_expression()
-        
-        while self.expect(TokenType.OR):
-            operator = Operator.OR
-            self.advance()
-            right = self.logical_and_expression()
-            expr = BinaryOp(expr, operator, right)
-        
-        return expr
-    
-    def logical_and_expression(self) -> Expression:
-        """
-        logical_and_expression -> logical_xor_expression ('and' equality_expression)*
+    def binary_expression(self, min_precedence: int = 1) -> Expression:
         """
-        expr = self.logical_xor_expression()
-        
-        while self.expect(TokenType.AND):
-            operator = Operator.AND
-            self.advance()
-            right = self.logical_xor_expression()
-            expr = BinaryOp(expr, operator, right)
-        
-        return expr
-
-    def logical_xor_expression(self) -> Expression:
-        """
-        logical_xor_expression -> equality_expression ('xor' equality_expression)*
-        """
-        expr = self.equality_expression()
-
-        while (self.expect(TokenType.XOR)):
-            operator = Operator.XOR
-            self.advance()
-            right = self.equality_expression()
-            expr = BianryOp(expr, operator, right)
+        binary_expression -> cast_expression (binary_operator cast_expression)*
 
-        return expr
-    
-    def equality_expression(self) -> Expression:
-        """
-        equality_expression -> relational_expression (('==' | '!=') relational_expression)*
-        """
-        expr = self.relational_expression()
-        
-        while self.expect(TokenType.EQUAL, TokenType.NOT_EQUAL):
-            if self.current_token.type == TokenType.EQUAL:
-                operator = Operator.EQUAL
-            elif self.current_token.type == TokenType.NOT_EQUAL:
-                operator = Operator.NOT_EQUAL
-            
-            self.advance()
-            right = self.relational_expression()
-            expr = BinaryOp(expr, operator, right)
-        
-        return expr
-    
-    def relational_expression(self) -> Expression:
-        """
-        relational_expression -> shift_expression (('<' | '<=' | '>' | '>=') shift_expression)*
-        """
-        expr = self.shift_expression()
-        
-        while self.expect(TokenType.LESS_EQUAL, TokenType.LESS_THAN, TokenType.LESS_EQUAL, TokenType.GREATER_THAN, TokenType.GREATER_EQUAL):
-            if self.current_token.type == TokenType.LESS_EQUAL:
-                operator = Operator.LESS_EQUAL, TokenType.LESS_THAN
-            elif self.current_token.type == TokenType.LESS_EQUAL:
-                operator = Operator.LESS_EQUAL
-            elif self.current_token.type == TokenType.GREATER_THAN:
-                operator = Operator.GREATER_THAN
-            else:  # GE
-                operator = Operator.GREATER_EQUAL
-            
-            self.advance()
-            right = self.shift_expression()
-            expr = BinaryOp(expr, operator, right)
-        
-        return expr
-    
-    def shift_expression(self) -> Expression:
-        """
-        shift_expression -> additive_expression (('<<' | '>>') additive_expression)*
-        """
-        expr = self.additive_expression()
-        
-        while self.expect(TokenType.LESS_EQUAL, TokenType.LEFT_SHIFT, TokenType.RIGHT_SHIFT):
-            if self.current_token.type == TokenType.LESS_EQUAL:
-                operator = Operator.BITSHIFT_LEFT
-            else:  # RIGHT_SHIFT
-                operator = Operator.BITSHIFT_RIGHT
-            
-            self.advance()
-            right = self.additive_expression()
-            expr = BinaryOp(expr, operator, right)
-        
-        return expr
-    
-    def additive_expression(self) -> Expression:
-        """
-        additive_expression -> multiplicative_expression (('+' | '-') multiplicative_expression)*
-        """
-        expr = self.multiplicative_expression()
-        
-        while self.expect(TokenType.PLUS, TokenType.MINUS):
-            if self.current_token.type == TokenType.PLUS:
-                operator = Operator.ADD
-            else:  # MINUS
-                operator = Operator.SUB
-            
-            self.advance()
-            right = self.multiplicative_expression()
-            expr = BinaryOp(expr, operator, right)
-        
-        return expr
-    
-    def multiplicative_expression(self) -> Expression:
-        """
-        multiplicative_expression -> cast_expression (('*' | '/' | '%') cast_expression)*
+        Precedence climbing over BINARY_OPERATORS: an operand is parsed once
+        and operators bind to it by precedence, instead of descending
+        through one method per level for every leaf.
         """
         expr = self.cast_expression()
         
-        while self.expect(TokenType.MULTIPLY, TokenType.DIVIDE, TokenType.MODULO):
-            if self.current_token.type == TokenType.MULTIPLY:
-                operator = Operator.MUL
-            elif self.current_token.type == TokenType.DIVIDE:
-                operator = Operator.DIV
-            else:  # MODULO
-                operator = Operator.MOD
-            
+        while True:
+            entry = self.binary_operator()
+            if entry is None or entry[0] < min_precedence:
+                break
+            precedence, operator = entry
             self.advance()
-            right = self.cast_expression()
-            expr = BinaryOp(expr, operator, right)
+            next_precedence = precedence if operator in RIGHT_ASSOCIATIVE else precedence + 1
+            right = self.binary_expression(next_precedence)
+            if operator == Operator.RANGE:
+                expr = RangeExpression(expr, right)
+            else:
+                expr = BinaryOp(expr, operator, right)
         
         return expr
     
+    def binary_operator(self) -> Optional[tuple]:
+        """Return (precedence, operator) if the current token is a binary operator"""
+        token = self.current_token
+        if token is None:
+            return None
+        entry = BINARY_OPERATORS.get(token.type)
+        if entry is None and token.type == TokenType.IDENTIFIER:
+            entry = WORD_OPERATORS.get(token.value)
+        return entry
+    
     def cast_expression(self) -> Expression:
         """
         cast_expression -> ('(' type_spec ')')? unary_expression
         """
         if self.expect(TokenType.LEFT_PAREN):
             # Look ahead to see if this is a cast
-            saved_pos = self.position
+            saved_pos = self.mark()
             try:
                 self.advance()  # consume '('
                 target_type = self.type_spec()
                 if self.expect(TokenType.RIGHT_PAREN):
                     self.advance()  # consume ')'
                     expr = self.unary_expression()
+                    self.release(saved_pos)
                     return CastExpression(target_type, expr)
                 else:
                     # Not a cast, restore position
-                    self.position = saved_pos
-                    self.current_token = self.tokens[self.position]
+                    self.reset(saved_pos)
             except:
                 # Not a cast, restore position
-                self.position = saved_pos
-                self.current_token = self.tokens[self.position]
+                self.reset(saved_pos)
         
         return self.unary_expression()
     
     def unary_expression(self) -> Expression:
         """
-        unary_expression -> ('not' | '-' | '+' | '*' | '@' | '++' | '--') unary_expression
+        unary_expression -> ('not' | '~' | '-' | '+' | '*' | '@' | '++' | '--') unary_expression
                          | postfix_expression
         """
+        if self.current_token is None or self.current_token.type not in PREFIX_TOKENS:
+            return self.postfix_expression()
         if self.expect(TokenType.NOT):
             operator = Operator.NOT
             self.advance()
             operand = self.unary_expression()
             return UnaryOp(operator, operand)
+        elif self.expect(TokenType.BITWISE_NOT):
+            self.advance()
+            operand = self.unary_expression()
+            return UnaryOp(Operator.BITWISE_NOT, operand)
         elif self.expect(TokenType.MINUS):
             operator = Operator.SUB
             self.advance()
@@ -1283,6 +1375,10 @@ class FluxParser:
                 self.consume(TokenType.RIGHT_PAREN)
                 if isinstance(expr, Identifier):
                     expr = FunctionCall(expr.name, args)
+                elif isinstance(expr, QualifiedName) and expr.member is None:
+                    expr = FunctionCall(expr.qualifiers[-1], args, qualifiers=expr.qualifiers[:-1])
+                elif isinstance(expr, MemberAccess):
+                    expr = MethodCall(expr.object, expr.member, args)
                 else:
                     # Method call or complex expression
                     expr = FunctionCall("", args)  # This might need refinement
@@ -1318,7 +1414,7 @@ class FluxParser:
     
     def primary_expression(self) -> Expression:
         """
-        primary_expression -> IDENTIFIER
+        primary_expression -> IDENTIFIER ('::' IDENTIFIER)*
                            | INTEGER
                            | FLOAT
                            | CHAR
@@ -1335,7 +1431,14 @@ class FluxParser:
         if self.expect(TokenType.IDENTIFIER):
             name = self.current_token.value
             self.advance()
-            return Identifier(name)
+            if not self.expect(TokenType.SCOPE):
+                return Identifier(name)
+            # namespace::name
+            parts = [name]
+            while self.expect(TokenType.SCOPE):
+                self.advance()
+                parts.append(self.consume(TokenType.IDENTIFIER).value)
+            return QualifiedName(parts)
         elif self.expect(TokenType.XOR):
             # Handle XOR as a function call
             self.advance()
@@ -1361,6 +1464,11 @@ class FluxParser:
             value = self.current_token.value
             self.advance()
             return Literal(value, DataType.CHAR)
+        elif self.expect(TokenType.BOOL):
+            # The lexer folds true and false into one token type
+            value = self.current_token.value == 'true'
+            self.advance()
+            return Literal(value, DataType.BOOL)
         elif self.expect(TokenType.TRUE):
             self.advance()
             return Literal(True, DataType.BOOL)
@@ -1400,16 +1508,16 @@ class FluxParser:
         self.consume(TokenType.LEFT_PAREN)
         
         # Look ahead to determine if it's a type or expression
-        saved_pos = self.position
+        saved_pos = self.mark()
         try:
             # Try to parse as type spec first
             target = self.type_spec()
             self.consume(TokenType.RIGHT_PAREN)
+            self.release(saved_pos)
             return AlignOf(target)
         except ParseError:
             # If type parsing fails, try as expression
-            self.position = saved_pos
-            self.current_token = self.tokens[self.position]
+            self.reset(saved_pos)
             expr = self.expression()
             self.consume(TokenType.RIGHT_PAREN)
             return AlignOf(expr)
@@ -1422,16 +1530,16 @@ class FluxParser:
         self.consume(TokenType.LEFT_PAREN)
         
         # Look ahead to determine if it's a type or expression
-        saved_pos = self.position
+        saved_pos = self.mark()
         try:
             # Try to parse as type spec first
             target = self.type_spec()
             self.consume(TokenType.RIGHT_PAREN)
+            self.release(saved_pos)
             return SizeOf(target)
         except ParseError:
             # If type parsing fails, try as expression
-            self.position = saved_pos
-            self.current_token = self.tokens[self.position]
+            self.reset(saved_pos)
             expr = self.expression()
             self.consume(TokenType.RIGHT_PAREN)
             return SizeOf(expr)
@@ -1439,12 +1547,16 @@ class FluxParser:
     def array_literal(self) -> Expression:
         """
         array_literal -> '[' (expression (',' expression)*)? ']'
+                       | '[' expression 'for' '(' IDENTIFIER (',' IDENTIFIER)* 'in' expression ')'
+                             ('if' '(' expression ')')? ']'
         """
         self.consume(TokenType.LEFT_BRACKET)
         elements = []
         
         if not self.expect(TokenType.RIGHT_BRACKET):
             elements.append(self.expression())
+            if self.expect(TokenType.FOR):
+                return self.array_comprehension(elements[0])
             while self.expect(TokenType.COMMA):
                 self.advance()
                 elements.append(self.expression())
@@ -1452,6 +1564,30 @@ class FluxParser:
         self.consume(TokenType.RIGHT_BRACKET)
         return Literal(elements, DataType.DATA)  # Array literal
     
+    def array_comprehension(self, element: Expression) -> ArrayComprehension:
+        """
+        The rest of a comprehension after its element, up to and including ']'
+        """
+        self.consume(TokenType.FOR)
+        self.consume(TokenType.LEFT_PAREN)
+        variables = [self.consume(TokenType.IDENTIFIER).value]
+        while self.expect(TokenType.COMMA):
+            self.advance()
+            variables.append(self.consume(TokenType.IDENTIFIER).value)
+        self.consume(TokenType.IN)
+        iterable = self.expression()
+        self.consume(TokenType.RIGHT_PAREN)
+        
+        condition = None
+        if self.expect(TokenType.IF):
+            self.advance()
+            self.consume(TokenType.LEFT_PAREN)
+            condition = self.expression()
+            self.consume(TokenType.RIGHT_PAREN)
+        
+        self.consume(TokenType.RIGHT_BRACKET)
+        return ArrayComprehension(element, variables, iterable, condition)
+    
     def struct_literal(self) -> Expression:
         """
         struct_literal -> '{' (IDENTIFIER '=' expression (',' IDENTIFIER '=' expression)*)? '}'
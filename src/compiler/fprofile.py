@@ -0,0 +1,99 @@
+"""
+Flux Profile Data
+
+A binary built with --pgo-generate appends its counts to a raw profile
+when it exits: $FLUX_PROFILE_FILE, or default.fxprofraw in the working
+directory. Every run adds a block of lines, one per function and one per
+branch:
+
+    F <function> <calls> <branch sites>
+    B <function>:<site> <executions> <times taken>
+
+Merging sums the counts, so a merged profile has the same format and
+several runs, raw or merged, combine with --pgo-merge. --pgo-use reads
+one back into codegen (see the PROFILE-GUIDED OPTIMIZATION section of
+fast.py).
+"""
+
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Dict, Iterable, Optional, Set, Tuple
+
+DEFAULT_RAW_PROFILE = "default.fxprofraw"
+
+# Hot functions are the most-called ones that together account for this
+# share of all calls, the cutoff LLVM's profile summary uses for hot counts
+HOT_CUTOFF = 0.99
+
+@dataclass
+class Profile:
+    functions: Dict[str, Tuple[int, int]] = field(default_factory=dict)  # name -> (calls, branch sites)
+    branches: Dict[str, Tuple[int, int]] = field(default_factory=dict)   # site -> (executions, taken)
+    _hot: Optional[Set[str]] = field(default=None, repr=False)
+
+    def add(self, other: 'Profile') -> None:
+        for name, (calls, sites) in other.functions.items():
+            known = self.functions.get(name)
+            if known is not None and known[1] != sites:
+                raise ValueError(f"profiles of {name} come from different sources "
+                                 f"({known[1]} and {sites} branches)")
+            self.functions[name] = ((known[0] if known else 0) + calls, sites)
+        for site, (executions, taken) in other.branches.items():
+            known = self.branches.get(site, (0, 0))
+            self.branches[site] = (known[0] + executions, known[1] + taken)
+        self._hot = None
+
+    def fits(self, name: str, sites: int) -> bool:
+        """Whether name was profiled with the same number of branches it has now"""
+        return name in self.functions and self.functions[name][1] == sites
+
+    def branch(self, site: str) -> Optional[Tuple[int, int]]:
+        return self.branches.get(site)
+
+    def temperature(self, name: str) -> Optional[str]:
+        """'hot', 'cold' (never called) or None"""
+        if name not in self.functions:
+            return None
+        if self.functions[name][0] == 0:
+            return 'cold'
+        if self._hot is None:
+            self._hot = set()
+            total = sum(calls for calls, _ in self.functions.values())
+            covered = 0
+            for other, (calls, _) in sorted(self.functions.items(), key=lambda item: -item[1][0]):
+                if covered >= HOT_CUTOFF * total:
+                    break
+                self._hot.add(other)
+                covered += calls
+        return 'hot' if name in self._hot else None
+
+    def write(self, path: Path) -> None:
+        with open(path, 'w') as f:
+            for name, (calls, sites) in sorted(self.functions.items()):
+                f.write(f"F {name} {calls} {sites}\n")
+            for site, (executions, taken) in sorted(self.branches.items()):
+                f.write(f"B {site} {executions} {taken}\n")
+
+def read_profile(path: Path) -> Profile:
+    """A raw or merged profile; repeated entries from several runs are summed"""
+    profile = Profile()
+    with open(path, 'r') as f:
+        for number, line in enumerate(f, 1):
+            fields = line.split()
+            if not fields:
+                continue
+            if len(fields) != 4 or fields[0] not in ('F', 'B'):
+                raise ValueError(f"{path}:{number}: not a Flux profile line")
+            run = Profile()
+            if fields[0] == 'F':
+                run.functions[fields[1]] = (int(fields[2]), int(fields[3]))
+            else:
+                run.branches[fields[1]] = (int(fields[2]), int(fields[3]))
+            profile.add(run)
+    return profile
+
+def merge_profiles(paths: Iterable[Path]) -> Profile:
+    merged = Profile()
+    for path in paths:
+        merged.add(read_profile(path))
+    return merged
@@ -0,0 +1,205 @@
+"""
+Flux Compile-Time Report
+
+Per-phase wall time and peak memory for `fc.py --time-report`, plus
+counters describing how much work each phase did (tokens, AST nodes by
+class, IR functions and instructions, bytes of IR).
+
+Phases nest: imports are timed inside codegen, and each import contains
+its own lex/parse. Timing is only collected while a report is active, so
+`phase()` costs nothing in a normal build.
+
+Max RSS is the compiler's own high-water mark at the end of a phase, or,
+for a phase that runs tools (llc, as, the linker), the largest of the
+children started through run() within it, each measured on its own.
+Python heap peaks come from tracemalloc, which slows the compiler down
+severalfold, so they are only traced with `--trace-memory`; the wall
+times of such a report are not comparable with plain ones.
+"""
+
+import os
+import json
+import time
+import platform
+import subprocess as subprocesses
+import tracemalloc
+from contextlib import contextmanager
+from dataclasses import fields, is_dataclass
+from typing import Any, Dict, List, Optional
+
+try:
+    import resource
+except ImportError:  # Not available on Windows
+    resource = None
+
+_active = None
+
+def active_report() -> Optional['TimeReport']:
+    return _active
+
+@contextmanager
+def phase(name: str, subprocess: bool = False):
+    """Time a phase of the active report, if there is one"""
+    report = _active
+    if report is None:
+        yield
+    else:
+        with report.phase(name, subprocess):
+            yield
+
+def count(name: str, amount: int = 1) -> None:
+    if _active is not None:
+        _active.count(name, amount)
+
+def _kib(max_rss: int) -> int:
+    # ru_maxrss is bytes on macOS and KiB elsewhere
+    return max_rss // 1024 if platform.system() == "Darwin" else max_rss
+
+def _max_rss_kib() -> Optional[int]:
+    if resource is None:
+        return None
+    return _kib(resource.getrusage(resource.RUSAGE_SELF).ru_maxrss)
+
+def run(args: List[str], check: bool = False, **kwargs) -> subprocesses.CompletedProcess:
+    """subprocess.run, crediting the child's own peak RSS to the open phases
+
+    RUSAGE_CHILDREN only keeps the largest child of the whole process, so
+    a small tool run after a big one would be reported at the big one's
+    size; wait4 gives this child's usage alone.
+    """
+    report = _active
+    if report is None or not hasattr(os, 'wait4'):
+        return subprocesses.run(args, check=check, **kwargs)
+    process = subprocesses.Popen(args, **kwargs)
+    _, status, usage = os.wait4(process.pid, 0)
+    process.returncode = os.waitstatus_to_exitcode(status)
+    report.child_peak(_kib(usage.ru_maxrss))
+    if check and process.returncode != 0:
+        raise subprocesses.CalledProcessError(process.returncode, args)
+    return subprocesses.CompletedProcess(args, process.returncode)
+
+class TimeReport:
+    def __init__(self, trace_memory: bool = False):
+        self.trace_memory = trace_memory
+        self.phases: List[Dict[str, Any]] = []
+        self.counters: Dict[str, int] = {}
+        self.ast_nodes: Dict[str, int] = {}
+        self._stack: List[Dict[str, Any]] = []
+        self._start = None
+        self.total = 0.0
+
+    def start(self) -> None:
+        global _active
+        if self.trace_memory:
+            tracemalloc.start()
+        self._start = time.perf_counter()
+        _active = self
+
+    def stop(self) -> None:
+        global _active
+        self.total = time.perf_counter() - self._start
+        if self.trace_memory:
+            tracemalloc.stop()
+        _active = None
+
+    def _fold_peak(self) -> None:
+        """Credit the traced peak since the last reset to every open phase"""
+        if not self.trace_memory:
+            return
+        peak = tracemalloc.get_traced_memory()[1]
+        for entry in self._stack:
+            entry['py_peak'] = max(entry['py_peak'], peak)
+        tracemalloc.reset_peak()
+
+    @contextmanager
+    def phase(self, name: str, subprocess: bool = False):
+        self._fold_peak()
+        entry = {'name': name, 'depth': len(self._stack), 'wall': 0.0,
+                 'py_peak': 0 if self.trace_memory else None, 'max_rss': None, 'runs_tools': subprocess}
+        self.phases.append(entry)
+        self._stack.append(entry)
+        start = time.perf_counter()
+        try:
+            yield entry
+        finally:
+            entry['wall'] = time.perf_counter() - start
+            self._fold_peak()
+            self._stack.pop()
+            # Tools like llc run as children, their memory is not in our own RSS
+            if not subprocess:
+                entry['max_rss'] = _max_rss_kib()
+
+    def child_peak(self, max_rss_kib: int) -> None:
+        """A tool just exited having peaked at max_rss_kib"""
+        for entry in self._stack:
+            if entry['runs_tools']:
+                entry['max_rss'] = max(entry['max_rss'] or 0, max_rss_kib)
+
+    def count(self, name: str, amount: int = 1) -> None:
+        self.counters[name] = self.counters.get(name, 0) + amount
+
+    def count_ast(self, node: Any) -> None:
+        """Count AST nodes by class, walking dataclass fields"""
+        pending = [node]
+        while pending:
+            item = pending.pop()
+            if isinstance(item, (list, tuple)):
+                pending.extend(item)
+            elif isinstance(item, dict):
+                pending.extend(item.values())
+            elif is_dataclass(item) and not isinstance(item, type):
+                name = type(item).__name__
+                self.ast_nodes[name] = self.ast_nodes.get(name, 0) + 1
+                pending.extend(getattr(item, f.name) for f in fields(item))
+
+    def count_ir(self, module: Any, llvm_ir: str) -> None:
+        for func in module.functions:
+            if func.is_declaration:
+                self.count('ir declarations')
+                continue
+            self.count('ir functions')
+            self.count('ir basic blocks', len(func.blocks))
+            self.count('ir instructions', sum(len(block.instructions) for block in func.blocks))
+        self.count('ir bytes', len(llvm_ir.encode('utf-8')))
+
+    def to_dict(self) -> Dict[str, Any]:
+        return {
+            'total_wall_seconds': self.total,
+            'phases': [
+                {
+                    'name': entry['name'],
+                    'depth': entry['depth'],
+                    'wall_seconds': entry['wall'],
+                    'python_peak_bytes': entry['py_peak'],
+                    'max_rss_kib': entry['max_rss'],
+                }
+                for entry in self.phases
+            ],
+            'counters': dict(sorted(self.counters.items())),
+            'ast_nodes': dict(sorted(self.ast_nodes.items())),
+        }
+
+    def write_json(self, path: str) -> None:
+        with open(path, 'w') as f:
+            json.dump(self.to_dict(), f, indent=2)
+
+    def format_text(self) -> str:
+        rule = "===" + "-" * 73 + "==="
+        lines = [rule, "Flux compile-time report".center(79), rule,
+                 f"  Total wall time: {self.total:.4f} s", "",
+                 f"  {'Wall (s)':>10} {'Wall %':>7} {'Py peak (KiB)':>14} {'Max RSS (KiB)':>14}   Phase"]
+        for entry in self.phases:
+            percent = 100.0 * entry['wall'] / self.total if self.total else 0.0
+            rss = entry['max_rss'] if entry['max_rss'] is not None else '-'
+            py_peak = entry['py_peak'] // 1024 if entry['py_peak'] is not None else '-'
+            name = "  " * entry['depth'] + entry['name']
+            lines.append(f"  {entry['wall']:>10.4f} {percent:>6.1f}% {py_peak:>14} {rss:>14}   {name}")
+        if self.counters:
+            lines += ["", "  Counters:"]
+            lines += [f"  {value:>14}  {name}" for name, value in sorted(self.counters.items())]
+        if self.ast_nodes:
+            lines += ["", "  AST nodes by class:"]
+            lines += [f"  {value:>14}  {name}" for name, value in
+                      sorted(self.ast_nodes.items(), key=lambda item: (-item[1], item[0]))]
+        lines.append(rule)
+        return "\n".join(lines)
@@ -0,0 +1,224 @@
+"""
+Flux Compile Server
+
+Starting Python, importing llvmlite and initializing LLVM costs more than
+compiling a small program. fc.py --server pays that once: it starts one
+compiler process and keeps it warm. Parsed imports stay in memory on top
+of the on-disk import cache, and libfx and --run programs stay loaded.
+Builds are then requested from a thin client:
+
+    python fc.py --server &
+    python fserver.py input.fx [fc.py arguments]
+    python fserver.py --stop
+
+The client depends on nothing but the standard library. It sends its
+command line, working directory and FLUX_* environment over a Unix
+socket, together with its stdin, stdout and stderr. The server runs the
+build with those as its own standard streams, so compiler messages, the
+linker and a --run program all write to the client's terminal. The
+client exits with the build's status. Builds run one at a time. A --run
+program runs in a child forked from the server, so its exit(), abort()
+or a crash ends that run only.
+
+With no server listening, or for --watch, the client runs fc.py itself.
+A server whose compiler sources changed since it started refuses further
+builds and exits, so a stale compiler never answers.
+
+The socket is $FLUX_SERVER_SOCKET, or ~/.flux/server.sock.
+"""
+
+import os
+import sys
+import json
+import socket
+from pathlib import Path
+from typing import Callable, List, Optional, Tuple
+
+STANDARD_STREAMS = (0, 1, 2)
+
+def socket_path() -> Path:
+    return Path(os.environ.get("FLUX_SERVER_SOCKET", Path.home() / ".flux" / "server.sock"))
+
+def compiler_fingerprint() -> Tuple:
+    """Changes whenever a compiler source file does"""
+    compiler_dir = Path(__file__).resolve().parent
+    return tuple((path.name, path.stat().st_mtime_ns) for path in sorted(compiler_dir.glob("*.py")))
+
+def _send(connection: socket.socket, message: dict, fds: List[int] = ()) -> None:
+    data = (json.dumps(message) + "\n").encode('utf-8')
+    if fds:
+        socket.send_fds(connection, [data], list(fds))
+    else:
+        connection.sendall(data)
+
+def _receive(connection: socket.socket, max_fds: int = 0) -> Tuple[Optional[dict], List[int]]:
+    """One newline-terminated JSON message, and the descriptors that came with it"""
+    data, fds = b"", []
+    while not data.endswith(b"\n"):
+        if max_fds and not fds:
+            chunk, fds, _, _ = socket.recv_fds(connection, 65536, max_fds)
+        else:
+            chunk = connection.recv(65536)
+        if not chunk:
+            for fd in fds:
+                os.close(fd)
+            return None, []
+        data += chunk
+    return json.loads(data), fds
+
+# ============ SERVER ============
+
+def _run_build(build: Callable[[], None], args: List[str]) -> int:
+    """fc.py's main on args, as its exit status"""
+    saved_argv = sys.argv
+    sys.argv = ["fc.py"] + args
+    try:
+        build()
+        return 0
+    except SystemExit as e:
+        if e.code is None or isinstance(e.code, int):
+            return e.code or 0
+        print(e.code, file=sys.stderr)
+        return 1
+    except Exception as e:
+        print(f"Compilation failed: {e}", file=sys.stderr)
+        return 1
+    finally:
+        sys.argv = saved_argv
+
+def _handle(build: Callable[[], None], request: dict, fds: List[int]) -> int:
+    """Run one build in the client's directory and environment, on the client's streams"""
+    saved_streams = [os.dup(fd) for fd in STANDARD_STREAMS]
+    saved_cwd = os.getcwd()
+    saved_env = {key: value for key, value in os.environ.items() if key.startswith("FLUX_")}
+    try:
+        for fd, target in zip(fds, STANDARD_STREAMS):
+            os.dup2(fd, target)
+        for key in saved_env:
+            del os.environ[key]
+        os.environ.update(request.get('env', {}))
+        try:
+            os.chdir(request['cwd'])
+        except OSError as e:
+            print(f"Error: {e}", file=sys.stderr)
+            return 1
+        return _run_build(build, request['args'])
+    finally:
+        sys.stdout.flush()
+        sys.stderr.flush()
+        for saved, target in zip(saved_streams, STANDARD_STREAMS):
+            os.dup2(saved, target)
+            os.close(saved)
+        for fd in fds:
+            os.close(fd)
+        os.chdir(saved_cwd)
+        for key in [key for key in os.environ if key.startswith("FLUX_")]:
+            del os.environ[key]
+        os.environ.update(saved_env)
+
+def _warm_up() -> None:
+    """Pay for LLVM initialization before the first request"""
+    from fbackend import initialize_llvm
+    from fcache import ImportCache
+    initialize_llvm()
+    ImportCache.keep_in_memory = True
+
+def serve(build: Callable[[], None], path: Optional[Path] = None) -> None:
+    """Answer build requests with build, fc.py's main, until stopped"""
+    path = path or socket_path()
+    path.parent.mkdir(parents=True, exist_ok=True)
+    if path.exists():
+        probe = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        try:
+            probe.connect(str(path))
+            raise RuntimeError(f"A compile server is already listening on {path}")
+        except (ConnectionRefusedError, FileNotFoundError):
+            path.unlink()  # Left behind by a server that did not shut down
+        finally:
+            probe.close()
+
+    _warm_up()
+    fingerprint = compiler_fingerprint()
+    # Messages interleave with the linker's, which writes straight to the same terminal
+    sys.stdout.reconfigure(line_buffering=True)
+
+    listener = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    # Created owner-only, so no other user can connect between bind and listen
+    umask = os.umask(0o077)
+    try:
+        listener.bind(str(path))
+    finally:
+        os.umask(umask)
+    listener.listen()
+    print(f"Flux compile server listening on {path}")
+    try:
+        while True:
+            connection, _ = listener.accept()
+            with connection:
+                request, fds = _receive(connection, max_fds=len(STANDARD_STREAMS))
+                if request is None:
+                    continue
+                if request.get('stop'):
+                    _send(connection, {'status': 0})
+                    break
+                if compiler_fingerprint() != fingerprint:
+                    for fd in fds:
+                        os.close(fd)
+                    _send(connection, {'stale': True})
+                    print("Compiler sources changed, shutting down")
+                    break
+                _send(connection, {'status': _handle(build, request, fds)})
+    except KeyboardInterrupt:
+        pass
+    finally:
+        listener.close()
+        try:
+            path.unlink()
+        except OSError:
+            pass
+
+# ============ CLIENT ============
+
+def _connect() -> Optional[socket.socket]:
+    connection = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    try:
+        connection.connect(str(socket_path()))
+    except OSError:
+        connection.close()
+        return None
+    return connection
+
+def _run_locally(args: List[str]) -> None:
+    """No (usable) server: be fc.py"""
+    fc_path = Path(__file__).resolve().parent / "fc.py"
+    os.execv(sys.executable, [sys.executable, str(fc_path)] + args)
+
+def client_main(args: List[str]) -> int:
+    connection = _connect()
+    if args == ["--stop"]:
+        if connection is None:
+            print("No compile server is running", file=sys.stderr)
+            return 1
+        with connection:
+            _send(connection, {'stop': True})
+            _receive(connection)
+        return 0
+    if connection is None or "--watch" in args:
+        # A watch loop would hold the server forever; it is a warm process of its own
+        if connection is not None:
+            connection.close()
+        _run_locally(args)
+
+    with connection:
+        env = {key: value for key, value in os.environ.items() if key.startswith("FLUX_")}
+        _send(connection, {'args': args, 'cwd': os.getcwd(), 'env': env}, STANDARD_STREAMS)
+        reply, _ = _receive(connection)
+    if reply is None:
+        print("Error: the compile server closed the connection", file=sys.stderr)
+        return 1
+    if reply.get('stale'):
+        _run_locally(args)
+    return reply['status']
+
+if __name__ == "__main__":
+    sys.exit(client_main(sys.argv[1:]))
@@ -0,0 +1,168 @@
+"""
+Flux Symbol Table
+
+Codegen resolves names through two structures:
+
+    Scope        the variables of one block, chained to the enclosing
+                 block's. Lookups that miss walk outward; a block's
+                 declarations go away with it, and so do its object
+                 instances, through their __exit.
+    SymbolTable  the module's namespaces. Each namespace builds its
+                 mangled prefix (outer__inner__) once, when it is first
+                 opened, and maps its members' names to their mangled
+                 names. `using` copies a namespace's members into an
+                 alias table, so resolving print, io::print or
+                 standard::io::print is a few dict lookups and never
+                 builds a string.
+
+The lexer interns identifiers, so the keys here are shared strings.
+"""
+
+import sys
+from typing import Dict, Optional, Sequence
+
+_MISSING = object()
+
+class Scope(dict):
+    """One block's names, falling back to the enclosing blocks'"""
+    __slots__ = ('parent', 'objects')
+
+    def __init__(self, parent: Optional['Scope'] = None):
+        super().__init__()
+        self.parent = parent
+        # Object instances declared in this block, in order; their __exit runs when it ends
+        self.objects = []
+
+    def child(self) -> 'Scope':
+        return Scope(self)
+
+    def __missing__(self, name):
+        if self.parent is None:
+            raise KeyError(name)
+        return self.parent[name]
+
+    def __contains__(self, name) -> bool:
+        return self.get(name, _MISSING) is not _MISSING
+
+    def get(self, name, default=None):
+        scope = self
+        while scope is not None:
+            value = dict.get(scope, name, _MISSING)
+            if value is not _MISSING:
+                return value
+            scope = scope.parent
+        return default
+
+    def __delitem__(self, name) -> None:
+        # (void) on a variable ends it in the block that declared it
+        scope = self
+        while scope is not None:
+            if dict.__contains__(scope, name):
+                dict.__delitem__(scope, name)
+                return
+            scope = scope.parent
+        raise KeyError(name)
+
+class Namespace:
+    __slots__ = ('name', 'parent', 'prefix', 'children', 'members', 'used')
+
+    def __init__(self, name: str, parent: Optional['Namespace'] = None):
+        self.name = name
+        self.parent = parent
+        self.prefix = f"{parent.prefix}{name}__" if parent is not None else ""
+        self.children: Dict[str, Namespace] = {}
+        self.members: Dict[str, str] = {}  # Name -> mangled name
+        self.used = False                  # Named by a using statement
+
+    def child(self, name: str) -> 'Namespace':
+        """The nested namespace called name; a namespace opened again is the same namespace"""
+        namespace = self.children.get(name)
+        if namespace is None:
+            namespace = self.children[name] = Namespace(name, self)
+        return namespace
+
+    def mangle(self, name: str) -> str:
+        return sys.intern(self.prefix + name) if self.prefix else name
+
+    @property
+    def path(self) -> str:
+        parts = []
+        namespace = self
+        while namespace.parent is not None:
+            parts.append(namespace.name)
+            namespace = namespace.parent
+        return "::".join(reversed(parts))
+
+class SymbolTable:
+    def __init__(self):
+        self.root = Namespace("")
+        self.current = self.root
+        self.aliases: Dict[str, str] = {}  # Name -> mangled name, from using
+
+    def enter(self, name: str) -> Namespace:
+        self.current = self.current.child(name)
+        return self.current
+
+    def leave(self) -> None:
+        self.current = self.current.parent
+
+    def define(self, name: str) -> str:
+        """Declare name in the current namespace and return the name it is emitted under"""
+        namespace = self.current
+        mangled = namespace.members.get(name)
+        if mangled is None:
+            mangled = namespace.members[name] = namespace.mangle(name)
+            if namespace.used:
+                self.aliases.setdefault(name, mangled)
+        return mangled
+
+    def using(self, path: Sequence[str]) -> None:
+        """Make the members of namespace path, including ones defined later, visible unqualified"""
+        namespace = self.root
+        for part in path:
+            namespace = namespace.child(part)
+        namespace.used = True
+        for name, mangled in namespace.members.items():
+            # The first using of a name wins, as does a name the module defines itself
+            self.aliases.setdefault(name, mangled)
+
+    def resolve(self, name: str) -> str:
+        """
+        The mangled name an unqualified name refers to: a member of the
+        current namespace or one around it, then one brought in by using.
+        Names the table never saw resolve to themselves.
+        """
+        namespace = self.current
+        while namespace is not None:
+            mangled = namespace.members.get(name)
+            if mangled is not None:
+                return mangled
+            namespace = namespace.parent
+        return self.aliases.get(name, name)
+
+    def resolve_qualified(self, path: Sequence[str], name: str) -> str:
+        """
+        The mangled name of path::name. path is looked up from the current
+        namespace outward, like C++, so io::print inside standard is
+        standard::io::print.
+        """
+        outer = self.current
+        while outer is not None:
+            namespace = outer
+            for part in path:
+                namespace = namespace.children.get(part)
+                if namespace is None:
+                    break
+            if namespace is not None:
+                mangled = namespace.members.get(name)
+                # Not defined (yet): the caller reports the mangled name as unknown
+                return mangled if mangled is not None else namespace.mangle(name)
+            outer = outer.parent
+        raise NameError(f"Unknown namespace: {'::'.join(path)}")
+
+def symbols(module) -> SymbolTable:
+    """The module's symbol table"""
+    table = getattr(module, '_symbols', None)
+    if table is None:
+        table = module._symbols = SymbolTable()
+    return table
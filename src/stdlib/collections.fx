@@ -1,30 +1,430 @@
-// Basic Collection Types (Non-Templated Implementation)
+// Collection Types
+//
+//   array         growable array, geometric growth
+//   small_array   array that keeps its first 64 bytes of elements inline
+//   hash_map      open addressing with Robin Hood probing
+//
+// Elements live in one contiguous allocation in every container, so a
+// scan or a probe sequence walks adjacent memory.
+//
+// Generics do not lower yet, so the arrays hold elements of a size given
+// to __init and hand out slots as uint8* for the caller to cast, and the
+// map's keys and values are uint64 (an integer or an address). Each
+// container frees its memory in __exit, when the block declaring it ends:
+//
+//   using standard::collections;
+//
+//   array points(sizeof(point) / 8);
+//   point* p = (point*)points.emplace();
+//   p.x = 1;
 
-import "types.fx";
+def malloc(uint64 size) -> void*;
+def realloc(void* ptr, uint64 size) -> void*;
+def free(void* ptr) -> void;
+def memcpy(void* dest, void* src, uint64 length) -> void*;
 
 namespace standard
 {
     namespace collections
     {
-        // Dynamic array for integers (would need separate implementations for other types)
-        object array<T>
+        // Growing by a constant factor keeps push amortized O(1); 2x
+        // wastes at most half the allocation and rounds well
+        def grown_capacity(uint32 capacity, uint32 needed) -> uint32
         {
-            T* ptr;
-            u32 size, capacity;
+            uint32 grown = 8;
+            if (capacity >= 8) { grown = capacity * 2; };
+            if (grown < needed) { return needed; };
+            return grown;
+        };
+
+        // FNV-1a over the key's bytes
+        def hash_bytes(uint8* bytes, uint64 length) -> uint32
+        {
+            uint32 h = 2166136261;
+            for (uint64 i = 0; i < length; i++)
+            {
+                h = (h xor bytes[i]) * 16777619;
+            };
+            return h;
+        };
+
+        def slot_hash(uint64 key) -> uint32
+        {
+            uint32 h = hash_bytes((uint8*)@key, 8);
+            if (h == 0) { return 1; };
+            return h;
+        };
+    };
+};
+
+// A namespace's objects are emitted before its functions, so the helpers
+// their methods call are defined above, in a block of their own
+namespace standard
+{
+    namespace collections
+    {
+        object array
+        {
+            uint8* bytes;
+            uint32 size;
+            uint32 capacity;
+            uint32 element_size;    // In bytes
 
-            def __init(T* ptr, u32 size, u32 capacity) -> this
+            def __init(uint32 element_size) -> this
             {
-                this.ptr = ptr;
+                this.bytes = (uint8*)0;
+                this.size = 0;
+                this.capacity = 0;
+                this.element_size = element_size;
+                return this;
+            };
+
+            def __exit() -> void
+            {
+                free(this.bytes);
+                return void;
+            };
+
+            // Adopt an existing malloc'd allocation of capacity elements, the first size in use
+            def adopt(uint8* bytes, uint32 size, uint32 capacity) -> void
+            {
+                free(this.bytes);
+                this.bytes = bytes;
                 this.size = size;
                 this.capacity = capacity;
+                return void;
+            };
+
+            // Make room for n elements without further reallocation
+            def reserve(uint32 n) -> void
+            {
+                if (n <= this.capacity) { return void; };
+                this.bytes = (uint8*)realloc(this.bytes, (uint64)n * (uint64)this.element_size);
+                this.capacity = n;
+                return void;
+            };
+
+            // Append a slot and return it for the caller to construct the
+            // element in place, instead of building one and copying it in
+            def emplace() -> uint8*
+            {
+                if (this.size == this.capacity)
+                {
+                    this.reserve(grown_capacity(this.capacity, this.size + 1));
+                };
+                uint8* slot = @this.bytes[(uint64)this.size * (uint64)this.element_size];
+                this.size = this.size + 1;
+                return slot;
+            };
+
+            // Append a copy of the element_size bytes at element
+            def push(uint8* element) -> void
+            {
+                memcpy(this.emplace(), element, (uint64)this.element_size);
+                return void;
+            };
+
+            // Remove the last element; its slot stays readable until the next push
+            def pop() -> uint8*
+            {
+                this.size = this.size - 1;
+                return @this.bytes[(uint64)this.size * (uint64)this.element_size];
+            };
+
+            // The element at index, or null past the end
+            def get(uint32 index) -> uint8*
+            {
+                if (index >= this.size) { return (uint8*)0; };
+                return @this.bytes[(uint64)index * (uint64)this.element_size];
+            };
+
+            // Keeps the allocation for reuse
+            def clear() -> void
+            {
+                this.size = 0;
+                return void;
+            };
+        };
+
+        // Short lists never touch the heap: the first 64 bytes of elements
+        // are stored in the object itself, and only a longer list moves to
+        // an allocation. Nothing points into the object, so it can be
+        // copied or moved like any other value; elements() finds wherever
+        // the elements are now.
+        object small_array
+        {
+            uint8[64] local;
+            uint8* heap;    // Null while the elements are inline
+            uint32 size;
+            uint32 capacity;
+            uint32 element_size;
+
+            def __init(uint32 element_size) -> this
+            {
+                this.heap = (uint8*)0;
+                this.size = 0;
+                this.capacity = 64 / element_size;
+                this.element_size = element_size;
+                return this;
+            };
+
+            def __exit() -> void
+            {
+                free(this.heap);
+                return void;
+            };
+
+            def is_inline() -> bool
+            {
+                return (uint64)this.heap == 0;
+            };
+
+            def elements() -> uint8*
+            {
+                if (this.is_inline()) { return @this.local[0]; };
+                return this.heap;
+            };
+
+            def reserve(uint32 n) -> void
+            {
+                if (n <= this.capacity) { return void; };
+                uint8* grown = (uint8*)malloc((uint64)n * (uint64)this.element_size);
+                memcpy(grown, this.elements(), (uint64)this.size * (uint64)this.element_size);
+                free(this.heap);
+                this.heap = grown;
+                this.capacity = n;
+                return void;
+            };
+
+            def emplace() -> uint8*
+            {
+                if (this.size == this.capacity)
+                {
+                    this.reserve(grown_capacity(this.capacity, this.size + 1));
+                };
+                uint8* base = this.elements();
+                uint8* slot = @base[(uint64)this.size * (uint64)this.element_size];
+                this.size = this.size + 1;
+                return slot;
+            };
+
+            def push(uint8* element) -> void
+            {
+                memcpy(this.emplace(), element, (uint64)this.element_size);
+                return void;
+            };
+
+            def pop() -> uint8*
+            {
+                this.size = this.size - 1;
+                uint8* base = this.elements();
+                return @base[(uint64)this.size * (uint64)this.element_size];
+            };
+
+            def get(uint32 index) -> uint8*
+            {
+                if (index >= this.size) { return (uint8*)0; };
+                uint8* base = this.elements();
+                return @base[(uint64)index * (uint64)this.element_size];
+            };
+
+            def clear() -> void
+            {
+                this.size = 0;
+                return void;
+            };
+        };
+
+        // Key, value and hash side by side: a probe reads one cache line
+        // per slot instead of one per array
+        struct map_slot
+        {
+            uint64 key;
+            uint64 value;
+            uint32 hash;    // 0 marks an empty slot
+        };
+
+        // Robin Hood probing: an insert takes the slot of any entry that is
+        // closer to its home than the new one, so probe lengths stay short
+        // and even, a lookup can stop as soon as it passes the distance
+        // the key would have, and removal shifts the run back instead of
+        // leaving tombstones
+        object hash_map
+        {
+            map_slot* slots;
+            uint32 size;
+            uint32 capacity;    // 0 or a power of 2
+
+            def __init() -> this
+            {
+                this.slots = (map_slot*)0;
+                this.size = 0;
+                this.capacity = 0;
                 return this;
             };
 
             def __exit() -> void
             {
-                (void)this.ptr;
+                free(this.slots);
+                return void;
+            };
+
+            // How far the entry with hash h sits from its home slot when at index
+            def distance(uint32 h, uint32 index) -> uint32
+            {
+                return (index - h) & (this.capacity - 1);
+            };
+
+            // Insert an entry known to be absent, with room to spare
+            def place(uint64 key, uint64 value, uint32 h) -> void
+            {
+                uint32 mask = this.capacity - 1;
+                uint32 index = h & mask;
+                uint32 dist = 0;
+                while (true)
+                {
+                    map_slot* slot = @this.slots[index];
+                    if (slot.hash == 0) { break; };
+                    uint32 resident = this.distance(slot.hash, index);
+                    if (resident < dist)
+                    {
+                        // Take from the rich: carry the displaced entry onwards
+                        uint64 k = slot.key;
+                        uint64 v = slot.value;
+                        uint32 rh = slot.hash;
+                        slot.key = key;
+                        slot.value = value;
+                        slot.hash = h;
+                        key = k;
+                        value = v;
+                        h = rh;
+                        dist = resident;
+                    };
+                    index = (index + 1) & mask;
+                    dist = dist + 1;
+                };
+                map_slot* empty = @this.slots[index];
+                empty.key = key;
+                empty.value = value;
+                empty.hash = h;
+                this.size = this.size + 1;
+                return void;
+            };
+
+            // Room for n entries below the 7/8 load factor
+            def reserve(uint32 n) -> void
+            {
+                uint32 wanted = 8;
+                while (wanted - wanted / 8 < n) { wanted = wanted * 2; };
+                if (wanted <= this.capacity) { return void; };
+
+                map_slot* old = this.slots;
+                uint32 old_capacity = this.capacity;
+                this.slots = (map_slot*)malloc((uint64)wanted * (sizeof(map_slot) / 8));
+                this.capacity = wanted;
+                this.size = 0;
+                for (uint32 i = 0; i < wanted; i++)
+                {
+                    map_slot* slot = @this.slots[i];
+                    slot.hash = 0;
+                };
+                for (uint32 i = 0; i < old_capacity; i++)
+                {
+                    map_slot* entry = @old[i];
+                    if (entry.hash != 0) { this.place(entry.key, entry.value, entry.hash); };
+                };
+                free(old);
+                return void;
+            };
+
+            // Slot index of key, or capacity when absent
+            def find(uint64 key) -> uint32
+            {
+                if (this.size == 0) { return this.capacity; };
+                uint32 h = slot_hash(key);
+                uint32 mask = this.capacity - 1;
+                uint32 index = h & mask;
+                uint32 dist = 0;
+                while (true)
+                {
+                    map_slot* slot = @this.slots[index];
+                    if (slot.hash == 0) { break; };
+                    if (this.distance(slot.hash, index) < dist) { break; };
+                    if (slot.hash == h)
+                    {
+                        if (slot.key == key) { return index; };
+                    };
+                    index = (index + 1) & mask;
+                    dist = dist + 1;
+                };
+                return this.capacity;
+            };
+
+            // The value stored for key, or null when absent
+            def get(uint64 key) -> uint64*
+            {
+                uint32 index = this.find(key);
+                if (index == this.capacity) { return (uint64*)0; };
+                map_slot* slot = @this.slots[index];
+                return @slot.value;
+            };
+
+            def contains(uint64 key) -> bool
+            {
+                return this.find(key) != this.capacity;
+            };
+
+            // Insert or overwrite; returns whether key is new
+            def insert(uint64 key, uint64 value) -> bool
+            {
+                uint32 index = this.find(key);
+                if (index != this.capacity)
+                {
+                    map_slot* slot = @this.slots[index];
+                    slot.value = value;
+                    return false;
+                };
+                this.reserve(this.size + 1);
+                this.place(key, value, slot_hash(key));
+                return true;
+            };
+
+            def remove(uint64 key) -> bool
+            {
+                uint32 index = this.find(key);
+                if (index == this.capacity) { return false; };
+                // Backward shift: pull the rest of the run one slot closer to home
+                uint32 mask = this.capacity - 1;
+                uint32 following = (index + 1) & mask;
+                while (true)
+                {
+                    map_slot* moved = @this.slots[following];
+                    if (moved.hash == 0) { break; };
+                    if (this.distance(moved.hash, following) == 0) { break; };
+                    map_slot* hole = @this.slots[index];
+                    hole.key = moved.key;
+                    hole.value = moved.value;
+                    hole.hash = moved.hash;
+                    index = following;
+                    following = (following + 1) & mask;
+                };
+                map_slot* last = @this.slots[index];
+                last.hash = 0;
+                this.size = this.size - 1;
+                return true;
+            };
+
+            // Keeps the slots for reuse
+            def clear() -> void
+            {
+                for (uint32 i = 0; i < this.capacity; i++)
+                {
+                    map_slot* slot = @this.slots[i];
+                    slot.hash = 0;
+                };
+                this.size = 0;
                 return void;
             };
         };
     };
-};
\ No newline at end of file
+};
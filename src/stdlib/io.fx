@@ -1,59 +1,453 @@
 // Input/Output Operations
+//
+// Output is buffered in user space and written with as few syscalls as
+// possible: a writer fills its buffer and flushes it when full, at exit,
+// on flush(), and after each newline when the stream is a terminal. A
+// write larger than the free space goes out together with the buffered
+// bytes in one writev, so big writes are never copied.
+//
+// Input is never copied line by line either: mapped_file exposes a whole
+// file as one slice, and reader hands out slices of its own buffer, which
+// it refills with one read per megabyte. A slice from a reader stays valid
+// until the next call to next().
+//
+// print, println and eprint take a null-terminated string, so
+// print("text") works as it always has. For anything else, stdout.write
+// and stderr.write take bytes and a length once start_output() has run,
+// which the first print does.
 
-import "types.fx";
+// libc, declared outside the namespace so they keep their C names
+def atexit(void* handler) -> int32;
+def isatty(int32 fd) -> int32;
+def writev(int32 fd, void* segments, int32 count) -> int64;
+def open(uint8* path, int32 flags) -> int32;
+def close(int32 fd) -> int32;
+def read(int32 fd, uint8* buffer, uint64 length) -> int64;
+def lseek(int32 fd, int64 offset, int32 whence) -> int64;
+def mmap(void* address, uint64 length, int32 prot, int32 flags, int32 fd, int64 offset) -> void*;
+def munmap(void* address, uint64 length) -> int32;
+def madvise(void* address, uint64 length, int32 advice) -> int32;
+def malloc(uint64 size) -> void*;
+def realloc(void* ptr, uint64 size) -> void*;
+def free(void* ptr) -> void;
+def strlen(uint8* text) -> uint64;
+def memcpy(void* dest, void* src, uint64 length) -> void*;
+def memmove(void* dest, void* src, uint64 length) -> void*;
+def memchr(void* ptr, int32 byte, uint64 length) -> void*;
+def __errno_location() -> int32*;
 
 namespace standard
 {
     namespace io
     {
-        global
+        const int32 EINTR = 4;
+
+        // Two writev segments back to back, laid out like struct iovec[2]
+        struct segments
+        {
+            uint64 base0;
+            uint64 length0;
+            uint64 base1;
+            uint64 length1;
+        };
+
+        // Write both segments, resuming after short writes and EINTR
+        def write_all(int32 fd, segments* io) -> bool
         {
-            // Print to standard output
-            def print(string s) -> void
+            while (io.length0 + io.length1 > 0)
             {
-                volatile asm
+                int64 written = writev(fd, io, 2);
+                if (written < 0)
                 {
-                    mov eax, 4         ; sys_write
-                    mov ebx, 1         ; stdout
-                    mov ecx, s         ; string pointer
-                    mov edx, sizeof(s) ; length
-                    int 0x80           ; syscall
+                    if (*__errno_location() == EINTR) { continue; };
+                    return false;
                 };
+                uint64 done = (uint64)written;
+                if (done < io.length0)
+                {
+                    io.base0 = io.base0 + done;
+                    io.length0 = io.length0 - done;
+                }
+                else
+                {
+                    done = done - io.length0;
+                    io.base0 = io.base0 + io.length0;
+                    io.length0 = 0;
+                    io.base1 = io.base1 + done;
+                    io.length1 = io.length1 - done;
+                };
+            };
+            return true;
+        };
+
+        // A view into memory owned by someone else
+        struct slice
+        {
+            uint8* bytes;
+            uint64 length;
+        };
+
+        // Split the next record off the front of rest
+        def split(slice* rest, uint8 delimiter, slice* record) -> bool
+        {
+            if (rest.length == 0) { return false; };
+            uint64 length = rest.length;
+            uint64 consumed = length;
+            uint64 found = (uint64)memchr(rest.bytes, delimiter, rest.length);
+            if (found != 0)
+            {
+                length = found - (uint64)rest.bytes;
+                consumed = length + 1;
+            };
+            record.bytes = rest.bytes;
+            record.length = length;
+            rest.bytes = @rest.bytes[consumed];
+            rest.length = rest.length - consumed;
+            return true;
+        };
+
+        const int32 MADV_NORMAL = 0;
+        const int32 MADV_RANDOM = 1;
+        const int32 MADV_SEQUENTIAL = 2;
+        const int32 MADV_WILLNEED = 3;
+    };
+};
+
+// A namespace's objects are emitted before its functions, so the helpers
+// their methods call are defined above, in a block of their own
+namespace standard
+{
+    namespace io
+    {
+        // 16 KiB: one syscall per 16 KiB of small writes
+        object writer
+        {
+            int32 fd;
+            bool line_buffered;
+            uint64 used;
+            uint8[16384] buffer;
+
+            def __init(int32 fd) -> this
+            {
+                this.fd = fd;
+                this.line_buffered = isatty(fd) == 1;
+                this.used = 0;
+                return this;
+            };
+
+            def flush() -> bool
+            {
+                if (this.used == 0) { return true; };
+                segments io;
+                io.base0 = (uint64)@this.buffer[0];
+                io.length0 = this.used;
+                io.base1 = 0;
+                io.length1 = 0;
+                this.used = 0;
+                return write_all(this.fd, @io);
+            };
+
+            // Methods are defined in order, so __exit comes after flush
+            def __exit() -> void
+            {
+                this.flush();
+                return void;
+            };
+
+            def write(uint8* bytes, uint64 length) -> bool
+            {
+                if (length <= 16384 - this.used)
+                {
+                    memcpy(@this.buffer[this.used], bytes, length);
+                    this.used = this.used + length;
+                    if (this.line_buffered and length > 0)
+                    {
+                        if (bytes[length - 1] == '\n') { return this.flush(); };
+                    };
+                    return true;
+                };
+
+                // Too big to buffer: the buffered bytes and the new ones in one writev
+                segments io;
+                io.base0 = (uint64)@this.buffer[0];
+                io.length0 = this.used;
+                io.base1 = (uint64)bytes;
+                io.length1 = length;
+                this.used = 0;
+                return write_all(this.fd, @io);
+            };
+
+            def write_byte(uint8 byte) -> bool
+            {
+                if (this.used == 16384)
+                {
+                    if (not this.flush()) { return false; };
+                };
+                this.buffer[this.used] = byte;
+                this.used = this.used + 1;
+                if (this.line_buffered and byte == '\n') { return this.flush(); };
+                return true;
+            };
+        };
+
+        // A whole file mapped read-only; pages are read in by the kernel
+        // on first touch, nothing is copied into user space
+        object mapped_file
+        {
+            uint8* bytes;
+            uint64 length;
+            slice rest;
+
+            def __init(uint8* path) -> this
+            {
+                this.bytes = (uint8*)0;
+                this.length = 0;
+                int32 fd = open(path, 0);    // O_RDONLY
+                if (fd >= 0)
+                {
+                    int64 size = lseek(fd, 0, 2);    // SEEK_END
+                    if (size > 0)
+                    {
+                        void* address = mmap((void*)0, (uint64)size, 1, 2, fd, 0);    // PROT_READ, MAP_PRIVATE
+                        // MAP_FAILED is (void*)-1
+                        if ((uint64)address + 1 != 0)
+                        {
+                            this.bytes = (uint8*)address;
+                            this.length = (uint64)size;
+                            // Read ahead aggressively and drop pages behind the scan
+                            madvise(address, this.length, MADV_SEQUENTIAL);
+                        };
+                    };
+                    // The mapping holds its own reference to the file
+                    close(fd);
+                };
+                slice* rest = @this.rest;
+                rest.bytes = this.bytes;
+                rest.length = this.length;
+                return this;
+            };
+
+            def __exit() -> void
+            {
+                if (this.length > 0) { munmap(this.bytes, this.length); };
+                this.length = 0;
+                return void;
+            };
+
+            // False if the file could not be opened or is empty
+            def is_open() -> bool
+            {
+                return this.length > 0;
+            };
+
+            // The whole file; named so because data is a keyword
+            def contents() -> slice
+            {
+                slice all;
+                all.bytes = this.bytes;
+                all.length = this.length;
+                return all;
+            };
+
+            def advise(int32 advice) -> void
+            {
+                if (this.length > 0) { madvise(this.bytes, this.length, advice); };
+                return void;
+            };
+
+            // Ask the kernel to start reading [offset, offset + length) now
+            def prefetch(uint64 offset, uint64 length) -> void
+            {
+                if (offset >= this.length) { return void; };
+                if (length > this.length - offset) { length = this.length - offset; };
+                uint64 page = offset - offset % 4096;
+                madvise(@this.bytes[page], length + (offset - page), MADV_WILLNEED);
+                return void;
             };
-            
-            // Print with newline
-            def println(string s) -> void
+
+            // Successive records of the file, without the delimiter
+            def next(uint8 delimiter, slice* record) -> bool
             {
-                print(f"{s}\n");
+                return split(@this.rest, delimiter, record);
             };
-            
-            // Read line from standard input
-            def readline() -> string
+        };
+
+        // Streams records from a file descriptor through one buffer. The
+        // buffer only grows when a single record is longer than it.
+        // Records end at newlines; set delimiter after __init for others.
+        object reader
+        {
+            int32 fd;
+            uint8 delimiter;
+            bool eof;
+            uint8* buffer;
+            uint64 capacity;
+            uint64 start;
+            uint64 scanned;
+            uint64 end;
+
+            def __init(int32 fd) -> this
             {
-                unsigned data{8}[256] as buffer;
-                buffer buf;
-                
-                volatile asm
+                this.fd = fd;
+                this.delimiter = '\n';
+                this.eof = false;
+                this.capacity = 1048576;
+                this.buffer = (uint8*)malloc(this.capacity);
+                this.start = 0;
+                this.scanned = 0;
+                this.end = 0;
+                return this;
+            };
+
+            def __exit() -> void
+            {
+                free(this.buffer);
+                this.capacity = 0;
+                return void;
+            };
+
+            // Move the partial record to the front and read more after it
+            def refill() -> void
+            {
+                if (this.start > 0)
+                {
+                    memmove(this.buffer, @this.buffer[this.start], this.end - this.start);
+                    this.scanned = this.scanned - this.start;
+                    this.end = this.end - this.start;
+                    this.start = 0;
+                };
+                // One byte is kept spare past the data for readline's terminator
+                if (this.end == this.capacity - 1)
                 {
-                    mov eax, 3      ; sys_read
-                    mov ebx, 0      ; stdin
-                    mov ecx, buf    ; buffer pointer
-                    mov edx, 256    ; max length
-                    int 0x80        ; syscall
+                    this.capacity = this.capacity * 2;
+                    this.buffer = (uint8*)realloc(this.buffer, this.capacity);
                 };
-                
-                // Find newline and null-terminate
-                for (u32 i = 0; i < 256; i++)
+                int64 got = read(this.fd, @this.buffer[this.end], this.capacity - this.end - 1);
+                while (got < 0)
                 {
-                    if (buffer[i] == '\n')
+                    if (*__errno_location() != EINTR) { break; };
+                    got = read(this.fd, @this.buffer[this.end], this.capacity - this.end - 1);
+                };
+                if (got <= 0)
+                {
+                    this.eof = true;
+                    return void;
+                };
+                this.end = this.end + (uint64)got;
+                return void;
+            };
+
+            // The next record, without the delimiter; valid until the next call
+            def next(slice* record) -> bool
+            {
+                while (true)
+                {
+                    uint64 found = (uint64)memchr(@this.buffer[this.scanned], this.delimiter, this.end - this.scanned);
+                    if (found != 0)
                     {
-                        buffer[i] = 0;
-                        break;
+                        uint64 stop = found - (uint64)this.buffer;
+                        record.bytes = @this.buffer[this.start];
+                        record.length = stop - this.start;
+                        this.start = stop + 1;
+                        this.scanned = this.start;
+                        return true;
                     };
+                    this.scanned = this.end;
+                    if (this.eof)
+                    {
+                        if (this.start == this.end) { return false; };
+                        // Last record without a trailing delimiter
+                        record.bytes = @this.buffer[this.start];
+                        record.length = this.end - this.start;
+                        this.start = this.end;
+                        return true;
+                    };
+                    this.refill();
                 };
-                
-                return buffer;
+                return false;
+            };
+        };
+
+        // Globals are never destroyed, so an atexit handler flushes them
+        // instead of __exit; both are set up on first use
+        writer stdout;
+        writer stderr;
+
+        def flush() -> void
+        {
+            stdout.flush();
+            stderr.flush();
+            return void;
+        };
+
+        bool output_started = false;
+
+        def start_output() -> void
+        {
+            if (not output_started)
+            {
+                output_started = true;
+                stdout.__init(1);
+                stderr.__init(2);
+                atexit(@flush);
+            };
+            return void;
+        };
+
+        // Print to standard output
+        def print(uint8* text) -> void
+        {
+            start_output();
+            stdout.write(text, strlen(text));
+            return void;
+        };
+
+        // Print with newline
+        def println(uint8* text) -> void
+        {
+            start_output();
+            stdout.write(text, strlen(text));
+            stdout.write_byte('\n');
+            return void;
+        };
+
+        // Print to standard error
+        def eprint(uint8* text) -> void
+        {
+            start_output();
+            stderr.write(text, strlen(text));
+            return void;
+        };
+
+        reader stdin;
+        bool input_started = false;
+
+        // Read a line from standard input. The line is null-terminated in
+        // place and stays valid until the next readline(); at the end of
+        // input it is empty.
+        def readline() -> uint8*
+        {
+            // A prompt written with print() must be visible before blocking
+            start_output();
+            stdout.flush();
+            if (not input_started)
+            {
+                input_started = true;
+                stdin.__init(0);
+            };
+            slice line;
+            if (not stdin.next(@line))
+            {
+                stdin.buffer[stdin.start] = 0;
+                return @stdin.buffer[stdin.start];
+            };
+            // Overwrites the delimiter, or the spare byte after the last record
+            if (line.length > 0)
+            {
+                if (line.bytes[line.length - 1] == '\r') { line.length = line.length - 1; };
             };
+            line.bytes[line.length] = 0;
+            return line.bytes;
         };
     };
-};
\ No newline at end of file
+};
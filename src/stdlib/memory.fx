@@ -0,0 +1,61 @@
+// Region and Pool Allocation
+//
+// An arena hands out memory by bumping a cursor through one buffer and
+// takes it all back at once, so a request-scoped workload pays for one
+// reset instead of a free per object. The compiler lowers the
+// operations below inline at every call site:
+//
+//   arena_init(a, buffer, size)   a covers size bytes at buffer
+//   arena_alloc(a, size)          size bytes, 16-byte aligned; null when full
+//   arena_mark(a)                 the current position
+//   arena_release(a, mark)        free everything allocated since mark
+//   arena_reset(a)                free everything
+//
+//   pool_init(p, buffer, block_size, count)
+//   pool_alloc(p)                 one block; null when full
+//   pool_free(p, block)           return a block to the pool
+//
+// (void) on a pointer stored straight from arena_alloc does nothing, the
+// arena reclaims it on reset; on one from pool_alloc it is pool_free.
+// The compiler tracks this per variable, so keep arena pointers in
+// variables: (void) on a pointer copied into a struct member is a compile
+// error, since its origin is no longer known.
+//
+//   using standard::memory;
+//
+//   unsigned data{8}[65536] scratch;
+//   arena request;
+//
+//   def handle() -> void
+//   {
+//       arena_init(request, scratch, 65536);
+//       uint64 start = arena_mark(request);
+//       void* node = arena_alloc(request, 48);
+//       (void)node;                       // No-op, freed by the release below
+//       arena_release(request, start);
+//       return void;
+//   };
+
+namespace standard
+{
+    namespace memory
+    {
+        // Addresses are kept as integers; cursor moves from base towards limit
+        struct arena
+        {
+            uint64 base;
+            uint64 cursor;
+            uint64 limit;
+        };
+
+        // Fixed-size blocks: freed ones are linked through their first word,
+        // the rest are bumped out of [cursor, limit) on first use
+        struct pool
+        {
+            uint64 cursor;
+            uint64 limit;
+            uint64 block;
+            uint64 free_list;
+        };
+    };
+};
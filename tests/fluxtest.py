@@ -0,0 +1,108 @@
+"""
+Shared setup for the compiler tests
+
+Puts src/compiler on the path and lowers Flux source to an LLVM module
+the way fc.py does, so a test can look at the IR of a snippet.
+
+Run the tests from the repository root:
+
+    python3 -m unittest discover -s tests
+
+The IR tests need llvmlite. Tests that hand the IR to LLVM itself (the
+verifier, object emission, the JIT) need the real llvmlite, 0.41 or
+later, and are skipped without it.
+"""
+
+import io
+import sys
+import unittest
+import contextlib
+from pathlib import Path
+from typing import Iterator, List
+
+ROOT = Path(__file__).resolve().parent.parent
+COMPILER_DIR = ROOT / "src" / "compiler"
+STDLIB_DIR = ROOT / "src" / "stdlib"
+sys.path.insert(0, str(COMPILER_DIR))
+sys.path.insert(0, str(ROOT / "benchmarks"))
+
+# Deeply nested expressions recurse once per grammar level
+sys.setrecursionlimit(max(sys.getrecursionlimit(), 20000))
+
+try:
+    import llvmlite
+    from llvmlite import ir
+    HAVE_LLVMLITE = True
+except ImportError:
+    llvmlite = ir = None
+    HAVE_LLVMLITE = False
+
+def llvmlite_version() -> tuple:
+    version = getattr(llvmlite, '__version__', None)
+    if version is None:
+        return ()
+    return tuple(int(part) for part in version.split('.')[:2] if part.isdigit())
+
+# The binding layer: LLVM's parser, verifier, code generator and MCJIT
+HAVE_LLVM = HAVE_LLVMLITE and llvmlite_version() >= (0, 41)
+
+TRIPLE = "x86_64-pc-linux-gnu"
+
+def fx_sources() -> List[Path]:
+    """Every Flux file in the tree"""
+    return sorted(list((ROOT / "examples").glob("*.fx")) + list(STDLIB_DIR.glob("*.fx")))
+
+def lower(source: str, name: str = "test", debug_info: bool = False, frame_pointers: bool = False,
+          instrument_functions: bool = False, opt_level: int = 2, pgo_generate: bool = False,
+          profile: 'Profile' = None) -> 'ir.Module':
+    """source lowered to an LLVM module, with imports resolved against the stdlib"""
+    from flexer import FluxLexer
+    from fparser import FluxParser
+    from fast import ImportStatement, CodegenOptions, apply_codegen_options
+    parser = FluxParser(FluxLexer(source).tokenize())
+    program = parser.parse()
+    if parser.errors:
+        raise SyntaxError(f"{name}: {parser.errors[0]}")
+    module = ir.Module(name=name, context=ir.Context())
+    module.triple = TRIPLE
+    if HAVE_LLVM:
+        from fbackend import FluxBackend
+        module.data_layout = FluxBackend(TRIPLE, opt_level).data_layout
+    else:
+        module.data_layout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+    ImportStatement._processed_imports = {}
+    options = CodegenOptions(debug_info, frame_pointers, instrument_functions)
+    apply_codegen_options(module, options, Path(f"{name}.fx"), opt_level > 0)
+    module._profile_instrument = pgo_generate
+    module._profile = profile
+    with contextlib.chdir(STDLIB_DIR), contextlib.redirect_stdout(io.StringIO()):
+        return program.codegen(module)
+
+def instructions(function: 'ir.Function') -> Iterator['ir.Instruction']:
+    for block in function.blocks:
+        yield from block.instructions
+
+def opnames(function: 'ir.Function') -> List[str]:
+    return [instruction.opname for instruction in instructions(function)]
+
+def callees(function: 'ir.Function') -> List[str]:
+    """Names of the functions function calls or invokes directly"""
+    return [instruction.callee.name for instruction in instructions(function)
+            if instruction.opname in ('call', 'invoke') and isinstance(instruction.callee, ir.Function)]
+
+def verify(module: 'ir.Module', opt_level: int = 2) -> 'llvm.ModuleRef':
+    """module parsed and verified by LLVM; raises on invalid IR"""
+    from fbackend import FluxBackend
+    return FluxBackend(module.triple, opt_level).parse(module)
+
+@unittest.skipUnless(HAVE_LLVMLITE, "needs llvmlite")
+class ModuleTestCase(unittest.TestCase):
+    """Tests of the module SOURCE lowers to, which each test gets fresh as self.module"""
+    SOURCE = ""
+
+    def setUp(self):
+        self.module = lower(self.SOURCE)
+
+    @unittest.skipUnless(HAVE_LLVM, "needs llvmlite 0.41 or later")
+    def test_verifies(self):
+        verify(self.module)
@@ -0,0 +1,155 @@
+"""
+Tests for the import cache and separate compilation
+
+The import cache tests only parse and lower, so they need llvmlite.
+IncrementalBuilder lowers each module of the import graph to its own
+object and --lto links modules with libfx, so their tests need the real
+llvmlite (0.41 or later) and are skipped without it.
+"""
+
+import io
+import os
+import tempfile
+import unittest
+import contextlib
+from pathlib import Path
+from unittest import mock
+
+import fluxtest
+
+# Three modules, two of them independent, so a -j build has work to spread
+MODULES = {
+    "shapes.fx": """
+        struct pair { int32 a; int32 b; };
+        def area(int32 w, int32 h) -> int32 { return w * h; };
+    """,
+    "counting.fx": """
+        def triangle(int32 n) -> int32 {
+            int32 total = 0;
+            for (i in 1..n) { total = total + i; };
+            return total;
+        };
+    """,
+    "main.fx": """
+        import "shapes.fx";
+        import "counting.fx";
+        def main() -> int { return area(2, 3) + triangle(4); };
+    """,
+}
+
+@unittest.skipUnless(fluxtest.HAVE_LLVMLITE, "needs llvmlite")
+class ImportCacheTest(unittest.TestCase):
+    def setUp(self):
+        from fast import ImportStatement
+        self.directory = Path(self.enterContext(tempfile.TemporaryDirectory(prefix="flux_cache_")))
+        self.module_path = self.directory / "shapes.fx"
+        self.module_path.write_text(MODULES["shapes.fx"], encoding='utf-8')
+        self.cache_dir = self.directory / "cache"
+        self.enterContext(mock.patch.dict(os.environ))
+        os.environ.pop("FLUX_NO_CACHE", None)
+        self.addCleanup(setattr, ImportStatement, '_import_cache', ImportStatement._import_cache)
+
+    def lower_with(self, cache: 'ImportCache') -> list:
+        """The globals of a program importing shapes.fx, parsed through cache"""
+        from fast import ImportStatement
+        ImportStatement._import_cache = cache
+        source = f'import "{self.module_path}"; def main() -> int {{ return area(2, 3); }};'
+        return sorted(fluxtest.lower(source).globals)
+
+    def test_second_build_hits(self):
+        from fcache import ImportCache
+        first = ImportCache(self.cache_dir)
+        cold = self.lower_with(first)
+        self.assertEqual((first.hits, first.misses), (0, 1))
+        self.assertEqual(len(list(self.cache_dir.glob("*.pickle"))), 1)
+        # A new compiler finds the entry on disk, and lowers the same program from it
+        second = ImportCache(self.cache_dir)
+        self.assertEqual(self.lower_with(second), cold)
+        self.assertEqual((second.hits, second.misses), (1, 0))
+
+    def test_edited_module_misses(self):
+        from fcache import ImportCache
+        self.lower_with(ImportCache(self.cache_dir))
+        self.module_path.write_text(MODULES["shapes.fx"] + "def unused() -> int { return 0; };", encoding='utf-8')
+        cache = ImportCache(self.cache_dir)
+        self.assertIn("unused", self.lower_with(cache))
+        self.assertEqual((cache.hits, cache.misses), (0, 1))
+        self.assertEqual(len(list(self.cache_dir.glob("*.pickle"))), 2)
+
+    def test_no_cache_neither_reads_nor_writes(self):
+        from fcache import ImportCache
+        self.lower_with(ImportCache(self.cache_dir))
+        disabled = [ImportCache(self.cache_dir, enabled=False)]  # What --no-cache builds
+        with mock.patch.dict(os.environ, FLUX_NO_CACHE="1"):
+            disabled.append(ImportCache(self.cache_dir))
+        for cache in disabled:
+            self.assertFalse(cache.enabled)
+            self.assertIn("area", self.lower_with(cache))
+            self.assertEqual((cache.hits, cache.misses), (0, 0))
+        self.assertEqual(len(list(self.cache_dir.glob("*.pickle"))), 1)
+
+@unittest.skipUnless(fluxtest.HAVE_LLVM, "needs llvmlite 0.41 or later")
+class IncrementalBuildTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = Path(self.enterContext(tempfile.TemporaryDirectory(prefix="flux_build_")))
+        for name, source in MODULES.items():
+            (self.directory / name).write_text(source, encoding='utf-8')
+        # Imports resolve against the working directory
+        self.enterContext(contextlib.chdir(self.directory))
+
+    def builder(self, build_dir: str, jobs: int = 1) -> 'IncrementalBuilder':
+        from fbuild import IncrementalBuilder
+        return IncrementalBuilder(self.directory / build_dir, fluxtest.TRIPLE, jobs=jobs)
+
+    def test_edit_rebuilds_only_the_changed_module(self):
+        entry = self.directory / "main.fx"
+        first = self.builder("build")
+        first.build(entry)
+        self.assertEqual(len(first.compiled), 3)
+        unchanged = self.builder("build")
+        unchanged.build(entry)
+        self.assertEqual((unchanged.compiled, len(unchanged.reused)), ([], 3))
+        # A new body keeps the interface, so main.fx, which imports it, is still up to date
+        counting = self.directory / "counting.fx"
+        counting.write_text(MODULES["counting.fx"].replace("total + i", "total + 2 * i"), encoding='utf-8')
+        edited = self.builder("build")
+        edited.build(entry)
+        self.assertEqual(edited.compiled, [str(counting.resolve())])
+        self.assertEqual(len(edited.reused), 2)
+
+    def test_objects_do_not_depend_on_the_job_count(self):
+        serial = self.builder("serial", jobs=1).build(self.directory / "main.fx")
+        parallel = self.builder("parallel", jobs=4).build(self.directory / "main.fx")
+        self.assertEqual([path.name for path in serial], [path.name for path in parallel])
+        for one, four in zip(serial, parallel):
+            with self.subTest(module=one.name):
+                self.assertEqual(one.read_bytes(), four.read_bytes())
+
+@unittest.skipUnless(fluxtest.HAVE_LLVM, "needs llvmlite 0.41 or later")
+class LinkTimeOptimizationTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = Path(self.enterContext(tempfile.TemporaryDirectory(prefix="flux_lto_")))
+        for name, source in MODULES.items():
+            (self.directory / name).write_text(source, encoding='utf-8')
+        (self.directory / "program.fx").write_text("""
+            import "memory.fx";
+            import "shapes.fx";
+            int32 calls = 0;
+            def main() -> int { calls = calls + 1; return area(2, 3) + calls; };
+        """, encoding='utf-8')
+        self.enterContext(contextlib.chdir(self.directory))
+
+    def test_only_main_stays_external(self):
+        from llvmlite import binding as llvm
+        from flto import link_program
+        with contextlib.redirect_stdout(io.StringIO()):
+            # -O0 keeps area from being inlined away, so its linkage shows
+            linked = link_program(self.directory / "program.fx", fluxtest.TRIPLE, 0,
+                                  self.directory / "build", root=self.directory / "libfx")
+        defined = [value for value in list(linked.functions) + list(linked.global_variables)
+                   if not value.is_declaration and not value.name.startswith('llvm.')]
+        self.assertTrue({'area', 'calls'} <= {value.name for value in defined})
+        self.assertEqual([value.name for value in defined if value.linkage != llvm.Linkage.internal], ['main'])
+
+if __name__ == "__main__":
+    unittest.main()
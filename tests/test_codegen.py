@@ -0,0 +1,985 @@
+"""
+IR-level tests for code generation
+
+Each test lowers a small program and checks the ir.Module it produces:
+which instructions, attributes, globals and metadata are there. The
+verify tests also hand the module to LLVM and need the real llvmlite.
+"""
+
+import textwrap
+import tempfile
+import unittest
+from pathlib import Path
+
+import fluxtest
+from fluxtest import ir, lower, instructions, opnames, callees, verify
+
+def constant_values(constant: 'ir.Constant') -> list:
+    """The element values of an array or vector constant"""
+    return [getattr(element, 'constant', element) for element in constant.constant]
+
+def returned(function: 'ir.Function') -> list:
+    """The values function's ret instructions return"""
+    return [instruction.operands[0] for instruction in instructions(function)
+            if instruction.opname == 'ret' and instruction.operands]
+
+class ConstantEvaluationTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        const int SIZE = 4 * 8 + 1;
+        compt {
+            const int[8] SQUARES;
+            for (int i = 0; i < 8; i++) { SQUARES[i] = i * i; };
+            assert(SQUARES[3] == 9);
+        };
+        def divide() -> int { return 1 / 0; };
+        def main() -> int { return SIZE + SQUARES[5]; };
+    """
+
+    def test_const_global_is_read_only_data(self):
+        size = self.module.get_global('SIZE')
+        self.assertTrue(size.global_constant)
+        self.assertTrue(size.unnamed_addr)
+        self.assertEqual(size.linkage, 'internal')
+        self.assertEqual(size.initializer.constant, 33)
+
+    def test_compt_block_fills_table(self):
+        squares = self.module.get_global('SQUARES')
+        self.assertTrue(squares.global_constant)
+        self.assertEqual(constant_values(squares.initializer), [i * i for i in range(8)])
+
+    def test_uses_fold(self):
+        main = self.module.get_global('main')
+        self.assertEqual(opnames(main), ['ret'])
+        self.assertEqual(returned(main)[0].constant, 58)
+
+    def test_division_by_zero_is_left_to_run_time(self):
+        self.assertIn('sdiv', opnames(self.module.get_global('divide')))
+
+    def test_failed_assert_stops_compilation(self):
+        with self.assertRaisesRegex(ValueError, "compt assertion failed"):
+            lower("compt { assert(1 + 1 == 3); };")
+
+class IfStatementTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        def classify(int x) -> int {
+            if (x < 0) { return 1; }
+            elif (x == 0) { return 2; }
+            elif (x < 10) { return 3; }
+            else { return 4; };
+            return 0;
+        };
+        def fallthrough(int x) -> int {
+            int y = 0;
+            if (x == 1) { y = 5; } elif (x == 2) { y = 6; };
+            return y;
+        };
+    """
+
+    def branches(self, name: str) -> list:
+        return [i for i in instructions(self.module.get_global(name))
+                if i.opname == 'br' and len(i.operands) == 3]
+
+    def test_every_elif_is_lowered(self):
+        classify = self.module.get_global('classify')
+        self.assertEqual(sorted(value.constant for value in returned(classify)), [0, 1, 2, 3, 4])
+        self.assertEqual(len(self.branches('classify')), 3)
+
+    def test_elif_is_tested_when_the_arm_before_fails(self):
+        first, second = self.branches('fallthrough')
+        # The if's false side is the block that tests the elif
+        self.assertIn(second, first.operands[2].instructions)
+        self.assertEqual(opnames(self.module.get_global('fallthrough')).count('icmp'), 2)
+
+class SignednessTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        def narrow_unsigned(int32 a, uint8 b) -> bool { return a < b; };
+        def wide_unsigned(int32 a, uint32 b) -> bool { return a < b; };
+        def wider_unsigned(int8 a, uint16 b) -> bool { return a < b; };
+        def divide(int32 a, uint8 b) -> int32 { return a / b; };
+        def divide_unsigned(int32 a, uint64 b) -> uint64 { return a / b; };
+        def nested(int32 a, uint8 b, int32 c) -> bool { return a + b < c; };
+        def folded() -> int32 { return -8 / (uint8)2; };
+        def folded_compare() -> bool { return (int32)-1 < (uint8)5; };
+    """
+
+    def compare(self, name: str) -> str:
+        return next(i.op for i in instructions(self.module.get_global(name)) if i.opname == 'icmp')
+
+    def test_narrower_unsigned_operand_converts_to_the_signed_type(self):
+        self.assertEqual(self.compare('narrow_unsigned'), 'slt')
+        # Zero-extended by its own signedness, so 5 stays 5
+        self.assertIn('zext', opnames(self.module.get_global('narrow_unsigned')))
+        self.assertIn('sdiv', opnames(self.module.get_global('divide')))
+
+    def test_unsigned_operand_as_wide_or_wider_wins(self):
+        self.assertEqual(self.compare('wide_unsigned'), 'ult')
+        self.assertEqual(self.compare('wider_unsigned'), 'ult')
+        self.assertIn('udiv', opnames(self.module.get_global('divide_unsigned')))
+
+    def test_nested_expression_keeps_the_common_type(self):
+        # a + b is int32, so comparing it with c is signed
+        self.assertEqual(self.compare('nested'), 'slt')
+
+    def test_constants_fold_the_same_way(self):
+        self.assertEqual(returned(self.module.get_global('folded'))[0].constant, -4)
+        self.assertIs(returned(self.module.get_global('folded_compare'))[0].constant, True)
+
+class VectorTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        def scale(float<4> a, float<4> b) -> float<4> { return a + b * 2.0; };
+        def total(uint32<4> v) -> uint32 { return reduce_add(v); };
+        def reverse(int32<4> v) -> int32 {
+            int32<4> w = shuffle(v, [3, 2, 1, 0]);
+            return w[0];
+        };
+        def main() -> int { return 0; };
+    """
+
+    def test_vector_types_lower_to_vectors(self):
+        scale = self.module.get_global('scale')
+        vector = scale.function_type.return_type
+        self.assertIsInstance(vector, ir.VectorType)
+        self.assertEqual(vector.count, 4)
+        self.assertIsInstance(vector.element, ir.FloatType)
+
+    def test_operators_work_lane_by_lane(self):
+        scale = self.module.get_global('scale')
+        arithmetic = [i for i in instructions(scale) if i.opname in ('fmul', 'fadd')]
+        self.assertEqual([i.opname for i in arithmetic], ['fmul', 'fadd'])
+        self.assertTrue(all(isinstance(i.type, ir.VectorType) for i in arithmetic))
+
+    def test_scalar_constant_is_splatted(self):
+        multiply = next(i for i in instructions(self.module.get_global('scale')) if i.opname == 'fmul')
+        self.assertEqual(constant_values(multiply.operands[1]), [2.0] * 4)
+
+    def test_reduction_uses_intrinsic(self):
+        self.assertEqual(callees(self.module.get_global('total')), ['llvm.vector.reduce.add.v4i32'])
+
+    def test_shuffle_and_lane_access(self):
+        reverse = self.module.get_global('reverse')
+        shuffle = next(i for i in instructions(reverse) if i.opname == 'shufflevector')
+        self.assertEqual(constant_values(shuffle.operands[2]), [3, 2, 1, 0])
+        self.assertIn('extractelement', opnames(reverse))
+
+class PointerAccessTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        struct buffer { uint8[16] bytes; uint64 used; };
+        def second(int* p) -> int { p[1] = p[0] + 1; return p[1]; };
+        def swap(int* a, int* b) -> void { int t = *a; *a = *b; *b = t; return void; };
+        def widen(uint64 n, int64 s) -> uint64 { return n; };
+        def fill(buffer* b) -> void { b.bytes[3] = 7; };
+        def puts(uint8* text) -> int32;
+        def main() -> int {
+            int32 x = -1;
+            uint8 y = 200;
+            widen(y, x);
+            return 0;
+        };
+        def greet() -> int { puts("hi\n"); char c = "A"; return 0; };
+    """
+
+    def test_index_through_pointer(self):
+        second = self.module.get_global('second')
+        geps = [i for i in instructions(second) if i.opname == 'getelementptr']
+        self.assertEqual(len(geps), 3)
+        # One index: p[i] is i elements past p, not a member of an array p points to
+        self.assertTrue(all(len(gep.operands) == 2 for gep in geps))
+        self.assertEqual(opnames(second).count('store'), 2)  # the parameter and p[1]
+
+    def test_dereference_loads_and_stores(self):
+        swap = self.module.get_global('swap')
+        self.assertEqual(opnames(swap).count('store'), 5)  # two parameters, t, *a and *b
+        # return void; returns nothing
+        self.assertEqual(opnames(swap)[-1], 'ret')
+        self.assertEqual(returned(swap), [])
+
+    def test_array_member_is_stored_in_the_struct(self):
+        buffer = self.module.context.get_identified_type('buffer')
+        self.assertEqual(buffer.elements[0], ir.ArrayType(ir.IntType(8), 16))
+        fill = self.module.get_global('fill')
+        self.assertEqual(opnames(fill).count('getelementptr'), 2)
+
+    def test_arguments_convert_to_parameter_width(self):
+        main = self.module.get_global('main')
+        widen = [i.opname for i in instructions(main) if i.opname in ('zext', 'sext')]
+        self.assertEqual(widen, ['zext', 'sext'])  # by each argument's own signedness
+        call = next(i for i in instructions(main) if i.opname == 'call')
+        self.assertEqual([arg.type for arg in call.args], [ir.IntType(64), ir.IntType(64)])
+
+    def test_string_literal_argument_is_a_c_string(self):
+        greet = self.module.get_global('greet')
+        call = next(i for i in instructions(greet) if i.opname == 'call')
+        self.assertEqual(call.args[0].type, ir.IntType(8).as_pointer())
+        strings = [g for g in self.module.global_values if isinstance(g, ir.GlobalVariable) and g.global_constant]
+        self.assertEqual([bytes(g.initializer.constant) for g in strings], [b'hi\n\0'])
+        # A string literal anywhere else is still its character
+        store = next(i for i in instructions(greet) if i.opname == 'store')
+        self.assertEqual(store.operands[0].constant, ord('A'))
+
+class DeclarationTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        def malloc(uint64 n) -> void*;
+        def malloc(uint64 n) -> void*;
+        def twice(int x) -> int;
+        def same(int* p) -> int* { return p; };
+        namespace shapes
+        {
+            struct pair { int a; int64 b; };
+            def size() -> int { return sizeof(pair); };
+        };
+        def twice(int x) -> int { return x + x; };
+        def main() -> int { return twice(shapes::size()); };
+    """
+
+    def test_returned_pointer_is_not_loaded(self):
+        same = self.module.get_global('same')
+        self.assertEqual(opnames(same).count('load'), 1)  # the parameter's slot
+        self.assertEqual(returned(same)[0].type, ir.PointerType(ir.IntType(32)))
+
+    def test_sizeof_names_a_struct_of_the_namespace(self):
+        size = self.module.get_global('shapes__size')
+        self.assertEqual(opnames(size), ['ret'])
+        self.assertEqual(returned(size)[0].constant, 96)
+
+    def test_matching_declarations_are_one_function(self):
+        functions = [g.name for g in self.module.globals.values() if isinstance(g, ir.Function)]
+        self.assertEqual(functions.count('malloc'), 1)
+        self.assertEqual(sorted(functions), ['main', 'malloc', 'same', 'shapes__size', 'twice'])
+        # The body fills in the prototype declared ahead of it
+        self.assertTrue(self.module.get_global('twice').blocks)
+
+    def test_unknown_type_is_an_error(self):
+        # Not silently an int32
+        with self.assertRaisesRegex(ValueError, "Unknown type: mystery"):
+            lower("def f() -> int { mystery x = 1; return 0; };")
+        with self.assertRaisesRegex(ValueError, "Unknown type: mystery"):
+            lower("mystery g = 1;")
+
+class LocalVariableTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        struct pair { int32 a; int32 b; };
+        def locals(int n) -> int {
+            int total = 0;
+            for (int i = 0; i < n; i++) {
+                int square = i * i;
+                pair p;
+                p.a = square;
+                if (square > 10) { int64 big = square; total = total + (int)big; };
+                total = total + p.a;
+            };
+            while (total > 100) { int half = total / 2; total = half; };
+            for (x in 0..n) { int32[4] lanes; lanes[0] = x; total = total + lanes[0]; };
+            return total;
+        };
+    """
+
+    def test_every_alloca_is_in_the_entry_block(self):
+        # mem2reg only promotes entry-block allocas, and one in a loop would grow the stack each iteration
+        entry, *rest = self.module.get_global('locals').blocks
+        self.assertEqual([i.opname for b in rest for i in b.instructions if i.opname == 'alloca'], [])
+        self.assertEqual([i.opname for i in entry.instructions].count('alloca'), 8)
+
+    def test_locals_in_loops_start_their_lifetime_where_declared(self):
+        locals_ = self.module.get_global('locals')
+        # square, p, big, half and lanes: a later iteration starts from an undefined slot
+        starts = [name for name in callees(locals_) if name.startswith('llvm.lifetime.start')]
+        self.assertEqual(len(starts), 5)
+
+class NamespaceTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        namespace outer {
+            namespace inner {
+                int32 depth = 2;
+                def twice(int32 x) -> int32 { return x * 2; };
+            };
+            namespace user {
+                def depth_of() -> int32 { return inner::depth; };
+                def call_inner() -> int32 { return inner::twice(depth_of()); };
+            };
+        };
+        using outer::inner;
+        def main() -> int32 {
+            int32 x = 1;
+            { int32 x = twice(outer::inner::depth); };
+            return x + outer::user::call_inner();
+        };
+    """
+
+    def loaded(self, name: str) -> list:
+        return [i.operands[0].name for i in instructions(self.module.get_global(name)) if i.opname == 'load']
+
+    def test_members_are_emitted_under_mangled_names(self):
+        self.assertEqual(sorted(self.module.globals), ['main', 'outer__inner__depth', 'outer__inner__twice',
+                                                       'outer__user__call_inner', 'outer__user__depth_of'])
+
+    def test_qualified_names_resolve_from_the_current_namespace_outward(self):
+        # inner:: is not inside outer::user, so the lookup finds it in outer
+        self.assertEqual(self.loaded('outer__user__depth_of'), ['outer__inner__depth'])
+        self.assertEqual(callees(self.module.get_global('outer__user__call_inner')),
+                         ['outer__user__depth_of', 'outer__inner__twice'])
+        self.assertEqual(callees(self.module.get_global('main')), ['outer__inner__twice', 'outer__user__call_inner'])
+        with self.assertRaisesRegex(NameError, "Unknown namespace: nowhere"):
+            lower("def main() -> int32 { return nowhere::f(); };")
+
+    def test_using_aliases_members(self):
+        # Members defined after the using are aliased too
+        later = lower("""
+            using later;
+            namespace later { def one() -> int32 { return 1; }; };
+            def main() -> int32 { return one(); };
+        """)
+        self.assertEqual(callees(later.get_global('main')), ['later__one'])
+        # A name the module defines itself wins over the alias
+        own = lower(self.SOURCE.replace("def main()", "def twice(int32 x) -> int32 { return x; };\n def main()"))
+        self.assertEqual(callees(own.get_global('main')), ['twice', 'outer__user__call_inner'])
+
+    def test_blocks_scope_their_declarations(self):
+        main = self.module.get_global('main')
+        # The inner x shadows the outer one only inside its block, so return x reads the first
+        slots = [i for i in instructions(main) if i.opname == 'alloca']
+        self.assertEqual(len(slots), 2)
+        self.assertEqual([i.operands[0] for i in instructions(main) if i.opname == 'load' and i.operands[0] in slots],
+                         slots[:1])
+        with self.assertRaisesRegex(NameError, "Unknown identifier: y"):
+            lower("def main() -> int32 { { int32 y = 1; }; return y; };")
+
+class LoopTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        int32[64] samples;
+        def total() -> int32 {
+            int32 sum = 0;
+            for (x in samples) vectorize(8) { sum = sum + x; };
+            return sum;
+        };
+        def count(int n) -> int {
+            int sum = 0;
+            for (i in 0..n) unroll(4) { sum = sum + i; };
+            for (int j = 0; j < n; j++) unroll(0) vectorize(1) { sum = sum + j; };
+            return sum;
+        };
+    """
+
+    def loop_hints(self, name: str) -> list:
+        """Each loop's !llvm.loop properties, as (name, value) pairs in backedge order"""
+        loops = []
+        for instruction in instructions(self.module.get_global(name)):
+            loop_id = getattr(instruction, 'metadata', {}).get('llvm.loop')
+            if loop_id is None:
+                continue
+            self.assertIs(loop_id.operands[0], loop_id)  # Distinct and self-referencing
+            loops.append([(prop.operands[0].string, getattr(prop.operands[1], 'constant', None)
+                           if len(prop.operands) > 1 else None) for prop in loop_id.operands[1:]])
+        return loops
+
+    def test_induction_variable_is_a_phi(self):
+        for name in ('total', 'count'):
+            with self.subTest(function=name):
+                header = next(b for b in self.module.get_global(name).blocks if b.name.startswith('for.cond'))
+                self.assertEqual(header.instructions[0].opname, 'phi')
+        # Only the sums and the C-style counter have slots: no memory for x or i
+        allocas = [i for i in instructions(self.module.get_global('count')) if i.opname == 'alloca']
+        self.assertEqual(len(allocas), 3)  # n, sum, j
+
+    def test_hints_become_loop_metadata(self):
+        self.assertEqual(self.loop_hints('total'),
+                         [[('llvm.loop.vectorize.enable', True), ('llvm.loop.vectorize.width', 8)]])
+        self.assertEqual(self.loop_hints('count'),
+                         [[('llvm.loop.unroll.count', 4)],
+                          [('llvm.loop.unroll.full', None), ('llvm.loop.vectorize.enable', False)]])
+
+class SwitchTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        def classify(int x) -> int {
+            int kind = 0;
+            switch (x) {
+                case (1) { kind = 10; };
+                case (2) { kind = 20; break; };
+                case (5) { return 50; };
+                case (-3) { kind = 30; };
+                default { kind = -1; };
+            };
+            return kind;
+        };
+    """
+
+    def test_constant_cases_are_one_switch(self):
+        classify = self.module.get_global('classify')
+        switches = [i for i in instructions(classify) if i.opname == 'switch']
+        self.assertEqual(len(switches), 1)
+        self.assertEqual([value.constant for value, _ in switches[0].cases], [1, 2, 5, -3])
+        # No compare chain in front of it
+        self.assertNotIn('icmp', opnames(classify))
+
+    def test_duplicate_case_is_an_error(self):
+        # -1 and 255 are the same uint8
+        for switched, cases in (("int", "case (1) { }; case (2) { }; case (1) { };"),
+                                ("uint8", "case (255) { }; case (-1) { };")):
+            with self.subTest(cases=cases):
+                with self.assertRaisesRegex(ValueError, "Duplicate case value"):
+                    lower(f"def f({switched} x) -> int {{ switch (x) {{ {cases} }}; return 0; }};")
+
+class StructLayoutTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        struct plain { uint8 tag; int32 id; uint16 flags; };
+        struct aligned { uint8 tag; unsigned data{32:32} id; uint16 flags; };
+        struct sorted align(64) reorder { uint8 tag; unsigned data{32:32} id; uint16 flags; };
+        struct outer { plain inner; uint8 last; };
+        struct later;
+        def plain_size() -> int { return sizeof(plain); };
+        def aligned_size() -> int { return sizeof(aligned); };
+        def aligned_align() -> int { return alignof(aligned); };
+        def sorted_align() -> int { return alignof(sorted); };
+    """
+
+    def struct(self, name: str) -> 'ir.IdentifiedStructType':
+        return self.module.context.identified_types[name]
+
+    def test_structs_are_identified_packed_types(self):
+        for name in ('plain', 'aligned', 'sorted', 'outer'):
+            with self.subTest(struct=name):
+                self.assertIsInstance(self.struct(name), ir.IdentifiedStructType)
+                self.assertTrue(self.struct(name).packed)
+        self.assertEqual(list(self.struct('outer').elements), [self.struct('plain'), ir.IntType(8)])
+        self.assertTrue(self.struct('later').is_opaque)
+
+    def test_members_follow_each_other_unless_aligned(self):
+        self.assertEqual(list(self.struct('plain').elements), [ir.IntType(8), ir.IntType(32), ir.IntType(16)])
+        self.assertEqual(self.struct('plain').layout.offsets, {'tag': 0, 'id': 1, 'flags': 5})
+        # data{32:32} pads up to a 4-byte boundary, and the tail pads to the struct's alignment
+        pad = lambda n: ir.ArrayType(ir.IntType(8), n)
+        self.assertEqual(list(self.struct('aligned').elements),
+                         [ir.IntType(8), pad(3), ir.IntType(32), ir.IntType(16), pad(2)])
+        self.assertEqual(self.struct('aligned').layout.offsets, {'tag': 0, 'id': 4, 'flags': 8})
+
+    def test_reorder_drops_padding(self):
+        self.assertEqual(self.struct('sorted').layout.offsets, {'id': 0, 'flags': 4, 'tag': 6})
+        self.assertEqual((self.struct('sorted').layout.size, self.struct('sorted').layout.align), (8, 8))
+
+    def test_sizeof_and_alignof_fold_to_bits(self):
+        for name, bits in (('plain_size', 56), ('aligned_size', 96), ('aligned_align', 32), ('sorted_align', 64)):
+            with self.subTest(function=name):
+                function = self.module.get_global(name)
+                self.assertEqual(opnames(function), ['ret'])
+                self.assertEqual(returned(function)[0].constant, bits)
+
+class FunctionAttributeTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        const def square(int x) -> int { return x * x; };
+        const def first(int* p) -> int { return p[0]; };
+        def helper(int x) -> int { return x + 1; };
+        def callback(int x) -> int { return x; };
+        object Counter
+        {
+            int count;
+
+            def bump(int* other) -> int
+            {
+                this.count = this.count + other[0];
+                return this.count;
+            };
+        };
+        def main() -> int {
+            void* handler = @callback;
+            return helper(square(3));
+        };
+    """
+
+    def test_const_functions_are_pure(self):
+        square = self.module.get_global('square')
+        self.assertIn('readnone', square.attributes)
+        self.assertIn('nounwind', square.attributes)
+        # Reads through its pointer argument: readonly, not readnone
+        first = self.module.get_global('first')
+        self.assertIn('readonly', first.attributes)
+        self.assertNotIn('readnone', first.attributes)
+
+    def test_const_is_checked_not_trusted(self):
+        with self.assertRaisesRegex(ValueError, "writes to memory"):
+            lower("int counter = 0; const def f(int x) -> int { counter = x; return x; };")
+        with self.assertRaisesRegex(ValueError, "not const"):
+            lower("def g(int x) -> int { return x; }; const def f(int x) -> int { return g(x); };")
+
+    def test_internal_functions_use_fastcc(self):
+        helper = self.module.get_global('helper')
+        self.assertEqual(helper.linkage, 'internal')
+        self.assertEqual(helper.calling_convention, 'fastcc')
+        main = self.module.get_global('main')
+        self.assertEqual(main.linkage, '')
+        self.assertEqual(main.calling_convention, '')
+
+    def test_address_taken_functions_keep_c_convention(self):
+        self.assertEqual(self.module.get_global('callback').calling_convention, '')
+
+    def test_method_this_is_nonnull_and_sized(self):
+        this = self.module.get_global('Counter__bump').args[0]
+        self.assertIn('nonnull', this.attributes)
+        self.assertEqual(this.attributes.dereferenceable, 4)
+        # other may point into the object, so this cannot be noalias
+        self.assertNotIn('noalias', this.attributes)
+
+class MemoryTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        import "memory.fx";
+        using standard::memory;
+        def malloc(uint64 size) -> void*;
+        unsigned data{8}[4096] scratch;
+        arena request;
+        pool nodes;
+        def bump() -> uint64 {
+            void* node = arena_alloc(request, 48);
+            (void)node;
+            return (uint64)node;
+        };
+        def recycle() -> void {
+            void* block = pool_alloc(nodes);
+            (void)block;
+            return void;
+        };
+        def heap() -> void {
+            void* p = malloc(16);
+            (void)p;
+            return void;
+        };
+        def main() -> int {
+            arena_init(request, scratch, 4096);
+            pool_init(nodes, scratch, 32, 64);
+            return 0;
+        };
+    """
+
+    def test_arena_alloc_is_an_inline_bump(self):
+        bump = self.module.get_global('bump')
+        self.assertEqual(callees(bump), [])
+        # Align up, check against the limit, move the cursor
+        for opname in ('and', 'icmp', 'select', 'store'):
+            self.assertIn(opname, opnames(bump))
+
+    def test_void_on_arena_memory_does_nothing(self):
+        # No free(): the arena takes the node back when it resets, so
+        # storing node is followed straight by the return's load of it
+        self.assertEqual(opnames(self.module.get_global('bump'))[-4:], ['store', 'load', 'ptrtoint', 'ret'])
+
+    def test_void_on_a_pool_block_pushes_it_on_the_free_list(self):
+        recycle = self.module.get_global('recycle')
+        self.assertEqual(callees(recycle), [])
+        # pool_alloc takes the head of the free list when there is one
+        head = next(i for i in instructions(recycle) if i.opname == 'phi')
+        self.assertEqual(len(head.incomings), 2)
+        # (void) links the block in as the new head
+        pushed = [i for i in instructions(recycle)
+                  if i.opname == 'store' and getattr(i.operands[0], 'opname', None) == 'ptrtoint']
+        self.assertEqual(len(pushed), 1)
+
+    def test_void_on_heap_memory_frees_it(self):
+        self.assertEqual(callees(self.module.get_global('heap')), ['malloc', 'free'])
+
+    def test_void_on_a_pointer_of_unknown_origin_is_an_error(self):
+        for source in ("def f(void* p) -> void { (void)p; return void; };",
+                       "struct holder { void* p; }; def f(holder* h) -> void { (void)h.p; return void; };"):
+            with self.subTest(source=source):
+                with self.assertRaisesRegex(ValueError, "cannot tell where"):
+                    lower(source)
+
+class ComprehensionTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        int[5] DOUBLED = [x * 2 for (x in 0..4)];
+        def full() -> int {
+            int[10] squares = [x * x for (x in 0..9)];
+            return squares[3];
+        };
+        def filtered(bool wanted) -> int {
+            int[10] evens;
+            if (wanted) { evens = [x for (x in 0..9) if (x % 2 == 0)]; };
+            int total = 0;
+            for (y in evens) { total = total + y; };
+            return total;
+        };
+        def main() -> int { return full() + filtered(true); };
+    """
+
+    def array_allocas(self, function: 'ir.Function') -> list:
+        return [i for i in instructions(function)
+                if isinstance(i, ir.AllocaInstr) and isinstance(i.type.pointee, ir.ArrayType)]
+
+    def test_global_comprehension_folds(self):
+        self.assertEqual(constant_values(self.module.get_global('DOUBLED').initializer), [0, 2, 4, 6, 8])
+
+    def test_stores_straight_into_destination(self):
+        full = self.module.get_global('full')
+        self.assertEqual(len(self.array_allocas(full)), 1)  # No temporary
+        self.assertEqual(callees(full), [])                 # No append, no memset
+
+    def test_filtered_tail_is_zeroed(self):
+        filtered = self.module.get_global('filtered')
+        self.assertEqual(len(self.array_allocas(filtered)), 1)
+        self.assertTrue(any(name.startswith('llvm.memset') for name in callees(filtered)))
+
+    def test_length_is_set_on_every_path(self):
+        # The for-in over evens reads how many elements were written, also
+        # when the comprehension did not run; that slot must be stored
+        # before the first branch
+        filtered = self.module.get_global('filtered')
+        entry = filtered.blocks[0].instructions
+        lengths = [i for i in entry if isinstance(i, ir.AllocaInstr) and i.type.pointee == ir.IntType(64)]
+        self.assertTrue(lengths)
+        stored = {i.operands[1] for i in entry if i.opname == 'store'}
+        for length in lengths:
+            self.assertIn(length, stored)
+
+    def test_unsigned_bound_counts_unsigned(self):
+        # 0..N runs 201 times; read signed, the uint8 200 is -56 and the array empty
+        module = lower("""
+            const uint8 FIRST = 0;
+            const uint8 N = 200;
+            int[] SPREAD = [x for (x in FIRST..N)];
+            def local() -> int {
+                int[] values = [x for (x in 0..N)];
+                return values[200];
+            };
+        """)
+        self.assertEqual(constant_values(module.get_global('SPREAD').initializer), list(range(201)))
+        self.assertEqual(self.array_allocas(module.get_global('local'))[0].type.pointee.count, 201)
+
+@unittest.skipUnless(fluxtest.HAVE_LLVMLITE, "needs llvmlite")
+class ProfileTest(unittest.TestCase):
+    SOURCE = """
+        def pick(int x) -> int {
+            if (x > 2) { return 1; };
+            while (x > 0) { x = x - 1; };
+            return 0;
+        };
+        def never() -> int { return 0; };
+        def main() -> int { return pick(5); };
+    """
+
+    def setUp(self):
+        self.directory = Path(self.enterContext(tempfile.TemporaryDirectory(prefix="flux_profile_")))
+
+    def run_profile(self, name: str, lines: str) -> Path:
+        """A raw profile as one run of the instrumented program appends it"""
+        path = self.directory / name
+        path.write_text(textwrap.dedent(lines), encoding='utf-8')
+        return path
+
+    def weights(self, module: 'ir.Module', function: str) -> list:
+        """The !prof branch_weights of function's conditional branches, in order"""
+        weights = []
+        for instruction in instructions(module.get_global(function)):
+            prof = getattr(instruction, 'metadata', {}).get('prof')
+            if instruction.opname == 'br' and prof is not None:
+                self.assertEqual(prof.operands[0].string, 'branch_weights')
+                weights.append([operand.constant for operand in prof.operands[1:]])
+        return weights
+
+    def test_instrumented_build_counts_calls_and_branches(self):
+        module = lower(self.SOURCE, pgo_generate=True)
+        pair = ir.ArrayType(ir.IntType(64), 2)
+        counters = {name for name, value in module.globals.items() if value.type.pointee == pair}
+        self.assertEqual(counters, {'__flux_prof.pick', '__flux_prof.pick:if0', '__flux_prof.pick:while1',
+                                    '__flux_prof.never', '__flux_prof.main'})
+        # Each branch adds one execution and its condition, zero-extended, as taken
+        self.assertEqual(opnames(module.get_global('pick')).count('zext'), 2)
+        # A global constructor registers the writer, which runs at exit
+        ctors = module.get_global('llvm.global_ctors')
+        register = ctors.initializer.constant[0].constant[1]
+        self.assertEqual(callees(register), ['atexit'])
+        writer = register.blocks[0].instructions[0].args[0]
+        self.assertEqual(callees(writer).count('fprintf'), 5)  # A line per function and per branch
+        plain = lower(self.SOURCE)
+        self.assertEqual([name for name in plain.globals if name.startswith('__flux_prof')], [])
+
+    def test_merged_profile_weights_branches(self):
+        from fprofile import merge_profiles, read_profile
+        first = self.run_profile("first.fxprofraw", """
+            F main 1 0
+            F never 0 0
+            F pick 1 2
+            B pick:if0 1 1
+            B pick:while1 0 0
+        """)
+        second = self.run_profile("second.fxprofraw", """
+            F main 3 0
+            F never 0 0
+            F pick 3 2
+            B pick:if0 3 0
+            B pick:while1 12 9
+        """)
+        merged = merge_profiles([first, second])
+        self.assertEqual(merged.functions['pick'], (4, 2))
+        self.assertEqual(merged.branches, {'pick:if0': (4, 1), 'pick:while1': (12, 9)})
+        merged.write(self.directory / "merged.fxprofdata")
+        profile = read_profile(self.directory / "merged.fxprofdata")
+        self.assertEqual((profile.functions, profile.branches), (merged.functions, merged.branches))
+
+        module = lower(self.SOURCE, profile=profile)
+        # Taken and not taken, each plus one
+        self.assertEqual(self.weights(module, 'pick'), [[2, 4], [10, 4]])
+        self.assertIn('cold', module.get_global('never').attributes)
+
+    def test_stale_profile_is_ignored(self):
+        from fprofile import read_profile
+        stale = self.run_profile("stale.fxprofdata", """
+            F pick 4 1
+            B pick:if0 4 1
+        """)
+        module = lower(self.SOURCE, profile=read_profile(stale))
+        self.assertEqual(self.weights(module, 'pick'), [])
+
+    @unittest.skipUnless(fluxtest.HAVE_LLVM, "needs llvmlite 0.41 or later")
+    def test_instrumented_build_verifies(self):
+        verify(lower(self.SOURCE, pgo_generate=True))
+
+def object_code(module: 'ir.Module') -> bytes:
+    """module compiled to a native object by LLVM"""
+    from fbackend import FluxBackend
+    backend = FluxBackend(module.triple)
+    llvm_module = verify(module)
+    backend.optimize(llvm_module)
+    return backend.emit_object(llvm_module)
+
+class ExceptionTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        def fail(int x) -> int { if (x > 2) { throw(x); }; return x; };
+        def quiet(int x) -> int { return x + 1; };
+        def main() -> int {
+            try { fail(5); }
+            catch (int e) { return e; };
+            return quiet(0);
+        };
+    """
+
+    def test_throw_uses_cxx_runtime(self):
+        fail = self.module.get_global('fail')
+        self.assertEqual(callees(fail), ['__cxa_allocate_exception', '__cxa_throw'])
+        self.assertNotIn('nounwind', fail.attributes)
+
+    def test_try_lowers_to_invoke_and_landing_pad(self):
+        main = self.module.get_global('main')
+        self.assertEqual(main.attributes.personality.name, '__gxx_personality_v0')
+        for opname in ('invoke', 'landingpad', 'resume'):
+            self.assertIn(opname, opnames(main))
+        self.assertIn('llvm.eh.typeid.for', callees(main))
+
+    def test_catch_type_has_type_info(self):
+        self.assertEqual(self.module.get_global('__flux_typeinfo.i32').linkage, 'linkonce_odr')
+
+    def test_functions_that_cannot_throw_are_nounwind(self):
+        self.assertIn('nounwind', self.module.get_global('quiet').attributes)
+
+    def test_const_functions_cannot_throw(self):
+        with self.assertRaisesRegex(ValueError, "cannot throw"):
+            lower("const def f(int x) -> int { throw(x); return 0; };")
+
+    @unittest.skipUnless(fluxtest.HAVE_LLVM, "needs llvmlite 0.41 or later")
+    def test_object_has_unwind_tables(self):
+        self.assertIn(b'.gcc_except_table', object_code(self.module))
+
+@unittest.skipUnless(fluxtest.HAVE_LLVMLITE, "needs llvmlite")
+class DebugInfoTest(unittest.TestCase):
+    SOURCE = """
+        def add(int a, int b) -> int {
+            int sum = a + b;
+            return sum;
+        };
+        def main() -> int { return add(1, 2); };
+    """
+
+    def test_compile_unit_and_subprograms(self):
+        module = lower(self.SOURCE, debug_info=True)
+        self.assertEqual(len(module.get_named_metadata('llvm.dbg.cu').operands), 1)
+        for function in (module.get_global('add'), module.get_global('main')):
+            self.assertIn('dbg', function.metadata)
+
+    def test_every_instruction_has_a_line(self):
+        module = lower(self.SOURCE, debug_info=True)
+        for function in (module.get_global('add'), module.get_global('main')):
+            for instruction in instructions(function):
+                self.assertIn('dbg', instruction.metadata, f"{function.name}: {instruction.opname}")
+
+    def test_no_debug_info_without_g(self):
+        module = lower(self.SOURCE)
+        with self.assertRaises(KeyError):
+            module.get_named_metadata('llvm.dbg.cu')
+
+    def test_frame_pointers(self):
+        module = lower(self.SOURCE, frame_pointers=True)
+        self.assertIn('"frame-pointer"="all"', module.get_global('add').attributes)
+
+    def test_instrument_functions(self):
+        module = lower(self.SOURCE, instrument_functions=True)
+        # llvm.returnaddress supplies the hooks' call site
+        calls = [name for name in callees(module.get_global('add')) if not name.startswith('llvm.')]
+        self.assertEqual(calls[0], '__cyg_profile_func_enter')
+        self.assertEqual(calls[-1], '__cyg_profile_func_exit')
+
+    @unittest.skipUnless(fluxtest.HAVE_LLVM, "needs llvmlite 0.41 or later")
+    def test_verifies(self):
+        verify(lower(self.SOURCE, debug_info=True, frame_pointers=True, instrument_functions=True))
+
+    @unittest.skipUnless(fluxtest.HAVE_LLVM, "needs llvmlite 0.41 or later")
+    def test_object_has_line_table(self):
+        self.assertIn(b'.debug_line', object_code(lower(self.SOURCE, debug_info=True)))
+
+class ObjectTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        object counter {
+            int n;
+            def __init(int start) -> this { this.n = start; };
+            def bump(int by) -> int { this.n = this.n + by; return this.n; };
+            def __exit() -> void { return void; };
+        };
+        def block_end() -> int {
+            int total = 0;
+            { counter c(5); total = c.bump(2); };
+            return total;
+        };
+        def early(int x) -> int {
+            counter c(x);
+            if (x > 2) { return 1; };
+            return c.bump(1);
+        };
+        def loop() -> int {
+            int i = 0;
+            while (i < 10) {
+                counter c(i);
+                if (i > 5) { break; };
+                i = i + 1;
+            };
+            return i;
+        };
+        def by_hand() -> int {
+            counter c(1);
+            c.__exit();
+            return 0;
+        };
+    """
+
+    def test_init_runs_at_the_declaration_and_returns_this(self):
+        init = self.module.get_global('counter____init')
+        self.assertEqual(init.function_type.return_type.pointee.name, 'counter')
+        self.assertEqual(callees(self.module.get_global('block_end'))[0], 'counter____init')
+
+    def test_exit_runs_when_the_block_ends(self):
+        block_end = self.module.get_global('block_end')
+        self.assertEqual([name for name in callees(block_end) if name.startswith('counter')],
+                         ['counter____init', 'counter__bump', 'counter____exit'])
+
+    def test_exit_runs_on_every_way_out(self):
+        # Each return and each break leaves through its own __exit
+        for name in ('early', 'loop'):
+            function = self.module.get_global(name)
+            exits = [block for block in function.blocks
+                     if block.terminator.opname in ('ret', 'br') and any(
+                         instruction.opname == 'call' and instruction.callee.name == 'counter____exit'
+                         for instruction in block.instructions)]
+            with self.subTest(function=name):
+                self.assertEqual(len(exits), 2)
+
+    def test_exit_by_hand_is_not_repeated(self):
+        self.assertEqual(callees(self.module.get_global('by_hand')).count('counter____exit'), 1)
+
+    def test_method_call_passes_the_object_address(self):
+        bump = next(instruction for instruction in instructions(self.module.get_global('block_end'))
+                    if instruction.opname == 'call' and instruction.callee.name == 'counter__bump')
+        self.assertIsInstance(bump.args[0], ir.AllocaInstr)
+
+    def test_array_members_are_stored_in_the_object(self):
+        module = lower("""
+            object buffer {
+                uint8[16] bytes;
+                def first() -> uint8* { return @this.bytes[0]; };
+            };
+        """)
+        self.assertEqual(str(module.context.get_identified_type('buffer').elements[0]), '[16 x i8]')
+
+    def test_argument_count_is_checked(self):
+        with self.assertRaisesRegex(ValueError, "argument"):
+            lower(self.SOURCE + "def bad() -> int { counter c(1, 2); return 0; };")
+        with self.assertRaisesRegex(NameError, "no method"):
+            lower(self.SOURCE + "def bad() -> int { counter c(1); return c.reset(); };")
+
+class CollectionsTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        import "collections.fx";
+        using standard::collections;
+        struct point { int32 x; int32 y; };
+        def main() -> int {
+            array points(sizeof(point) / 8);
+            point* p = (point*)points.emplace();
+            p.x = 1;
+            hash_map seen;
+            seen.insert(7, 1);
+            small_array few(4);
+            few.push((uint8*)p);
+            if (seen.contains(7)) { return p.x; };
+            return 0;
+        };
+    """
+    PREFIX = 'standard__collections__'
+
+    def test_containers_are_objects(self):
+        for name in ('array', 'small_array', 'hash_map'):
+            with self.subTest(container=name):
+                for method in ('__init', '__exit'):
+                    self.assertIsInstance(self.module.get_global(f"{self.PREFIX}{name}__{method}"), ir.Function)
+
+    def test_every_way_out_frees_the_containers(self):
+        calls = [name[len(self.PREFIX):] for name in callees(self.module.get_global('main'))
+                 if name.startswith(self.PREFIX)]
+        inits = [name for name in calls if name.endswith('____init')]
+        exits = [name for name in calls if name.endswith('____exit')]
+        self.assertEqual(inits, ['array____init', 'hash_map____init', 'small_array____init'])
+        # Both returns destroy all three, the last declared first
+        self.assertEqual(exits, ['small_array____exit', 'hash_map____exit', 'array____exit'] * 2)
+
+    def test_exit_frees_the_allocation(self):
+        for name in ('array', 'small_array', 'hash_map'):
+            with self.subTest(container=name):
+                self.assertIn('free', callees(self.module.get_global(f"{self.PREFIX}{name}____exit")))
+
+class IoTest(fluxtest.ModuleTestCase):
+    SOURCE = """
+        import "io.fx";
+        using standard::io;
+        def main() -> int {
+            print("name? ");
+            uint8* name = readline();
+            mapped_file file("input.txt");
+            slice record;
+            while (file.next(',', @record)) { stdout.write(record.bytes, record.length); };
+            println(name);
+            return 0;
+        };
+    """
+    PREFIX = 'standard__io__'
+
+    def method(self, name: str) -> 'ir.Function':
+        return self.module.get_global(self.PREFIX + name)
+
+    def test_print_takes_a_string(self):
+        for name in ('print', 'println', 'eprint'):
+            with self.subTest(function=name):
+                self.assertEqual(list(self.method(name).function_type.args), [ir.IntType(8).as_pointer()])
+        self.assertIn('strlen', callees(self.method('print')))
+
+    def test_readline_returns_the_line(self):
+        self.assertEqual(self.method('readline').function_type.return_type, ir.IntType(8).as_pointer())
+
+    def test_exit_releases_what_init_acquired(self):
+        self.assertIn('mmap', callees(self.method('mapped_file____init')))
+        self.assertIn('munmap', callees(self.method('mapped_file____exit')))
+        self.assertIn('malloc', callees(self.method('reader____init')))
+        self.assertIn('free', callees(self.method('reader____exit')))
+        self.assertIn('writer__flush', [name[len(self.PREFIX):] for name in callees(self.method('writer____exit'))])
+        self.assertIn(self.PREFIX + 'mapped_file____exit', callees(self.module.get_global('main')))
+
+    def test_constants_fold(self):
+        for name in ('EINTR', 'MADV_SEQUENTIAL', 'MADV_WILLNEED'):
+            with self.subTest(constant=name):
+                self.assertTrue(self.module.get_global(self.PREFIX + name).global_constant)
+        loads = [i for i in instructions(self.method('reader__refill')) if i.opname == 'load'
+                 and getattr(i.operands[0], 'name', '') == self.PREFIX + 'EINTR']
+        self.assertEqual(loads, [])
+
+if __name__ == "__main__":
+    unittest.main()
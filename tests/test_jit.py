@@ -0,0 +1,169 @@
+"""
+Tests for fc.py --run and the compile server
+
+These compile and execute programs with MCJIT, so they need the real
+llvmlite (0.41 or later) and are skipped without it.
+"""
+
+import io
+import os
+import sys
+import stat
+import time
+import tempfile
+import unittest
+import subprocess
+import contextlib
+from pathlib import Path
+
+import fluxtest
+
+def write_program(directory: Path, name: str, source: str) -> Path:
+    path = directory / f"{name}.fx"
+    path.write_text(source, encoding='utf-8')
+    return path
+
+@unittest.skipUnless(fluxtest.HAVE_LLVM, "needs llvmlite 0.41 or later")
+class RunTest(unittest.TestCase):
+    def setUp(self):
+        from fc import FluxCompiler
+        self.directory = Path(self.enterContext(tempfile.TemporaryDirectory(prefix="flux_jit_")))
+        self.compiler = FluxCompiler(use_cache=False)
+
+    def run_program(self, name: str, source: str) -> int:
+        return self.compiler.run_file(str(write_program(self.directory, name, source)))
+
+    def test_returns_main_status(self):
+        self.assertEqual(self.run_program("seven", "def main() -> int { return 7; };"), 7)
+
+    def test_catches_exceptions(self):
+        source = """
+            def fail(int x) -> int { if (x > 2) { throw(x); }; return x; };
+            def main() -> int {
+                try { fail(5); }
+                catch (int e) { return e; };
+                return 0;
+            };
+        """
+        self.assertEqual(self.run_program("catch", source), 5)
+
+    def test_second_run_reuses_code_and_starts_fresh(self):
+        from fjit import cached_program
+        source = """
+            int runs = 0;
+            def main() -> int { runs = runs + 1; return runs; };
+        """
+        path = write_program(self.directory, "counter", source)
+        self.assertEqual(self.compiler.run_file(str(path)), 1)
+        program = cached_program(path, self.compiler.opt_level, self.compiler.codegen_options)
+        self.assertIsNotNone(program)
+        # Each run is a child of the compiler, so globals never carry over
+        self.assertEqual(self.compiler.run_file(str(path)), 1)
+        self.assertIs(cached_program(path, self.compiler.opt_level, self.compiler.codegen_options), program)
+
+    def test_exit_and_abort_end_only_the_program(self):
+        exits = """
+            def exit(int32 status) -> void;
+            def main() -> int { exit(3); return 0; };
+        """
+        aborts = """
+            def abort() -> void;
+            def main() -> int { abort(); return 0; };
+        """
+        self.assertEqual(self.run_program("exits", exits), 3)
+        with contextlib.redirect_stderr(io.StringIO()):
+            self.assertEqual(self.run_program("aborts", aborts), 128 + 6)  # SIGABRT
+        self.assertEqual(self.run_program("after", "def main() -> int { return 0; };"), 0)
+
+@unittest.skipUnless(fluxtest.HAVE_LLVM, "needs llvmlite 0.41 or later")
+class RecordInputTest(unittest.TestCase):
+    # 100-byte records, 2 MB in all: twice the reader's 1 MiB buffer, and
+    # 1 MiB is not a whole number of records, so one straddles the refill
+    RECORDS = 20000
+    PROGRAM = """
+        import "io.fx";
+        using standard::io;
+
+        def check(slice* record, uint64 index) -> bool {
+            if (record.length != 99) { return false; };
+            uint8 expected = (uint8)(97 + index % 26);
+            return record.bytes[0] == expected and record.bytes[98] == expected;
+        };
+
+        def main() -> int {
+            slice record;
+            uint64 mapped = 0;
+            {
+                mapped_file file("PATH");
+                if (not file.is_open()) { return 1; };
+                while (file.next('\\n', @record)) {
+                    if (not check(@record, mapped)) { return 2; };
+                    mapped = mapped + 1;
+                };
+            };
+            uint64 streamed = 0;
+            reader records(open("PATH", 0));
+            while (records.next(@record)) {
+                if (not check(@record, streamed)) { return 3; };
+                streamed = streamed + 1;
+            };
+            if (mapped != COUNT) { return 4; };
+            if (streamed != COUNT) { return 5; };
+            return 0;
+        };
+    """
+
+    def setUp(self):
+        from fc import FluxCompiler
+        self.directory = Path(self.enterContext(tempfile.TemporaryDirectory(prefix="flux_records_")))
+        self.compiler = FluxCompiler(use_cache=False)
+
+    def test_maps_and_streams_records_past_the_refill(self):
+        records = self.directory / "records.txt"
+        records.write_bytes(b"".join(bytes([97 + i % 26]) * 99 + b"\n" for i in range(self.RECORDS)))
+        self.assertGreater(records.stat().st_size, 1 << 20)
+        source = self.PROGRAM.replace("PATH", str(records)).replace("COUNT", str(self.RECORDS))
+        self.assertEqual(self.compiler.run_file(str(write_program(self.directory, "records", source))), 0)
+
+@unittest.skipUnless(fluxtest.HAVE_LLVM and hasattr(os, 'fork'), "needs llvmlite 0.41 or later and fork")
+class ServerTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = Path(self.enterContext(tempfile.TemporaryDirectory(prefix="flux_server_")))
+        self.env = dict(os.environ, FLUX_SERVER_SOCKET=str(self.directory / "server.sock"))
+        self.server = subprocess.Popen([sys.executable, str(fluxtest.COMPILER_DIR / "fc.py"), "--server"],
+                                       env=self.env, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        self.addCleanup(self.stop)
+        deadline = time.monotonic() + 60
+        while not (self.directory / "server.sock").exists():
+            if self.server.poll() is not None or time.monotonic() > deadline:
+                self.fail("The compile server did not start")
+            time.sleep(0.05)
+
+    def stop(self):
+        self.client("--stop")
+        try:
+            self.server.wait(timeout=30)
+        except subprocess.TimeoutExpired:
+            self.server.kill()
+
+    def client(self, *args) -> subprocess.CompletedProcess:
+        return subprocess.run([sys.executable, str(fluxtest.COMPILER_DIR / "fserver.py"), *args],
+                              env=self.env, cwd=self.directory, capture_output=True, text=True, timeout=120)
+
+    def test_socket_is_owner_only(self):
+        self.assertEqual(stat.S_IMODE((self.directory / "server.sock").stat().st_mode), 0o600)
+
+    def test_server_survives_a_program_that_exits(self):
+        exits = write_program(self.directory, "exits", """
+            def exit(int32 status) -> void;
+            def main() -> int { exit(3); return 0; };
+        """)
+        returns = write_program(self.directory, "returns", "def main() -> int { return 4; };")
+        self.assertEqual(self.client(str(exits), "--run").returncode, 3)
+        self.assertIsNone(self.server.poll())
+        self.assertEqual(self.client(str(exits), "--run").returncode, 3)
+        self.assertEqual(self.client(str(returns), "--run").returncode, 4)
+        self.assertIsNone(self.server.poll())
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,88 @@
+"""
+Differential tests for the lexer
+
+FluxLexer.tokenize is the regex and table driven fast path;
+tokenize_reference is the original character walker. They must agree
+token for token, positions included, on every Flux file in the tree, on
+the benchmark programs, on random token soup and on truncated sources
+that end inside a comment, string or number.
+"""
+
+import io
+import random
+import unittest
+import contextlib
+
+import fluxtest
+import generate
+from flexer import (FluxLexer, check_tokenizers, KEYWORDS, SINGLE_CHAR_TOKENS,
+                    TWO_CHAR_OPERATORS, THREE_CHAR_OPERATORS)
+
+# Literals and lexemes at the edges of the fast path's regexes
+FRAGMENTS = [
+    "0", "42", "3.14", "1.", ".5", "1.2.3", "0x", "0xFFff", "0x1g", "0b", "0b1012", "007",
+    "'a'", "'\\n'", "'\\''", "''", "'ab'", "\"\"", "\"a\\tb\\\"c\"", "\"\\x41\"", "\"unterminated",
+    "f\"x {y} z\"", "f\"{a}{b}\"", "f\"{\"", "i\"{a}:{b}\":{x;y;}", "i\"\"",
+    "// line comment\n", "/* block */", "/* unterminated", "/**/", "/* a /* b */",
+    "Σ0", "σ1", "_x", "x_1", "٣", "é", "\t", "\r\n", "\n\n", "  ",
+    "@", "$", "`", "\\", "#", "?", "~", "!", "^^", "^^=", "->", "::", "..", "...",
+]
+
+def tokens_of(source: str, reference: bool) -> list:
+    lexer = FluxLexer(source)
+    return lexer.tokenize_reference() if reference else lexer.tokenize()
+
+def token_soup(rng: random.Random, length: int) -> str:
+    lexemes = (list(KEYWORDS) + list(SINGLE_CHAR_TOKENS) + list(TWO_CHAR_OPERATORS)
+               + list(THREE_CHAR_OPERATORS) + FRAGMENTS)
+    parts = []
+    for _ in range(length):
+        parts.append(rng.choice(lexemes))
+        parts.append(rng.choice(["", " ", " ", "\n", "\t"]))
+    return "".join(parts)
+
+class DifferentialTest(unittest.TestCase):
+    def assert_same_tokens(self, source: str, name: str) -> None:
+        expected = tokens_of(source, reference=True)
+        actual = tokens_of(source, reference=False)
+        for i, (want, got) in enumerate(zip(expected, actual)):
+            if want != got:
+                self.fail(f"{name}: token {i} differs\n  reference: {want}\n  tokenize:  {got}")
+        self.assertEqual(len(expected), len(actual), f"{name}: token count differs")
+
+    def test_tree_sources(self):
+        sources = fluxtest.fx_sources()
+        self.assertTrue(sources)
+        for path in sources:
+            with self.subTest(path=path.name):
+                with contextlib.redirect_stdout(io.StringIO()), contextlib.redirect_stderr(io.StringIO()) as errors:
+                    status = check_tokenizers(path.read_text(encoding='utf-8'), path.name)
+                self.assertEqual(status, 0, errors.getvalue())
+
+    def test_benchmark_programs(self):
+        for workload in generate.WORKLOADS:
+            with self.subTest(workload=workload):
+                self.assert_same_tokens(generate.generate(workload, 20), workload)
+
+    def test_token_soup(self):
+        rng = random.Random(0x464C5558)
+        for i in range(300):
+            source = token_soup(rng, rng.randint(1, 60))
+            with self.subTest(case=i):
+                self.assert_same_tokens(source, f"soup {i}: {source!r}")
+
+    def test_truncated_sources(self):
+        # Cutting a file anywhere leaves comments, strings and numbers unterminated
+        rng = random.Random(1)
+        for path in fluxtest.fx_sources():
+            source = path.read_text(encoding='utf-8')
+            for cut in sorted(rng.sample(range(len(source) + 1), min(40, len(source) + 1))):
+                with self.subTest(path=path.name, cut=cut):
+                    self.assert_same_tokens(source[:cut], f"{path.name}[:{cut}]")
+
+    def test_lazy_tokens_match_list(self):
+        source = (fluxtest.ROOT / "examples" / "sha256.fx").read_text(encoding='utf-8')
+        self.assertEqual(list(FluxLexer(source).iter_tokens()), FluxLexer(source).tokenize())
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,130 @@
+"""
+Parse-tree tests for binary expressions, and the parser's token window
+
+binary_expression climbs BINARY_OPERATORS instead of descending one
+method per level, so these pin down what the table promises: which
+operator binds tighter, and which way each level associates. Trees are
+compared as nested tuples, e.g. ('+', 'a', ('*', 'b', 'c')).
+
+The parser pulls tokens from the lexer as it goes; the window test
+checks that it only ever holds a bounded number of them.
+"""
+
+import unittest
+
+import fluxtest
+import generate
+
+# A spelling of each operator the table lists, so every level is covered
+SPELLINGS = {
+    'OR': 'or', 'AND': 'and', 'XOR': 'xor',
+    'EQUAL': '==', 'NOT_EQUAL': '!=',
+    'LESS_THAN': '<', 'LESS_EQUAL': '<=', 'GREATER_THAN': '>', 'GREATER_EQUAL': '>=',
+    'LEFT_SHIFT': '<<', 'RIGHT_SHIFT': '>>',
+    'PLUS': '+', 'MINUS': '-', 'MULTIPLY': '*', 'DIVIDE': '/', 'MODULO': '%',
+    'POWER': '^',
+}
+
+def parse_expression(source: str):
+    """The tree of one expression, parsed as the value of a return"""
+    from flexer import FluxLexer
+    from fparser import FluxParser
+    parser = FluxParser(FluxLexer(f"def f() -> int {{ return {source}; }};").tokenize())
+    program = parser.parse()
+    if parser.errors:
+        raise SyntaxError(f"{source}: {parser.errors[0]}")
+    return program.statements[0].body.statements[0].value
+
+def shape(expr):
+    """expr as nested (operator, operands...) tuples, with leaves as names or values"""
+    from fast import BinaryOp, UnaryOp, Identifier, Literal, RangeExpression
+    if isinstance(expr, BinaryOp):
+        return (expr.operator.value, shape(expr.left), shape(expr.right))
+    if isinstance(expr, UnaryOp):
+        return (f"unary {expr.operator.value}", shape(expr.operand))
+    if isinstance(expr, RangeExpression):
+        return ('..', shape(expr.start), shape(expr.end))
+    if isinstance(expr, Identifier):
+        return expr.name
+    if isinstance(expr, Literal):
+        return expr.value
+    return type(expr).__name__
+
+@unittest.skipUnless(fluxtest.HAVE_LLVMLITE, "needs llvmlite")
+class PrecedenceTest(unittest.TestCase):
+    def assert_tree(self, source: str, expected) -> None:
+        self.assertEqual(shape(parse_expression(source)), expected, source)
+
+    def test_every_table_level_binds_tighter_than_the_one_below(self):
+        from fparser import BINARY_OPERATORS, WORD_OPERATORS
+        levels = {}
+        for token, (precedence, operator) in BINARY_OPERATORS.items():
+            if token.name in SPELLINGS:
+                levels.setdefault(precedence, []).append((SPELLINGS[token.name], operator.value))
+        for word, (precedence, operator) in WORD_OPERATORS.items():
+            levels.setdefault(precedence, []).append((word, operator.value))
+        self.assertEqual(sum(len(ops) for ops in levels.values()), len(BINARY_OPERATORS) - 1 + len(WORD_OPERATORS))
+        for low in levels:
+            for high in (p for p in levels if p > low):
+                for low_text, low_op in levels[low]:
+                    for high_text, high_op in levels[high]:
+                        self.assert_tree(f"a {low_text} b {high_text} c", (low_op, 'a', (high_op, 'b', 'c')))
+                        self.assert_tree(f"a {high_text} b {low_text} c", (low_op, (high_op, 'a', 'b'), 'c'))
+
+    def test_levels_are_left_associative(self):
+        self.assert_tree("a - b - c", ('-', ('-', 'a', 'b'), 'c'))
+        self.assert_tree("a / b * c", ('*', ('/', 'a', 'b'), 'c'))
+        self.assert_tree("a - b + c", ('+', ('-', 'a', 'b'), 'c'))
+        self.assert_tree("a << 1 >> 2", ('>>', ('<<', 'a', 1), 2))
+        self.assert_tree("a rotl 1 rotr 2", ('rotr', ('rotl', 'a', 1), 2))
+        self.assert_tree("a == b != c", ('!=', ('==', 'a', 'b'), 'c'))
+        self.assert_tree("a or b or c", ('or', ('or', 'a', 'b'), 'c'))
+
+    def test_power_is_right_associative(self):
+        self.assert_tree("a ^ b ^ c", ('^', 'a', ('^', 'b', 'c')))
+        self.assert_tree("a * b ^ c ^ d", ('*', 'a', ('^', 'b', ('^', 'c', 'd'))))
+
+    def test_rotates_share_the_shift_level(self):
+        self.assert_tree("a rotl 1 + b", ('rotl', 'a', ('+', 1, 'b')))
+        self.assert_tree("a << b rotr c", ('rotr', ('<<', 'a', 'b'), 'c'))
+
+    def test_prefix_operators_bind_tighter_than_binary_ones(self):
+        self.assert_tree("-a ^ 2", ('^', ('unary -', 'a'), 2))
+        self.assert_tree("a * -b", ('*', 'a', ('unary -', 'b')))
+        self.assert_tree("not a and b", ('and', ('unary not', 'a'), 'b'))
+
+    def test_parentheses_override_precedence(self):
+        self.assert_tree("(a + b) * c", ('*', ('+', 'a', 'b'), 'c'))
+        self.assert_tree("(a ^ b) ^ c", ('^', ('^', 'a', 'b'), 'c'))
+
+    def test_range_sits_between_comparison_and_shift(self):
+        self.assert_tree("0 .. n << 1", ('..', 0, ('<<', 'n', 1)))
+        self.assert_tree("a < 0 .. n", ('<', 'a', ('..', 0, 'n')))
+
+@unittest.skipUnless(fluxtest.HAVE_LLVMLITE, "needs llvmlite")
+class TokenWindowTest(unittest.TestCase):
+    def test_window_stays_bounded(self):
+        from flexer import FluxLexer, DISCARD_BATCH
+        from fparser import FluxParser
+        for workload in generate.WORKLOADS:
+            with self.subTest(workload=workload):
+                parser = None
+                consumed = []  # Tokens kept behind the parser's position
+                ahead = []     # Tokens pulled past it
+
+                def watched(tokens):
+                    for token in tokens:
+                        if parser is not None:
+                            consumed.append(parser.position - parser.tokens._base)
+                            ahead.append(parser.tokens.pulled - parser.position)
+                        yield token
+
+                parser = FluxParser(watched(FluxLexer(generate.generate(workload, 100)).iter_tokens()))
+                parser.parse()
+                self.assertEqual(parser.errors, [])
+                self.assertGreater(parser.tokens.pulled, 20 * DISCARD_BATCH)
+                self.assertLessEqual(max(consumed), DISCARD_BATCH)
+                self.assertLessEqual(max(ahead), 2)
+
+if __name__ == "__main__":
+    unittest.main()